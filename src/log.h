@@ -12,6 +12,7 @@
 #define log_h
 
 #include "log_core.h"
+#include "log_event.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,23 +23,154 @@ extern "C" {
  *****************************************************************************/
 
 #define LOG_DBG(fmt_str, ...)                                                  \
-  LOG_IMPL(LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG_COLOR fmt_str LOG_RESET_COLOR,     \
-           ##__VA_ARGS__)
+  LOG_IMPL(LOG_LEVEL_DEBUG, fmt_str, ##__VA_ARGS__)
 
 #define LOG_INF(fmt_str, ...)                                                  \
-  LOG_IMPL(LOG_LEVEL_INFO, LOG_LEVEL_INFO_COLOR fmt_str LOG_RESET_COLOR,       \
-           ##__VA_ARGS__)
+  LOG_IMPL(LOG_LEVEL_INFO, fmt_str, ##__VA_ARGS__)
 
 #define LOG_WRN(fmt_str, ...)                                                  \
-  LOG_IMPL(LOG_LEVEL_WARNING, LOG_LEVEL_WARNING_COLOR fmt_str LOG_RESET_COLOR, \
-           ##__VA_ARGS__)
+  LOG_IMPL(LOG_LEVEL_WARNING, fmt_str, ##__VA_ARGS__)
 
 #define LOG_ERR(fmt_str, ...)                                                  \
-  LOG_IMPL(LOG_LEVEL_ERROR, LOG_LEVEL_ERROR_COLOR fmt_str LOG_RESET_COLOR,     \
-           ##__VA_ARGS__)
+  LOG_IMPL(LOG_LEVEL_ERROR, fmt_str, ##__VA_ARGS__)
+
+/**
+ * @brief Rate limited variants, at most `burst` messages per `interval_ms`
+ *
+ * Each callsite owns a token bucket.  Suppressed messages are counted and
+ * reported as "(suppressed N)" on the next message that passes.
+ */
+#define LOG_DBG_RATELIMITED(interval_ms, burst, fmt_str, ...)                  \
+  LOG_IMPL_RATELIMITED(LOG_LEVEL_DEBUG, interval_ms, burst, fmt_str,           \
+                       ##__VA_ARGS__)
+
+#define LOG_INF_RATELIMITED(interval_ms, burst, fmt_str, ...)                  \
+  LOG_IMPL_RATELIMITED(LOG_LEVEL_INFO, interval_ms, burst, fmt_str,            \
+                       ##__VA_ARGS__)
+
+#define LOG_WRN_RATELIMITED(interval_ms, burst, fmt_str, ...)                  \
+  LOG_IMPL_RATELIMITED(LOG_LEVEL_WARNING, interval_ms, burst, fmt_str,         \
+                       ##__VA_ARGS__)
+
+#define LOG_ERR_RATELIMITED(interval_ms, burst, fmt_str, ...)                  \
+  LOG_IMPL_RATELIMITED(LOG_LEVEL_ERROR, interval_ms, burst, fmt_str,           \
+                       ##__VA_ARGS__)
+
+/**
+ * @brief Sampled variants, decided per callsite before arguments are evaluated
+ *
+ * `_ONCE` logs the first call only, `_EVERY_N` logs calls 0, n, 2n, ... and
+ * `_SAMPLED` logs each call with probability `prob`.  Safe to use in ISRs.
+ */
+#define LOG_DBG_ONCE(fmt_str, ...)                                             \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_DEBUG, log_sample_once(&prv_log_sample), fmt_str, \
+                   ##__VA_ARGS__)
+
+#define LOG_DBG_EVERY_N(n, fmt_str, ...)                                       \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_DEBUG, log_sample_every_n(&prv_log_sample, (n)),  \
+                   fmt_str, ##__VA_ARGS__)
+
+#define LOG_DBG_SAMPLED(prob, fmt_str, ...)                                    \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_DEBUG,                                            \
+                   log_sample_probability(&prv_log_sample,                     \
+                                          LOG_SAMPLE_THRESHOLD(prob)),         \
+                   fmt_str, ##__VA_ARGS__)
+
+#define LOG_INF_ONCE(fmt_str, ...)                                             \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_INFO, log_sample_once(&prv_log_sample), fmt_str,  \
+                   ##__VA_ARGS__)
+
+#define LOG_INF_EVERY_N(n, fmt_str, ...)                                       \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_INFO, log_sample_every_n(&prv_log_sample, (n)),   \
+                   fmt_str, ##__VA_ARGS__)
+
+#define LOG_INF_SAMPLED(prob, fmt_str, ...)                                    \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_INFO,                                             \
+                   log_sample_probability(&prv_log_sample,                     \
+                                          LOG_SAMPLE_THRESHOLD(prob)),         \
+                   fmt_str, ##__VA_ARGS__)
+
+#define LOG_WRN_ONCE(fmt_str, ...)                                             \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_WARNING, log_sample_once(&prv_log_sample),       \
+                   fmt_str, ##__VA_ARGS__)
+
+#define LOG_WRN_EVERY_N(n, fmt_str, ...)                                       \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_WARNING, log_sample_every_n(&prv_log_sample, (n)),\
+                   fmt_str, ##__VA_ARGS__)
+
+#define LOG_WRN_SAMPLED(prob, fmt_str, ...)                                    \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_WARNING,                                          \
+                   log_sample_probability(&prv_log_sample,                     \
+                                          LOG_SAMPLE_THRESHOLD(prob)),         \
+                   fmt_str, ##__VA_ARGS__)
+
+#define LOG_ERR_ONCE(fmt_str, ...)                                             \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_ERROR, log_sample_once(&prv_log_sample), fmt_str, \
+                   ##__VA_ARGS__)
+
+#define LOG_ERR_EVERY_N(n, fmt_str, ...)                                       \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_ERROR, log_sample_every_n(&prv_log_sample, (n)),  \
+                   fmt_str, ##__VA_ARGS__)
+
+#define LOG_ERR_SAMPLED(prob, fmt_str, ...)                                    \
+  LOG_IMPL_SAMPLED(LOG_LEVEL_ERROR,                                            \
+                   log_sample_probability(&prv_log_sample,                     \
+                                          LOG_SAMPLE_THRESHOLD(prob)),         \
+                   fmt_str, ##__VA_ARGS__)
+
+
+/**
+ * @brief Structured key/value variants
+ *
+ * `LOG_KV_INF("motor", KV_U32("rpm", rpm), KV_F32("temp", t))` logs an event
+ * with up to LOG_KV_MAX_FIELDS typed fields and no format string.
+ */
+#define LOG_KV_DBG(event_name, ...)                                            \
+  LOG_KV_IMPL(LOG_LEVEL_DEBUG, event_name, __VA_ARGS__)
+
+#define LOG_KV_INF(event_name, ...)                                            \
+  LOG_KV_IMPL(LOG_LEVEL_INFO, event_name, __VA_ARGS__)
+
+#define LOG_KV_WRN(event_name, ...)                                            \
+  LOG_KV_IMPL(LOG_LEVEL_WARNING, event_name, __VA_ARGS__)
+
+#define LOG_KV_ERR(event_name, ...)                                            \
+  LOG_KV_IMPL(LOG_LEVEL_ERROR, event_name, __VA_ARGS__)
+
+/**
+ * @brief Trace span markers
+ *
+ * `LOG_SPAN_BEGIN("adc_read")` and `LOG_SPAN_END("adc_read")` queue compact
+ * begin and end records with timestamp and task ID.  The duration is the
+ * difference of the two timestamps.
+ */
+#define LOG_SPAN_BEGIN(span_name) LOG_SPAN_IMPL(span_name, false)
+
+#define LOG_SPAN_END(span_name) LOG_SPAN_IMPL(span_name, true)
+
+/**
+ * @brief Format-free counter/marker event, cheap enough for every ISR entry
+ *
+ * Records a fixed 12 byte (ID, timestamp, value) entry in the event ring.
+ * Compiles to nothing when LOG_EVENT_ENABLE is 0.
+ */
+#if LOG_EVENT_ENABLE
+#define LOG_EVENT(id, value)                                                   \
+  do {                                                                         \
+    if (xPortIsInsideInterrupt()) {                                            \
+      log_event_record_isr((id), (value));                                     \
+    } else {                                                                   \
+      log_event_record((id), (value));                                         \
+    }                                                                          \
+  } while (0)
+#else
+#define LOG_EVENT(id, value)                                                   \
+  do {                                                                         \
+  } while (0)
+#endif
 
 #define LOG_REGISTER_MODULE(module_name)                                       \
-  static const char *prv_log_module_name = #module_name;
+  static log_module_t prv_log_module = LOG_MODULE_INIT(#module_name);
 
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log.hpp
+ * @author Evan Stoddard
+ * @brief Header-only type-safe C++17 front end
+ *
+ * Produces the same messages as the C macros.  The format string is checked
+ * against the argument types at compile time, the packed size is a
+ * constant and levels above LOG_LEVEL_COMPILE_MAX compile to nothing.
+ */
+
+#ifndef log_hpp
+#define log_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "log.h"
+#include "log_format.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define LOG_CXX_IMPL(level, fmt_str, ...)                                      \
+  do {                                                                         \
+    if constexpr ((level) <= LOG_LEVEL_COMPILE_MAX) {                          \
+      static log_callsite_t prv_log_callsite =                                 \
+          LOG_CALLSITE_INIT(&prv_log_module, level, __FUNCTION__, fmt_str);    \
+      logger::write<level>([]() constexpr { return fmt_str; },                 \
+                           prv_log_callsite, ##__VA_ARGS__);                   \
+    }                                                                          \
+  } while (0)
+
+#define LOG_CXX_DBG(fmt_str, ...)                                              \
+  LOG_CXX_IMPL(LOG_LEVEL_DEBUG, fmt_str, ##__VA_ARGS__)
+
+#define LOG_CXX_INF(fmt_str, ...)                                              \
+  LOG_CXX_IMPL(LOG_LEVEL_INFO, fmt_str, ##__VA_ARGS__)
+
+#define LOG_CXX_WRN(fmt_str, ...)                                              \
+  LOG_CXX_IMPL(LOG_LEVEL_WARNING, fmt_str, ##__VA_ARGS__)
+
+#define LOG_CXX_ERR(fmt_str, ...)                                              \
+  LOG_CXX_IMPL(LOG_LEVEL_ERROR, fmt_str, ##__VA_ARGS__)
+
+/**
+ * @brief Trace span covering the rest of the enclosing scope
+ *
+ * Queues a span begin record here and the matching end record when the
+ * scope is left.
+ */
+#define LOG_SCOPE(span_name) LOG_SCOPE_IMPL(span_name, __LINE__)
+#define LOG_SCOPE_IMPL(span_name, line) LOG_SCOPE_IMPL_(span_name, line)
+#define LOG_SCOPE_IMPL_(span_name, line)                                       \
+  static log_callsite_t prv_log_scope_callsite_##line = LOG_CALLSITE_INIT(     \
+      &prv_log_module, LOG_SPAN_LEVEL, __FUNCTION__, span_name);               \
+  logger::scope prv_log_scope_##line(prv_log_scope_callsite_##line)
+
+namespace logger {
+namespace detail {
+
+/*****************************************************************************
+ * Format Parsing
+ *****************************************************************************/
+
+/**
+ * @brief Conversion specifier found by the compile time parser
+ *
+ */
+struct spec_t {
+  std::size_t next;
+  log_format_arg_type_t type;
+  bool found;
+};
+
+constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+/**
+ * @brief Compile time mirror of log_format_next_spec
+ *
+ * @param fmt Format string
+ * @param pos Position to start scanning from
+ * @return Specifier found and position after it
+ */
+constexpr spec_t next_spec(const char *fmt, std::size_t pos) {
+  while (fmt[pos] && fmt[pos] != '%') {
+    pos++;
+  }
+
+  if (!fmt[pos]) {
+    return {pos, LOG_FORMAT_ARG_NONE, false};
+  }
+
+  std::size_t p = pos + 1;
+
+  if (fmt[p] == '%') {
+    return {p + 1, LOG_FORMAT_ARG_NONE, true};
+  }
+
+  while (fmt[p] == '-' || fmt[p] == '+' || fmt[p] == ' ' || fmt[p] == '#' ||
+         fmt[p] == '0') {
+    p++;
+  }
+  while (is_digit(fmt[p])) {
+    p++;
+  }
+  if (fmt[p] == '.') {
+    p++;
+    while (is_digit(fmt[p])) {
+      p++;
+    }
+  }
+
+  log_format_arg_type_t int_type = LOG_FORMAT_ARG_INT;
+
+  switch (fmt[p]) {
+  case 'h':
+    p += (fmt[p + 1] == 'h') ? 2 : 1;
+    break;
+  case 'l':
+    if (fmt[p + 1] == 'l') {
+      int_type = LOG_FORMAT_ARG_LONG_LONG;
+      p += 2;
+    } else {
+      int_type = LOG_FORMAT_ARG_LONG;
+      p++;
+    }
+    break;
+  case 'z':
+    int_type = LOG_FORMAT_ARG_SIZE;
+    p++;
+    break;
+  case 't':
+    int_type = LOG_FORMAT_ARG_PTRDIFF;
+    p++;
+    break;
+  case 'j':
+    int_type = LOG_FORMAT_ARG_INTMAX;
+    p++;
+    break;
+  default:
+    break;
+  }
+
+  switch (fmt[p]) {
+  case 'd':
+  case 'i':
+  case 'o':
+  case 'u':
+  case 'x':
+  case 'X':
+    return {p + 1, int_type, true};
+  case 'c':
+    return {p + 1, LOG_FORMAT_ARG_INT, true};
+  case 'f':
+  case 'F':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+    return {p + 1, LOG_FORMAT_ARG_DOUBLE, true};
+  case 's':
+    return {p + 1, LOG_FORMAT_ARG_STRING, true};
+  case 'p':
+    return {p + 1, LOG_FORMAT_ARG_POINTER, true};
+  case 'n':
+    return {p + 1, LOG_FORMAT_ARG_WRITEBACK, true};
+  default:
+    return {p, LOG_FORMAT_ARG_INVALID, true};
+  }
+}
+
+/**
+ * @brief Compile time mirror of log_format_arg_size
+ *
+ * @param type Argument type
+ * @return Size in bytes
+ */
+constexpr std::size_t arg_size(log_format_arg_type_t type) {
+  switch (type) {
+  case LOG_FORMAT_ARG_INT:
+    return sizeof(int);
+  case LOG_FORMAT_ARG_LONG:
+    return sizeof(long);
+  case LOG_FORMAT_ARG_LONG_LONG:
+    return sizeof(long long);
+  case LOG_FORMAT_ARG_SIZE:
+    return sizeof(std::size_t);
+  case LOG_FORMAT_ARG_PTRDIFF:
+    return sizeof(std::ptrdiff_t);
+  case LOG_FORMAT_ARG_INTMAX:
+    return sizeof(std::intmax_t);
+  case LOG_FORMAT_ARG_DOUBLE:
+    return sizeof(double);
+  case LOG_FORMAT_ARG_STRING:
+    return sizeof(char *);
+  case LOG_FORMAT_ARG_POINTER:
+  case LOG_FORMAT_ARG_WRITEBACK:
+    return sizeof(void *);
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief Check format for specifiers the packer cannot handle
+ *
+ * @param fmt Format string
+ * @return true if every specifier is supported
+ */
+constexpr bool is_supported(const char *fmt) {
+  for (spec_t spec = next_spec(fmt, 0); spec.found;
+       spec = next_spec(fmt, spec.next)) {
+    if (spec.type == LOG_FORMAT_ARG_INVALID ||
+        spec.type == LOG_FORMAT_ARG_WRITEBACK) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Count arguments consumed by format
+ *
+ * @param fmt Format string
+ * @return Number of arguments
+ */
+constexpr std::size_t arg_count(const char *fmt) {
+  std::size_t count = 0;
+
+  for (spec_t spec = next_spec(fmt, 0); spec.found;
+       spec = next_spec(fmt, spec.next)) {
+    count += arg_size(spec.type) > 0 ? 1 : 0;
+  }
+
+  return count;
+}
+
+/**
+ * @brief Get type of argument
+ *
+ * @param fmt Format string
+ * @param index Argument index
+ * @return Argument type
+ */
+constexpr log_format_arg_type_t arg_type(const char *fmt, std::size_t index) {
+  for (spec_t spec = next_spec(fmt, 0); spec.found;
+       spec = next_spec(fmt, spec.next)) {
+    if (arg_size(spec.type) == 0) {
+      continue;
+    }
+
+    if (index-- == 0) {
+      return spec.type;
+    }
+  }
+
+  return LOG_FORMAT_ARG_INVALID;
+}
+
+/**
+ * @brief Get offset of argument in the packed buffer
+ *
+ * @param fmt Format string
+ * @param index Argument index, arg_count gives the total packed size
+ * @return Offset in bytes
+ */
+constexpr std::size_t arg_offset(const char *fmt, std::size_t index) {
+  std::size_t offset = 0;
+
+  for (spec_t spec = next_spec(fmt, 0); spec.found && index > 0;
+       spec = next_spec(fmt, spec.next)) {
+    if (arg_size(spec.type) == 0) {
+      continue;
+    }
+
+    offset += arg_size(spec.type);
+    index--;
+  }
+
+  return offset;
+}
+
+/*****************************************************************************
+ * Argument Packing
+ *****************************************************************************/
+
+/**
+ * @brief Check if argument type can be stored for a specifier
+ *
+ * Integers must not be wider than the specifier, so `%d` with an int64_t
+ * fails to compile instead of silently truncating.
+ */
+template <log_format_arg_type_t Type, typename T>
+constexpr bool arg_matches() {
+  using U = std::remove_cv_t<std::remove_reference_t<T>>;
+  constexpr bool is_int = std::is_integral_v<U> || std::is_enum_v<U>;
+
+  switch (Type) {
+  case LOG_FORMAT_ARG_INT:
+    return is_int && sizeof(U) <= sizeof(int);
+  case LOG_FORMAT_ARG_LONG:
+    return is_int && sizeof(U) <= sizeof(long);
+  case LOG_FORMAT_ARG_LONG_LONG:
+    return is_int && sizeof(U) <= sizeof(long long);
+  case LOG_FORMAT_ARG_SIZE:
+    return is_int && sizeof(U) <= sizeof(std::size_t);
+  case LOG_FORMAT_ARG_PTRDIFF:
+    return is_int && sizeof(U) <= sizeof(std::ptrdiff_t);
+  case LOG_FORMAT_ARG_INTMAX:
+    return is_int && sizeof(U) <= sizeof(std::intmax_t);
+  case LOG_FORMAT_ARG_DOUBLE:
+    return std::is_floating_point_v<U> && sizeof(U) <= sizeof(double);
+  case LOG_FORMAT_ARG_STRING:
+    return std::is_convertible_v<U, const char *>;
+  case LOG_FORMAT_ARG_POINTER:
+    return std::is_pointer_v<std::decay_t<U>> ||
+           std::is_null_pointer_v<U>;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Storage type of an argument in the packed buffer
+ *
+ */
+template <log_format_arg_type_t Type> struct storage;
+template <> struct storage<LOG_FORMAT_ARG_INT> { using type = int; };
+template <> struct storage<LOG_FORMAT_ARG_LONG> { using type = long; };
+template <> struct storage<LOG_FORMAT_ARG_LONG_LONG> {
+  using type = long long;
+};
+template <> struct storage<LOG_FORMAT_ARG_SIZE> { using type = std::size_t; };
+template <> struct storage<LOG_FORMAT_ARG_PTRDIFF> {
+  using type = std::ptrdiff_t;
+};
+template <> struct storage<LOG_FORMAT_ARG_INTMAX> {
+  using type = std::intmax_t;
+};
+template <> struct storage<LOG_FORMAT_ARG_DOUBLE> { using type = double; };
+template <> struct storage<LOG_FORMAT_ARG_STRING> {
+  using type = const char *;
+};
+template <> struct storage<LOG_FORMAT_ARG_POINTER> {
+  using type = const void *;
+};
+
+/**
+ * @brief Store argument at its constant offset
+ *
+ * @param fmt_fn Lambda returning the format string
+ * @param buffer Packed buffer
+ * @param value Argument
+ */
+template <std::size_t Index, typename FmtFn, typename T>
+inline void store_arg(FmtFn fmt_fn, std::uint8_t *buffer, const T &value) {
+  constexpr const char *fmt = fmt_fn();
+  constexpr log_format_arg_type_t type = arg_type(fmt, Index);
+
+  static_assert(arg_matches<type, T>(),
+                "log argument type does not match format specifier");
+
+  using stored_t = typename storage<type>::type;
+  stored_t stored = (stored_t)value;
+
+  // Buffer is only 4-byte aligned in the pool, memcpy compiles to a store
+  std::memcpy(buffer + arg_offset(fmt, Index), &stored, sizeof(stored));
+}
+
+/**
+ * @brief Store every argument
+ *
+ */
+template <typename FmtFn, typename... Args, std::size_t... Index>
+inline void pack(FmtFn fmt_fn, std::uint8_t *buffer,
+                 std::index_sequence<Index...>, const Args &...args) {
+  (void)fmt_fn;
+  (void)buffer;
+  (store_arg<Index>(fmt_fn, buffer, args), ...);
+}
+
+} // namespace detail
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Check, pack and queue message
+ *
+ * Normally reached through LOG_CXX_*, which provides the callsite and the
+ * lambda wrapping the format literal.
+ *
+ * @param fmt_fn Captureless lambda returning the format string
+ * @param callsite Callsite descriptor of the format string
+ * @param args Arguments
+ */
+template <std::uint8_t Level, typename FmtFn, typename... Args>
+inline void write(FmtFn fmt_fn, log_callsite_t &callsite,
+                  const Args &...args) {
+  if constexpr (Level <= LOG_LEVEL_COMPILE_MAX) {
+    constexpr const char *fmt = fmt_fn();
+
+    static_assert(detail::is_supported(fmt),
+                  "format string contains an unsupported specifier");
+    static_assert(detail::arg_count(fmt) == sizeof...(Args),
+                  "number of log arguments does not match format string");
+
+    constexpr std::size_t size =
+        detail::arg_offset(fmt, detail::arg_count(fmt));
+
+    if (!log_filter_module_enabled(callsite.module, Level)) {
+      return;
+    }
+
+    std::uint8_t buffer[size > 0 ? size : 1];
+    detail::pack(fmt_fn, buffer, std::index_sequence_for<Args...>{},
+                 args...);
+
+    if (xPortIsInsideInterrupt()) {
+      log_queue_packed_message_isr(&callsite, buffer, size);
+    } else {
+      log_queue_packed_message(&callsite, buffer, size);
+    }
+  }
+}
+
+/*****************************************************************************
+ * Trace Spans
+ *****************************************************************************/
+
+/**
+ * @brief RAII trace span, normally created through LOG_SCOPE
+ *
+ * The filter is evaluated once on entry so begin and end records always
+ * come in pairs.
+ */
+class scope {
+public:
+  explicit scope(log_callsite_t &callsite)
+      : callsite_(callsite),
+        active_(LOG_SPAN_LEVEL <= LOG_LEVEL_COMPILE_MAX &&
+                log_filter_module_enabled(callsite.module, LOG_SPAN_LEVEL)) {
+    if (active_) {
+      send(false);
+    }
+  }
+
+  ~scope() {
+    if (active_) {
+      send(true);
+    }
+  }
+
+  scope(const scope &) = delete;
+  scope &operator=(const scope &) = delete;
+
+private:
+  void send(bool end) {
+    if (xPortIsInsideInterrupt()) {
+      log_queue_span_isr(&callsite_, end);
+    } else {
+      log_queue_span(&callsite_, end);
+    }
+  }
+
+  log_callsite_t &callsite_;
+  bool active_;
+};
+
+} // namespace logger
+
+#endif /* log_hpp */
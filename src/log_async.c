@@ -0,0 +1,296 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_async.c
+ * @author Evan Stoddard
+ * @brief Double buffered backend for sinks with asynchronous writes
+ */
+
+#include "log_async.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "task.h"
+
+#include "log_render.h"
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Hand fill buffer to the driver and swap halves (critical section)
+ *
+ * @param async Pointer to async backend
+ * @param buf Set to buffer to write
+ * @param count Set to number of lines in buffer
+ * @return Number of bytes to write
+ */
+static size_t prv_swap(log_async_backend_t *async, const uint8_t **buf,
+                       uint16_t *count) {
+  uint8_t fill = async->fill;
+  size_t len = async->len[fill];
+
+  *buf = async->buf[fill];
+  *count = async->count[fill];
+
+  // Previous write completed, its half becomes the fill buffer
+  async->fill = fill ^ 1u;
+  async->len[async->fill] = 0;
+  async->count[async->fill] = 0;
+  async->busy = true;
+
+  return len;
+}
+
+/**
+ * @brief Wake a pending flush once the driver went idle
+ *
+ * @param async Pointer to async backend
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ */
+static void prv_signal_idle(log_async_backend_t *async, bool in_isr,
+                            BaseType_t *higher_prio) {
+  if (in_isr) {
+    xSemaphoreGiveFromISR(async->idle, higher_prio);
+  } else {
+    xSemaphoreGive(async->idle);
+  }
+}
+
+/**
+ * @brief Start write, dropping the batch if the driver refuses it
+ *
+ * @param async Pointer to async backend
+ * @param buf Buffer to write
+ * @param len Number of bytes
+ * @param count Number of lines in buffer
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ */
+static void prv_start(log_async_backend_t *async, const uint8_t *buf,
+                      size_t len, uint16_t count, bool in_isr,
+                      BaseType_t *higher_prio) {
+  UBaseType_t saved_isr_state = 0;
+
+  if (async->driver->start_write(async->ctx, buf, len) == 0) {
+    return;
+  }
+
+  if (in_isr) {
+    saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+  } else {
+    taskENTER_CRITICAL();
+  }
+
+  async->dropped += count;
+  async->busy = false;
+
+  if (in_isr) {
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskEXIT_CRITICAL();
+  }
+
+  prv_signal_idle(async, in_isr, higher_prio);
+}
+
+/**
+ * @brief Start next batch or go idle once a write completed
+ *
+ * @param async Pointer to async backend
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ */
+static void prv_write_done(log_async_backend_t *async, bool in_isr,
+                           BaseType_t *higher_prio) {
+  UBaseType_t saved_isr_state = 0;
+  const uint8_t *buf = NULL;
+  uint16_t count = 0;
+  size_t len = 0;
+
+  if (in_isr) {
+    saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+  } else {
+    taskENTER_CRITICAL();
+  }
+
+  // Decided atomically so a line appended meanwhile is never stranded
+  if (async->len[async->fill] > 0) {
+    len = prv_swap(async, &buf, &count);
+  } else {
+    async->busy = false;
+  }
+
+  if (in_isr) {
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskEXIT_CRITICAL();
+  }
+
+  if (len == 0) {
+    prv_signal_idle(async, in_isr, higher_prio);
+    return;
+  }
+
+  prv_start(async, buf, len, count, in_isr, higher_prio);
+}
+
+/**
+ * @brief Gather rendered slices into fill buffer, starting a write if idle
+ *
+ * @param backend Pointer to backend
+ * @param iov Slices of the rendered line
+ * @param cnt Number of slices
+ */
+static void prv_write_iov(const log_backend_t *backend, const log_iov_t *iov,
+                          int cnt) {
+  log_async_backend_t *async = (log_async_backend_t *)backend;
+  const uint8_t *buf = NULL;
+  uint16_t count = 0;
+  size_t line_len = 0;
+  size_t len = 0;
+
+  for (int i = 0; i < cnt; i++) {
+    line_len += iov[i].len;
+  }
+
+  if (line_len == 0) {
+    return;
+  }
+
+  // The completion may swap halves at any time, append atomically
+  taskENTER_CRITICAL();
+
+  uint8_t fill = async->fill;
+
+  if (async->len[fill] + line_len > LOG_ASYNC_BUFFER_SIZE) {
+    async->dropped++;
+  } else {
+    uint8_t *dst = &async->buf[fill][async->len[fill]];
+
+    for (int i = 0; i < cnt; i++) {
+      memcpy(dst, iov[i].base, iov[i].len);
+      dst += iov[i].len;
+    }
+
+    async->len[fill] += (uint16_t)line_len;
+    async->count[fill]++;
+
+    if (!async->busy) {
+      len = prv_swap(async, &buf, &count);
+    }
+  }
+
+  taskEXIT_CRITICAL();
+
+  if (len > 0) {
+    prv_start(async, buf, len, count, false, NULL);
+  }
+}
+
+/**
+ * @brief Wait until the driver has written everything buffered
+ *
+ * @param backend Pointer to backend
+ * @param timeout_ms Maximum time to wait
+ * @return 0 on success, -ETIMEDOUT otherwise
+ */
+static int prv_flush(const log_backend_t *backend, uint32_t timeout_ms) {
+  log_async_backend_t *async = (log_async_backend_t *)backend;
+  TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+
+  while (true) {
+    // Drop stale signal, a completion after this point signals again
+    xSemaphoreTake(async->idle, 0);
+
+    taskENTER_CRITICAL();
+    bool done = !async->busy && async->len[async->fill] == 0;
+    taskEXIT_CRITICAL();
+
+    if (done) {
+      return 0;
+    }
+
+    TickType_t remaining = deadline - xTaskGetTickCount();
+    if ((int32_t)remaining <= 0 ||
+        xSemaphoreTake(async->idle, remaining) != pdTRUE) {
+      return -ETIMEDOUT;
+    }
+  }
+}
+
+/**
+ * @brief Write buffered output and message by polling
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_panic_write(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  log_async_backend_t *async = (log_async_backend_t *)backend;
+
+  if (async->driver->poll_write == NULL) {
+    return;
+  }
+
+  // Output waiting behind the in-flight write would otherwise be lost
+  uint8_t fill = async->fill;
+  if (async->len[fill] > 0) {
+    async->driver->poll_write(async->ctx, async->buf[fill],
+                              async->len[fill]);
+    async->len[fill] = 0;
+  }
+
+  size_t line_len = log_render_msg(msg, backend->layout, async->line,
+                                   sizeof(async->line));
+  async->driver->poll_write(async->ctx, (const uint8_t *)async->line,
+                            line_len);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_async_backend_init(log_async_backend_t *async,
+                           const log_async_driver_t *driver, void *ctx) {
+  if (async == NULL || driver == NULL || driver->start_write == NULL) {
+    return -EINVAL;
+  }
+
+  memset(async, 0, sizeof(*async));
+
+  async->idle = xSemaphoreCreateBinaryStatic(&async->idle_storage);
+  if (async->idle == NULL) {
+    return -EIO;
+  }
+
+  async->driver = driver;
+  async->ctx = ctx;
+  async->backend.api.write_iov = prv_write_iov;
+  async->backend.api.flush = prv_flush;
+  async->backend.api.panic_write = prv_panic_write;
+
+  return 0;
+}
+
+void log_async_write_done(log_async_backend_t *async) {
+  prv_write_done(async, false, NULL);
+}
+
+void log_async_write_done_isr(log_async_backend_t *async) {
+  BaseType_t higher_prio = pdFALSE;
+
+  prv_write_done(async, true, &higher_prio);
+
+  portYIELD_FROM_ISR(higher_prio);
+}
+
+uint32_t log_async_get_dropped(const log_async_backend_t *async) {
+  return async->dropped;
+}
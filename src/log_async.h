@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_async.h
+ * @author Evan Stoddard
+ * @brief Double buffered backend for sinks with asynchronous writes
+ */
+
+#ifndef log_async_h
+#define log_async_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+#include "log_backend.h"
+#include "log_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_async_driver_t
+ * @brief Sink driver used by an async backend
+ *
+ */
+typedef struct log_async_driver_t {
+  /**
+   * @brief Start writing buffer and return without waiting
+   *
+   * The driver reports completion through log_async_write_done or
+   * log_async_write_done_isr.  May be called from that completion, so it
+   * must be safe in the context the driver completes from.
+   *
+   * @param ctx Driver context
+   * @param buf Data to write, untouched until completion is reported
+   * @param len Number of bytes
+   * @return 0 if the write was started, non-zero on error
+   */
+  int (*start_write)(void *ctx, const uint8_t *buf, size_t len);
+
+  /**
+   * @brief Write buffer by polling, used by log_panic (optional)
+   *
+   * @param ctx Driver context
+   * @param buf Data to write
+   * @param len Number of bytes
+   */
+  void (*poll_write)(void *ctx, const uint8_t *buf, size_t len);
+} log_async_driver_t;
+
+/**
+ * @typedef log_async_backend_t
+ * @brief Backend rendering into one buffer while the driver writes the other
+ *
+ * The log thread gathers the rendered slices of each line straight into the
+ * fill buffer.  Whenever the driver is idle the fill buffer is handed to
+ * start_write and the halves swap, so a slow sink delays nothing but its own
+ * output.  Lines that do not fit while both halves are in use are dropped
+ * and counted.
+ */
+typedef struct log_async_backend_t {
+  log_backend_t backend;
+
+  const log_async_driver_t *driver;
+  void *ctx;
+
+  uint8_t buf[2][LOG_ASYNC_BUFFER_SIZE];
+  uint16_t len[2];
+  uint16_t count[2];
+  uint8_t fill;
+  volatile bool busy;
+  volatile uint32_t dropped;
+
+  // Signalled once the driver completes with nothing left to write
+  SemaphoreHandle_t idle;
+  StaticSemaphore_t idle_storage;
+
+  // Rendering for panic_write
+  char line[LOG_ASYNC_LINE_SIZE];
+} log_async_backend_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize async backend
+ *
+ * Sets up the backend's API, `layout` and the masks may be adjusted
+ * afterwards.  Register it with log_backend_register_backend.
+ *
+ * @param async Pointer to async backend
+ * @param driver Sink driver
+ * @param ctx Driver context
+ * @return 0 on success, negative error code otherwise
+ */
+int log_async_backend_init(log_async_backend_t *async,
+                           const log_async_driver_t *driver, void *ctx);
+
+/**
+ * @brief Report completion of the write started last (task context)
+ *
+ * @param async Pointer to async backend
+ */
+void log_async_write_done(log_async_backend_t *async);
+
+/**
+ * @brief Report completion of the write started last from ISR
+ *
+ * @param async Pointer to async backend
+ */
+void log_async_write_done_isr(log_async_backend_t *async);
+
+/**
+ * @brief Get number of lines dropped because both buffers were in use
+ *
+ * @param async Pointer to async backend
+ * @return Number of dropped lines
+ */
+uint32_t log_async_get_dropped(const log_async_backend_t *async);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_async_h */
@@ -12,22 +12,182 @@
 
 #include <errno.h>
 #include <stddef.h>
+#include <string.h>
+
+// FreeRTOS includes
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "log_pool.h"
 
 /*****************************************************************************
  * Definitions
  *****************************************************************************/
 
+/** @brief Queue entry asking a worker to flush its backend */
+#define LOG_BACKEND_WORKER_FLUSH NULL
+
 /*****************************************************************************
  * Variables
  *****************************************************************************/
 
 /**
  * @brief Private instance
+ *
+ * The log thread holds the lock while dispatching, so a backend is never
+ * unlinked or deinitialized in the middle of processing a message.
  */
 static struct {
   log_backend_t *head;
+  log_backend_t *tail;
+  SemaphoreHandle_t lock;
+  StaticSemaphore_t lock_storage;
 } prv_inst;
 
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Take registry lock, creating it on first use
+ *
+ */
+static void prv_lock(void) {
+  if (prv_inst.lock == NULL) {
+    taskENTER_CRITICAL();
+    if (prv_inst.lock == NULL) {
+      prv_inst.lock = xSemaphoreCreateMutexStatic(&prv_inst.lock_storage);
+    }
+    taskEXIT_CRITICAL();
+  }
+
+  xSemaphoreTake(prv_inst.lock, portMAX_DELAY);
+}
+
+/**
+ * @brief Release registry lock
+ *
+ */
+static void prv_unlock(void) { xSemaphoreGive(prv_inst.lock); }
+
+/**
+ * @brief Hand message to backend's process_msg or write_iov
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_process(const log_backend_t *backend, const log_msg_t *msg) {
+  if (backend->api.process_msg) {
+    backend->api.process_msg(backend, msg);
+    return;
+  }
+
+  log_iov_t iov[LOG_RENDER_IOV_MAX];
+  char scratch[LOG_RENDER_IOV_SCRATCH_SIZE];
+
+  int cnt = log_render_msg_iov(msg, backend->layout, iov, LOG_RENDER_IOV_MAX,
+                               scratch, sizeof(scratch));
+  if (cnt > 0) {
+    backend->api.write_iov(backend, iov, cnt);
+  }
+}
+
+/**
+ * @brief Worker task, processes and releases queued messages
+ *
+ * @param args Backend served by the worker
+ */
+static void prv_worker_task(void *args) {
+  log_backend_t *backend = args;
+  log_backend_worker_t *worker = backend->worker;
+  log_msg_t *msg;
+
+  while (true) {
+    if (xQueueReceive(worker->queue, &msg, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    if (msg == LOG_BACKEND_WORKER_FLUSH) {
+      worker->flush_result =
+          backend->api.flush
+              ? backend->api.flush(backend, worker->flush_timeout_ms)
+              : 0;
+      xSemaphoreGive(worker->done);
+      continue;
+    }
+
+    if (backend->enabled) {
+      prv_process(backend, msg);
+    }
+
+    log_pool_free(msg);
+  }
+}
+
+/**
+ * @brief Get reference to message that can be handed to workers
+ *
+ * @param msg Message being dispatched
+ * @return Pool message holding a reference for the caller, or NULL
+ */
+static log_msg_t *prv_share(const log_msg_t *msg) {
+  if (log_pool_owns(msg)) {
+    log_msg_t *shared = (log_msg_t *)msg;
+    return log_pool_retain(shared) == 0 ? shared : NULL;
+  }
+
+  // Summaries and events live in static buffers reused by the log thread
+  log_msg_t *copy = log_pool_alloc(msg->args_buffer_size);
+  if (copy) {
+    memcpy(copy, msg, LOG_MSG_SIZE(msg->args_buffer_size));
+  }
+
+  return copy;
+}
+
+/**
+ * @brief Queue reference to message for worker
+ *
+ * @param worker Pointer to worker
+ * @param msg Pool message
+ */
+static void prv_worker_post(log_backend_worker_t *worker, log_msg_t *msg) {
+  if (msg == NULL || log_pool_retain(msg) != 0) {
+    worker->dropped++;
+    return;
+  }
+
+  if (xQueueSend(worker->queue, &msg, 0) != pdTRUE) {
+    log_pool_free(msg);
+    worker->dropped++;
+  }
+}
+
+/**
+ * @brief Wait for worker to process everything queued and flush backend
+ *
+ * @param worker Pointer to worker
+ * @param timeout Ticks to wait
+ * @param timeout_ms Time the backend's flush may take
+ * @return Result of the backend's flush, or -ETIMEDOUT
+ */
+static int prv_worker_sync(log_backend_worker_t *worker, TickType_t timeout,
+                           uint32_t timeout_ms) {
+  log_msg_t *marker = LOG_BACKEND_WORKER_FLUSH;
+
+  // Drop completion of an earlier request that timed out
+  xSemaphoreTake(worker->done, 0);
+  worker->flush_timeout_ms = timeout_ms;
+
+  if (xQueueSend(worker->queue, &marker, timeout) != pdTRUE ||
+      xSemaphoreTake(worker->done, timeout) != pdTRUE) {
+    return -ETIMEDOUT;
+  }
+
+  return worker->flush_result;
+}
+
 /*****************************************************************************
  * Functions
  *****************************************************************************/
@@ -37,22 +197,289 @@ int log_backend_register_backend(log_backend_t *backend) {
     return -EINVAL;
   }
 
-  if (prv_inst.head == NULL) {
+  // Claimed under the lock so concurrent calls cannot both link it
+  prv_lock();
+  bool registered = backend->registered;
+  backend->registered = true;
+  prv_unlock();
+
+  if (registered) {
+    return -EALREADY;
+  }
+
+  if (backend->api.init) {
+    int ret = backend->api.init(backend);
+    if (ret != 0) {
+      prv_lock();
+      backend->registered = false;
+      prv_unlock();
+      return ret;
+    }
+  }
+
+  prv_lock();
+
+  backend->next = NULL;
+  if (prv_inst.tail) {
+    prv_inst.tail->next = backend;
+  } else {
     prv_inst.head = backend;
-    prv_inst.head->next = NULL;
   }
+  prv_inst.tail = backend;
+  backend->enabled = true;
+
+  prv_unlock();
+
+  return 0;
+}
+
+int log_backend_start_worker(log_backend_t *backend,
+                             log_backend_worker_t *worker, const char *name,
+                             UBaseType_t priority, UBaseType_t core_mask) {
+  if (backend == NULL || worker == NULL) {
+    return -EINVAL;
+  }
+
+  prv_lock();
+  bool registered = backend->registered;
+  prv_unlock();
 
+  if (registered) {
+    return -EBUSY;
+  }
+
+  worker->dropped = 0;
+  worker->queue = xQueueCreateStatic(
+      LOG_BACKEND_WORKER_QUEUE_SIZE, sizeof(log_msg_t *),
+      (uint8_t *)worker->queue_buffer, &worker->queue_storage);
+  worker->done = xSemaphoreCreateBinaryStatic(&worker->done_storage);
+
+  if (worker->queue == NULL || worker->done == NULL) {
+    return -EIO;
+  }
+
+  backend->worker = worker;
+
+#if defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1) &&           \
+    defined(configUSE_CORE_AFFINITY) && (configUSE_CORE_AFFINITY == 1)
+  worker->task = xTaskCreateStaticAffinitySet(
+      prv_worker_task, name,
+      LOG_BACKEND_WORKER_STACK_SIZE_BYTES / sizeof(StackType_t), backend,
+      priority, worker->stack, &worker->task_storage, core_mask);
+#else
+  (void)core_mask;
+  worker->task = xTaskCreateStatic(
+      prv_worker_task, name,
+      LOG_BACKEND_WORKER_STACK_SIZE_BYTES / sizeof(StackType_t), backend,
+      priority, worker->stack, &worker->task_storage);
+#endif
+
+  if (worker->task == NULL) {
+    backend->worker = NULL;
+    return -EIO;
+  }
+
+  return 0;
+}
+
+int log_backend_unregister_backend(log_backend_t *backend) {
+  if (backend == NULL) {
+    return -EINVAL;
+  }
+
+  prv_lock();
+
+  log_backend_t *prev = NULL;
   log_backend_t *node = prv_inst.head;
 
-  while (node) {
-    if (node->next == NULL) {
-      node->next = backend;
-      backend->next = NULL;
+  while (node && node != backend) {
+    prev = node;
+    node = node->next;
+  }
 
-      break;
+  if (node) {
+    if (prev) {
+      prev->next = node->next;
+    } else {
+      prv_inst.head = node->next;
     }
 
-    node = node->next;
+    if (prv_inst.tail == node) {
+      prv_inst.tail = prev;
+    }
+
+    node->next = NULL;
+    node->enabled = false;
+  }
+
+  prv_unlock();
+
+  if (node == NULL) {
+    return -ENOENT;
+  }
+
+  // Worker may still be inside process_msg
+  if (backend->worker) {
+    prv_worker_sync(backend->worker, portMAX_DELAY, 0);
+  }
+
+  if (backend->api.deinit) {
+    backend->api.deinit(backend);
+  }
+
+  // Only now may it be registered again
+  prv_lock();
+  backend->registered = false;
+  prv_unlock();
+
+  return 0;
+}
+
+void log_backend_enable(log_backend_t *backend) {
+  if (backend) {
+    backend->enabled = true;
+  }
+}
+
+void log_backend_disable(log_backend_t *backend) {
+  if (backend) {
+    backend->enabled = false;
+  }
+}
+
+void log_backend_dispatch(const log_msg_t *msg) {
+  log_msg_t *shared = NULL;
+  bool shared_tried = false;
+
+  if (msg == NULL) {
+    return;
+  }
+
+  prv_lock();
+
+  for (log_backend_t *backend = prv_inst.head; backend;
+       backend = backend->next) {
+    if (!backend->enabled ||
+        (backend->api.process_msg == NULL && backend->api.write_iov == NULL) ||
+        !log_backend_accepts(backend, msg)) {
+      continue;
+    }
+
+    if (backend->worker == NULL) {
+      prv_process(backend, msg);
+      continue;
+    }
+
+    if (!shared_tried) {
+      shared = prv_share(msg);
+      shared_tried = true;
+    }
+
+    prv_worker_post(backend->worker, shared);
+  }
+
+  prv_unlock();
+
+  // Workers hold their own references
+  log_pool_free(shared);
+}
+
+int log_backend_flush_all(uint32_t timeout_ms) {
+  TickType_t start = xTaskGetTickCount();
+  TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+  int result = 0;
+
+  prv_lock();
+
+  for (log_backend_t *backend = prv_inst.head; backend;
+       backend = backend->next) {
+    if (!backend->enabled ||
+        (backend->api.flush == NULL && backend->worker == NULL)) {
+      continue;
+    }
+
+    // Every backend gets what is left of the overall timeout
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    TickType_t remaining = elapsed < timeout ? timeout - elapsed : 0;
+    uint32_t remaining_ms =
+        (uint32_t)(((uint64_t)remaining * 1000u) / configTICK_RATE_HZ);
+
+    // Worker flushes once it has caught up with its queue
+    int ret = backend->worker
+                  ? prv_worker_sync(backend->worker, remaining, remaining_ms)
+                  : backend->api.flush(backend, remaining_ms);
+    if (ret != 0 && result == 0) {
+      result = ret;
+    }
+  }
+
+  prv_unlock();
+
+  return result;
+}
+
+void log_backend_panic_write(const log_msg_t *msg) {
+  if (msg == NULL) {
+    return;
+  }
+
+  for (log_backend_t *backend = prv_inst.head; backend;
+       backend = backend->next) {
+    if (!backend->enabled || backend->api.panic_write == NULL ||
+        !log_backend_accepts(backend, msg)) {
+      continue;
+    }
+
+    backend->api.panic_write(backend, msg);
+  }
+}
+
+void log_backend_panic_drain_workers(void) {
+  log_msg_t *msg;
+
+  for (log_backend_t *backend = prv_inst.head; backend;
+       backend = backend->next) {
+    log_backend_worker_t *worker = backend->worker;
+
+    if (worker == NULL) {
+      continue;
+    }
+
+    while (xQueueReceiveFromISR(worker->queue, &msg, NULL) == pdTRUE) {
+      if (msg != LOG_BACKEND_WORKER_FLUSH && backend->enabled &&
+          backend->api.panic_write) {
+        backend->api.panic_write(backend, msg);
+      }
+    }
+  }
+}
+
+void log_backend_set_level(log_backend_t *backend, uint8_t level) {
+  if (backend == NULL) {
+    return;
+  }
+
+  // Level 0 is used by internal records and is never muted
+  uint8_t muted = 0;
+  for (uint8_t l = level + 1; l <= LOG_MSG_LEVEL_MASK; l++) {
+    muted |= (uint8_t)(1u << l);
+  }
+
+  backend->muted_levels = muted;
+}
+
+int log_backend_set_module_enabled(log_backend_t *backend, uint8_t module_id,
+                                   bool enabled) {
+  if (backend == NULL || module_id > LOG_MAX_MODULES) {
+    return -EINVAL;
+  }
+
+  uint32_t bit = 1ul << (module_id % 32);
+
+  if (enabled) {
+    backend->muted_modules[module_id / 32] &= ~bit;
+  } else {
+    backend->muted_modules[module_id / 32] |= bit;
   }
 
   return 0;
@@ -13,6 +13,18 @@
 #ifndef log_backend_h
 #define log_backend_h
 
+#include <stdbool.h>
+#include <stdint.h>
+
+// FreeRTOS includes
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+#include "log_config.h"
+#include "log_render.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -21,6 +33,12 @@ extern "C" {
  * Definitions
  *****************************************************************************/
 
+/** @brief Number of words in a backend's module bitmap, incl. overflow ID */
+#define LOG_BACKEND_MODULE_WORDS ((LOG_MAX_MODULES + 1 + 31) / 32)
+
+/** @brief Core mask letting a worker task run on any core */
+#define LOG_BACKEND_WORKER_ANY_CORE ((UBaseType_t)-1)
+
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
  *****************************************************************************/
@@ -45,30 +63,255 @@ typedef struct log_backend_api_t {
    */
   void (*process_msg)(const struct log_backend_t *backend,
                       const log_msg_t *msg);
+
+  /**
+   * @brief Write message rendered with `layout` as slices (optional)
+   *
+   * Used when process_msg is NULL.  Slices are only valid during the call.
+   *
+   * @param backend Pointer to backend instance
+   * @param iov Slices of the rendered line
+   * @param cnt Number of slices
+   */
+  void (*write_iov)(const struct log_backend_t *backend, const log_iov_t *iov,
+                    int cnt);
+
+  /**
+   * @brief Bring up backend hardware or resources (optional)
+   *
+   * Called by log_backend_register_backend before the backend is linked.
+   *
+   * @param backend Pointer to backend instance
+   * @return 0 on success, the backend is not registered otherwise
+   */
+  int (*init)(const struct log_backend_t *backend);
+
+  /**
+   * @brief Release backend hardware or resources (optional)
+   *
+   * Called by log_backend_unregister_backend after the backend is unlinked.
+   *
+   * @param backend Pointer to backend instance
+   */
+  void (*deinit)(const struct log_backend_t *backend);
+
+  /**
+   * @brief Write out anything the backend buffers (optional)
+   *
+   * @param backend Pointer to backend instance
+   * @param timeout_ms Time the backend may block
+   * @return 0 once everything is written, -ETIMEDOUT otherwise
+   */
+  int (*flush)(const struct log_backend_t *backend, uint32_t timeout_ms);
+
+  /**
+   * @brief Write message synchronously from a fault handler (optional)
+   *
+   * Must not block, allocate or use RTOS primitives, polled I/O only.
+   *
+   * @param backend Pointer to backend instance
+   * @param msg Pointer to message
+   */
+  void (*panic_write)(const struct log_backend_t *backend,
+                      const log_msg_t *msg);
 } log_backend_api_t;
 
+/**
+ * @typedef log_backend_worker_t
+ * @brief Task and queue running one backend off the log thread
+ *
+ * Messages are passed by reference, each one queued here holds a reference
+ * to the pool message until the worker has processed it.
+ */
+typedef struct log_backend_worker_t {
+  QueueHandle_t queue;
+  StaticQueue_t queue_storage;
+  log_msg_t *queue_buffer[LOG_BACKEND_WORKER_QUEUE_SIZE];
+
+  TaskHandle_t task;
+  StaticTask_t task_storage;
+  StackType_t
+      stack[LOG_BACKEND_WORKER_STACK_SIZE_BYTES / sizeof(StackType_t)];
+
+  // Flush requests, serialized by the backend registry
+  SemaphoreHandle_t done;
+  StaticSemaphore_t done_storage;
+  uint32_t flush_timeout_ms;
+  int flush_result;
+
+  volatile uint32_t dropped;
+} log_backend_worker_t;
+
 /**
  * @typedef log_backend_t
  * @brief Log backend definition
  *
+ * `layout` is the template text backends pass to log_render_msg, NULL selects
+ * LOG_RENDER_DEFAULT_LAYOUT.
+ *
+ * `muted_levels` and `muted_modules` are checked by the log thread before
+ * `process_msg` is called.  A set bit drops messages of that level or
+ * module ID, so a zero initialized backend receives everything.
+ *
+ * `worker` is set by log_backend_start_worker, NULL runs `process_msg` on
+ * the log thread.  `enabled`, `registered` and `next` are managed by the
+ * registry.
  */
 typedef struct log_backend_t {
   log_backend_api_t api;
+  const char *layout;
+  uint8_t muted_levels;
+  uint32_t muted_modules[LOG_BACKEND_MODULE_WORDS];
+  log_backend_worker_t *worker;
+  volatile bool enabled;
+  bool registered;
   struct log_backend_t *next;
 } log_backend_t;
 
+/*****************************************************************************
+ * Inline Functions
+ *****************************************************************************/
+
+/**
+ * @brief Check backend's level and module masks
+ *
+ * Internal records without a level or module always pass.
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ * @return true if message should be passed to the backend
+ */
+static inline bool log_backend_accepts(const log_backend_t *backend,
+                                       const log_msg_t *msg) {
+  uint8_t level = LOG_MSG_GET_LEVEL(msg);
+  uint8_t module_id = msg->module_id;
+
+  if (backend->muted_levels & (1u << level)) {
+    return false;
+  }
+
+  if (module_id <= LOG_MAX_MODULES &&
+      (backend->muted_modules[module_id / 32] & (1ul << (module_id % 32)))) {
+    return false;
+  }
+
+  return true;
+}
+
 /*****************************************************************************
  * Function Prototypes
  *****************************************************************************/
 
 /**
- * @brief Register backend with logging system
+ * @brief Register backend with logging system (task context)
+ *
+ * Calls the backend's init, then appends it to the list in constant time.
+ * Safe while the log thread is running.  The backend starts out enabled.
  *
  * @param backend Pointer to backend
- * @return Returns 0 on success
+ * @return 0 on success, -EALREADY if already registered, or init's error
  */
 int log_backend_register_backend(log_backend_t *backend);
 
+/**
+ * @brief Run backend in its own task instead of on the log thread
+ *
+ * The log thread then only queues a reference to each message, so a slow
+ * backend no longer delays the others.  Messages that arrive while the
+ * worker's queue is full are dropped and counted.  Call before registering.
+ *
+ * @param backend Pointer to backend
+ * @param worker Storage for the worker's task and queue
+ * @param name Task name
+ * @param priority Task priority
+ * @param core_mask Cores the task may run on, LOG_BACKEND_WORKER_ANY_CORE
+ *                  for any (ignored without SMP core affinity)
+ * @return 0 on success, -EBUSY if the backend is registered, -EIO if the
+ *         task or queue could not be created
+ */
+int log_backend_start_worker(log_backend_t *backend,
+                             log_backend_worker_t *worker, const char *name,
+                             UBaseType_t priority, UBaseType_t core_mask);
+
+/**
+ * @brief Remove backend from logging system (task context)
+ *
+ * Waits for a message being dispatched to finish, then calls deinit.  A
+ * worker backend's queue is drained first.  Must not be called from a
+ * backend's own callbacks.
+ *
+ * @param backend Pointer to backend
+ * @return 0 on success, -ENOENT if backend is not registered
+ */
+int log_backend_unregister_backend(log_backend_t *backend);
+
+/**
+ * @brief Resume passing messages to backend
+ *
+ * @param backend Pointer to backend
+ */
+void log_backend_enable(log_backend_t *backend);
+
+/**
+ * @brief Stop passing messages to backend, it stays registered
+ *
+ * @param backend Pointer to backend
+ */
+void log_backend_disable(log_backend_t *backend);
+
+/**
+ * @brief Pass message to every enabled backend that accepts it (log thread)
+ *
+ * Worker backends receive a reference to the message, messages outside the
+ * pool are copied into it first.  The caller keeps its own reference.
+ *
+ * @param msg Pointer to message
+ */
+void log_backend_dispatch(const log_msg_t *msg);
+
+/**
+ * @brief Flush every enabled backend (log thread or log_flush)
+ *
+ * @param timeout_ms Time all backends together may take
+ * @return 0 on success, first error reported by a backend otherwise
+ */
+int log_backend_flush_all(uint32_t timeout_ms);
+
+/**
+ * @brief Write message through every backend's panic_write
+ *
+ * Takes no locks, only for fault handlers after which the system resets.
+ *
+ * @param msg Pointer to message
+ */
+void log_backend_panic_write(const log_msg_t *msg);
+
+/**
+ * @brief Write messages still queued for workers through panic_write
+ *
+ * Takes no locks, call before handing newer messages to panic_write.
+ */
+void log_backend_panic_drain_workers(void);
+
+/**
+ * @brief Drop messages more verbose than level
+ *
+ * @param backend Pointer to backend
+ * @param level Most verbose level the backend receives, e.g. LOG_LEVEL_WARNING
+ */
+void log_backend_set_level(log_backend_t *backend, uint8_t level);
+
+/**
+ * @brief Enable or disable messages of a module for backend
+ *
+ * @param backend Pointer to backend
+ * @param module_id Module ID, see log_module_get
+ * @param enabled True to pass the module's messages to the backend
+ * @return 0 on success, -EINVAL if module ID is out of range
+ */
+int log_backend_set_module_enabled(log_backend_t *backend, uint8_t module_id,
+                                   bool enabled);
+
 /**
  * @brief Returns head of log backends linked list
  *
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_binary.c
+ * @author Evan Stoddard
+ * @brief COBS framed binary backend for UARTs implementation
+ */
+
+#include "log_backend_binary.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "log_callsite.h"
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Write encoded frame
+ *
+ * @param binary Pointer to binary backend
+ * @param len Size of the encoded frame
+ * @param panic True to write by polling from log_panic
+ * @return true if the frame was accepted
+ */
+static bool prv_send(log_backend_binary_t *binary, size_t len, bool panic) {
+  log_async_backend_t *async = &binary->async;
+
+  if (len == 0) {
+    binary->oversized++;
+    return false;
+  }
+
+  if (panic) {
+    if (async->driver->poll_write) {
+      async->driver->poll_write(async->ctx, binary->frame, len);
+    }
+    return true;
+  }
+
+  uint32_t dropped = log_async_get_dropped(async);
+  log_iov_t iov = {.base = binary->frame, .len = len};
+
+  async->backend.api.write_iov(&async->backend, &iov, 1);
+
+  return log_async_get_dropped(async) == dropped;
+}
+
+/**
+ * @brief Send callsite record ahead of the callsite's first message
+ *
+ * @param binary Pointer to binary backend
+ * @param id Callsite ID
+ * @param panic True to write by polling from log_panic
+ */
+static void prv_announce(log_backend_binary_t *binary, uint16_t id,
+                         bool panic) {
+  uint32_t bit = 1ul << (id % 32);
+
+  if (id >= LOG_MAX_CALLSITES || (binary->announced[id / 32] & bit)) {
+    return;
+  }
+
+  const log_callsite_t *callsite = log_callsite_get(id);
+  if (callsite == NULL) {
+    return;
+  }
+
+  size_t len = log_binary_frame_callsite(callsite, id, binary->frame);
+
+  // Retried with the next message if the transmit buffer was full
+  if (prv_send(binary, len, panic)) {
+    binary->announced[id / 32] |= bit;
+  }
+}
+
+/**
+ * @brief Send message as raw record
+ *
+ * @param binary Pointer to binary backend
+ * @param msg Pointer to message
+ * @param panic True to write by polling from log_panic
+ */
+static void prv_write_msg(log_backend_binary_t *binary, const log_msg_t *msg,
+                          bool panic) {
+  if (msg->callsite_id < LOG_CALLSITE_ID_RESERVED_START) {
+    prv_announce(binary, msg->callsite_id, panic);
+  }
+
+#if LOG_BINARY_DELTA_ENABLE
+  // Panic frames stay self-contained, the log thread may be mid-encode
+  if (!panic) {
+    // Lets a host that lost frames pick up again
+    if (++binary->delta_frames >= LOG_BINARY_DELTA_REFRESH) {
+      log_delta_reset(&binary->delta);
+      binary->delta_frames = 0;
+    }
+
+    size_t len = log_binary_frame_delta(&binary->delta, msg, binary->frame);
+
+    // The host never sees the record the encoder now refers to
+    if (!prv_send(binary, len, false)) {
+      log_delta_reset(&binary->delta);
+    }
+    return;
+  }
+#endif
+
+  prv_send(binary, log_binary_frame_msg(msg, binary->frame), panic);
+}
+
+/**
+ * @brief Backend process_msg
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_process_msg(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  prv_write_msg((log_backend_binary_t *)backend, msg, false);
+}
+
+/**
+ * @brief Backend panic_write
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_panic_write(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  log_backend_binary_t *binary = (log_backend_binary_t *)backend;
+  log_async_backend_t *async = &binary->async;
+
+  // Frames waiting behind the in-flight write would otherwise be lost
+  uint8_t fill = async->fill;
+  if (async->len[fill] > 0 && async->driver->poll_write) {
+    async->driver->poll_write(async->ctx, async->buf[fill], async->len[fill]);
+    async->len[fill] = 0;
+  }
+
+  prv_write_msg(binary, msg, true);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_backend_binary_init(log_backend_binary_t *binary,
+                            const log_async_driver_t *driver, void *ctx) {
+  if (binary == NULL) {
+    return -EINVAL;
+  }
+
+  int ret = log_async_backend_init(&binary->async, driver, ctx);
+  if (ret != 0) {
+    return ret;
+  }
+
+  memset(binary->announced, 0, sizeof(binary->announced));
+  binary->oversized = 0;
+
+#if LOG_BINARY_DELTA_ENABLE
+  log_delta_reset(&binary->delta);
+  binary->delta_frames = 0;
+#endif
+
+  // process_msg takes precedence over the async backend's write_iov
+  binary->async.backend.api.process_msg = prv_process_msg;
+  binary->async.backend.api.panic_write = prv_panic_write;
+
+  return 0;
+}
+
+void log_backend_binary_reannounce(log_backend_binary_t *binary) {
+  if (binary == NULL) {
+    return;
+  }
+
+  memset(binary->announced, 0, sizeof(binary->announced));
+
+#if LOG_BINARY_DELTA_ENABLE
+  log_delta_reset(&binary->delta);
+  binary->delta_frames = 0;
+#endif
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_binary.h
+ * @author Evan Stoddard
+ * @brief COBS framed binary backend for UARTs
+ */
+
+#ifndef log_backend_binary_h
+#define log_backend_binary_h
+
+#include <stdint.h>
+
+#include "log_async.h"
+#include "log_binary.h"
+#include "log_cobs.h"
+#include "log_config.h"
+#include "log_delta.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Number of words in the announced callsite bitmap */
+#define LOG_BACKEND_BINARY_CALLSITE_WORDS ((LOG_MAX_CALLSITES + 31) / 32)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_backend_binary_t
+ * @brief Binary backend, frames are written through an async backend
+ *
+ * Messages are sent as raw records without rendering, the host resolves
+ * format strings from the callsite records sent ahead of them.  With
+ * LOG_BINARY_DELTA_ENABLE they are delta encoded per callsite.  See
+ * log_binary.h for the wire format.
+ */
+typedef struct log_backend_binary_t {
+  log_async_backend_t async;
+
+  // Callsites described to the host
+  uint32_t announced[LOG_BACKEND_BINARY_CALLSITE_WORDS];
+
+  // Records that did not fit LOG_BINARY_MAX_RECORD_SIZE
+  uint32_t oversized;
+
+#if LOG_BINARY_DELTA_ENABLE
+  // Delta encoder, reset every LOG_BINARY_DELTA_REFRESH frames
+  log_delta_t delta;
+  uint32_t delta_frames;
+#endif
+
+  // Log thread side
+  uint8_t frame[LOG_BINARY_MAX_FRAME_SIZE];
+} log_backend_binary_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize binary backend
+ *
+ * Register `&binary->async.backend` with log_backend_register_backend.
+ *
+ * @param binary Pointer to binary backend
+ * @param driver Sink driver, see log_async_driver_t
+ * @param ctx Driver context
+ * @return 0 on success, negative error code otherwise
+ */
+int log_backend_binary_init(log_backend_binary_t *binary,
+                            const log_async_driver_t *driver, void *ctx);
+
+/**
+ * @brief Describe every callsite again before its next message
+ *
+ * Call when a host reader (re)connects.  Also sends the next message of
+ * every callsite in full when delta encoding is enabled.
+ *
+ * @param binary Pointer to binary backend
+ */
+void log_backend_binary_reannounce(log_backend_binary_t *binary);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_backend_binary_h */
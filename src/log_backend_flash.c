@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_flash.c
+ * @author Evan Stoddard
+ * @brief NOR flash log backend with sector rotation implementation
+ */
+
+#include "log_backend_flash.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "log_callsite.h"
+#include "log_cobs.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Size of a record in flash
+ *
+ * @param msg_size Size of the message, header included
+ */
+#define LOG_BACKEND_FLASH_RECORD_SIZE(msg_size)                                \
+  ((sizeof(log_backend_flash_record_t) + (msg_size) + 3u) & ~(size_t)3u)
+
+/** @brief Largest record in flash */
+#define LOG_BACKEND_FLASH_MAX_RECORD_SIZE                                      \
+  LOG_BACKEND_FLASH_RECORD_SIZE(LOG_FLASH_MAX_MSG_SIZE)
+
+/** @brief Record size read from an erased page */
+#define LOG_BACKEND_FLASH_ERASED 0xFFFFu
+
+/** @brief Offset of the first record byte covered by the CRC */
+#define LOG_BACKEND_FLASH_CRC_START                                            \
+  offsetof(log_backend_flash_record_t, callsite_ref)
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Get number of pages in a sector
+ *
+ * @param flash Pointer to backend
+ * @return Pages per sector
+ */
+static uint32_t prv_pages(const log_backend_flash_t *flash) {
+  return flash->geometry.sector_size / flash->geometry.page_size;
+}
+
+/**
+ * @brief Get flash address of a position
+ *
+ * @param flash Pointer to backend
+ * @param sector Sector index
+ * @param offset Offset within sector
+ * @return Address within the log area
+ */
+static uint32_t prv_addr(const log_backend_flash_t *flash, uint32_t sector,
+                         uint32_t offset) {
+  return sector * flash->geometry.sector_size + offset;
+}
+
+/**
+ * @brief Read and check sector header
+ *
+ * @param flash Pointer to backend
+ * @param sector Sector index
+ * @param header Filled with the header
+ * @return true if the sector holds log records
+ */
+static bool prv_read_sector(const log_backend_flash_t *flash, uint32_t sector,
+                            log_backend_flash_sector_t *header) {
+  if (flash->driver->read(flash->ctx, prv_addr(flash, sector, 0), header,
+                          sizeof(*header)) != 0) {
+    return false;
+  }
+
+  return header->magic == LOG_BACKEND_FLASH_MAGIC &&
+         header->check ==
+             (header->magic ^ header->sequence ^ header->build_id);
+}
+
+/**
+ * @brief Check if a page was never programmed since the last erase
+ *
+ * @param flash Pointer to backend
+ * @param sector Sector index
+ * @param page Page index, not the first page of the sector
+ * @return true if the page is erased
+ */
+static bool prv_page_erased(const log_backend_flash_t *flash, uint32_t sector,
+                            uint32_t page) {
+  uint16_t size = 0;
+
+  // Every programmed page starts with a record
+  flash->driver->read(flash->ctx,
+                      prv_addr(flash, sector, page * flash->geometry.page_size),
+                      &size, sizeof(size));
+
+  return size == LOG_BACKEND_FLASH_ERASED;
+}
+
+/**
+ * @brief Erase sector
+ *
+ * @param flash Pointer to backend
+ * @param sector Sector index
+ */
+static void prv_erase(log_backend_flash_t *flash, uint32_t sector) {
+  flash->erases++;
+
+  if (flash->driver->erase(flash->ctx, prv_addr(flash, sector, 0)) != 0) {
+    flash->errors++;
+  }
+}
+
+/**
+ * @brief Program collected page and move to the next one
+ *
+ * @param flash Pointer to backend
+ */
+static void prv_program_page(log_backend_flash_t *flash) {
+  uint32_t page_size = flash->geometry.page_size;
+
+  if (flash->page_len == 0) {
+    return;
+  }
+
+  flash->programs++;
+
+  if (flash->driver->program(
+          flash->ctx,
+          prv_addr(flash, flash->sector, flash->page * page_size),
+          flash->page_buf, page_size) != 0) {
+    flash->errors++;
+  }
+
+  memset(flash->page_buf, 0xFF, page_size);
+  flash->page_len = 0;
+  flash->page++;
+}
+
+/**
+ * @brief Start writing the next sector
+ *
+ * @param flash Pointer to backend
+ */
+static void prv_open_sector(log_backend_flash_t *flash) {
+  uint32_t sector = (flash->sector + 1) % flash->geometry.sector_count;
+
+  // Only waits for an erase when writing outran the erase ahead
+  if (flash->erased != sector) {
+    prv_erase(flash, sector);
+  }
+
+  flash->sequence++;
+
+  log_backend_flash_sector_t header = {
+      .magic = LOG_BACKEND_FLASH_MAGIC,
+      .sequence = flash->sequence,
+      .build_id = flash->build_id,
+      .check = LOG_BACKEND_FLASH_MAGIC ^ flash->sequence ^ flash->build_id,
+  };
+
+  flash->sector = sector;
+  flash->erased = LOG_BACKEND_FLASH_NO_SECTOR;
+  flash->page = 0;
+
+  memcpy(flash->page_buf, &header, sizeof(header));
+  flash->page_len = sizeof(header);
+}
+
+/**
+ * @brief Append message to the page being collected
+ *
+ * @param flash Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_append(log_backend_flash_t *flash, const log_msg_t *msg) {
+  size_t msg_size = sizeof(log_msg_t) + msg->args_buffer_size;
+
+  if (msg_size > LOG_FLASH_MAX_MSG_SIZE) {
+    flash->oversized++;
+    return;
+  }
+
+  uint32_t size = (uint32_t)LOG_BACKEND_FLASH_RECORD_SIZE(msg_size);
+
+  if (flash->page_len + size > flash->geometry.page_size) {
+    prv_program_page(flash);
+  }
+
+  if (flash->page >= prv_pages(flash)) {
+    prv_open_sector(flash);
+  }
+
+  uint8_t *dst = flash->page_buf + flash->page_len;
+  log_backend_flash_record_t record;
+
+  memset(&record, 0, sizeof(record));
+  record.size = (uint16_t)size;
+  record.callsite_ref = log_callsite_get_ref(msg->callsite_id);
+
+  memcpy(dst, &record, sizeof(record));
+  memcpy(dst + sizeof(record), msg, msg_size);
+  memset(dst + sizeof(record) + msg_size, 0,
+         size - sizeof(record) - msg_size);
+
+  record.crc = log_cobs_crc16(LOG_COBS_CRC16_INIT,
+                              dst + LOG_BACKEND_FLASH_CRC_START,
+                              size - LOG_BACKEND_FLASH_CRC_START);
+  memcpy(dst + offsetof(log_backend_flash_record_t, crc), &record.crc,
+         sizeof(record.crc));
+
+  flash->page_len += size;
+
+  // Half way through the sector, prepare the next one
+  uint32_t next = (flash->sector + 1) % flash->geometry.sector_count;
+
+  if (flash->erased != next && flash->page >= prv_pages(flash) / 2) {
+    prv_erase(flash, next);
+    flash->erased = next;
+  }
+}
+
+/**
+ * @brief Backend process_msg
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_process_msg(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  prv_append((log_backend_flash_t *)backend, msg);
+}
+
+/**
+ * @brief Backend flush, programs the partly filled page
+ *
+ * @param backend Pointer to backend
+ * @param timeout_ms Unused, programming a page does not wait for anything
+ * @return 0 on success, -EIO if the driver failed since the last flush
+ */
+static int prv_flush(const log_backend_t *backend, uint32_t timeout_ms) {
+  log_backend_flash_t *flash = (log_backend_flash_t *)backend;
+  (void)timeout_ms;
+
+  prv_program_page(flash);
+
+  uint32_t errors = flash->errors;
+  flash->errors = 0;
+
+  return errors ? -EIO : 0;
+}
+
+/**
+ * @brief Backend panic_write, each message is programmed right away
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_panic_write(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  log_backend_flash_t *flash = (log_backend_flash_t *)backend;
+
+  prv_append(flash, msg);
+  prv_program_page(flash);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_backend_flash_init(log_backend_flash_t *flash,
+                           const log_flash_driver_t *driver, void *ctx,
+                           const log_flash_geometry_t *geometry,
+                           uint32_t build_id) {
+  if (flash == NULL || driver == NULL || driver->read == NULL ||
+      driver->program == NULL || driver->erase == NULL || geometry == NULL) {
+    return -EINVAL;
+  }
+
+  // A record must fit a page next to the sector header
+  if (geometry->page_size > LOG_FLASH_MAX_PAGE_SIZE ||
+      (geometry->page_size & 3u) ||
+      geometry->page_size < sizeof(log_backend_flash_sector_t) +
+                                LOG_BACKEND_FLASH_MAX_RECORD_SIZE ||
+      geometry->sector_size % geometry->page_size != 0 ||
+      geometry->sector_size / geometry->page_size < 2 ||
+      geometry->sector_count < 2) {
+    return -EINVAL;
+  }
+
+  memset(flash, 0, sizeof(*flash));
+
+  flash->driver = driver;
+  flash->ctx = ctx;
+  flash->geometry = *geometry;
+  flash->build_id = build_id;
+  flash->erased = LOG_BACKEND_FLASH_NO_SECTOR;
+  memset(flash->page_buf, 0xFF, sizeof(flash->page_buf));
+
+  // Newest sector by sequence, the first append opens sector 0 if none
+  log_backend_flash_sector_t header;
+  uint32_t newest = LOG_BACKEND_FLASH_NO_SECTOR;
+  uint32_t newest_build_id = 0;
+
+  for (uint32_t sector = 0; sector < geometry->sector_count; sector++) {
+    if (!prv_read_sector(flash, sector, &header)) {
+      continue;
+    }
+
+    if (newest == LOG_BACKEND_FLASH_NO_SECTOR ||
+        (int32_t)(header.sequence - flash->sequence) > 0) {
+      newest = sector;
+      newest_build_id = header.build_id;
+      flash->sequence = header.sequence;
+    }
+  }
+
+  flash->sector = geometry->sector_count - 1;
+  flash->page = prv_pages(flash);
+
+  if (newest != LOG_BACKEND_FLASH_NO_SECTOR) {
+    flash->sector = newest;
+
+    // Programmed pages are a prefix of the sector, find the first erased one
+    if (newest_build_id == build_id) {
+      uint32_t lo = 1;
+      uint32_t hi = prv_pages(flash);
+
+      while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        if (prv_page_erased(flash, newest, mid)) {
+          hi = mid;
+        } else {
+          lo = mid + 1;
+        }
+      }
+
+      flash->page = lo;
+    }
+  }
+
+  // Records before this position were written by an earlier run
+  flash->run_sequence = flash->sequence;
+  flash->run_offset = flash->page * geometry->page_size;
+
+  flash->backend.api.process_msg = prv_process_msg;
+  flash->backend.api.flush = prv_flush;
+  flash->backend.api.panic_write = prv_panic_write;
+
+  return 0;
+}
+
+void log_backend_flash_read_begin(const log_backend_flash_t *flash,
+                                  log_backend_flash_cursor_t *cursor) {
+  if (flash == NULL || cursor == NULL) {
+    return;
+  }
+
+  // The sector after the write position holds the oldest records
+  cursor->sector = (flash->sector + 1) % flash->geometry.sector_count;
+  cursor->offset = 0;
+  cursor->remaining = flash->geometry.sector_count;
+}
+
+const log_msg_t *log_backend_flash_read(log_backend_flash_t *flash,
+                                        log_backend_flash_cursor_t *cursor) {
+  uint8_t buf[LOG_BACKEND_FLASH_MAX_RECORD_SIZE] __attribute__((aligned(8)));
+  log_backend_flash_record_t record;
+
+  if (flash == NULL || cursor == NULL) {
+    return NULL;
+  }
+
+  log_msg_t *msg = (log_msg_t *)flash->msg;
+
+  uint32_t page_size = flash->geometry.page_size;
+  uint32_t sector_size = flash->geometry.sector_size;
+
+  while (cursor->remaining > 0) {
+    if (cursor->offset == 0) {
+      log_backend_flash_sector_t header;
+
+      if (prv_read_sector(flash, cursor->sector, &header) &&
+          header.build_id == flash->build_id) {
+        cursor->sequence = header.sequence;
+        cursor->offset = sizeof(header);
+      } else {
+        cursor->offset = sector_size;
+      }
+    }
+
+    if (cursor->offset >= sector_size) {
+      cursor->sector = (cursor->sector + 1) % flash->geometry.sector_count;
+      cursor->offset = 0;
+      cursor->remaining--;
+      continue;
+    }
+
+    uint32_t page_off = cursor->offset % page_size;
+    uint32_t next_page = cursor->offset - page_off + page_size;
+    uint32_t addr = prv_addr(flash, cursor->sector, cursor->offset);
+
+    if (page_off + sizeof(record) > page_size ||
+        flash->driver->read(flash->ctx, addr, &record, sizeof(record)) != 0) {
+      cursor->offset = next_page;
+      continue;
+    }
+
+    // Erased rest of page, or a record that cannot be valid
+    if (record.size == LOG_BACKEND_FLASH_ERASED ||
+        record.size < sizeof(record) + sizeof(log_msg_t) ||
+        (record.size & 3u) || record.size > sizeof(buf) ||
+        page_off + record.size > page_size ||
+        flash->driver->read(flash->ctx, addr, buf, record.size) != 0) {
+      cursor->offset = next_page;
+      continue;
+    }
+
+    const log_msg_t *stored = (const log_msg_t *)(buf + sizeof(record));
+    size_t msg_size = sizeof(log_msg_t) + stored->args_buffer_size;
+
+    // Damaged records end the page, the rest of it cannot be trusted
+    if (sizeof(record) + msg_size > record.size ||
+        msg_size > LOG_FLASH_MAX_MSG_SIZE ||
+        log_cobs_crc16(LOG_COBS_CRC16_INIT, buf + LOG_BACKEND_FLASH_CRC_START,
+                       record.size - LOG_BACKEND_FLASH_CRC_START) !=
+            record.crc) {
+      cursor->offset = next_page;
+      continue;
+    }
+
+    uint32_t offset = cursor->offset;
+
+    cursor->offset += record.size;
+    memcpy(msg, stored, msg_size);
+
+    log_callsite_remap(msg, record.callsite_ref);
+
+    // `%s` arguments of an earlier run point at memory that was reused since
+    if ((int32_t)(cursor->sequence - flash->run_sequence) < 0 ||
+        (cursor->sequence == flash->run_sequence &&
+         offset < flash->run_offset)) {
+      msg->level_flags |= LOG_MSG_FLAG_STALE_STRINGS;
+    }
+
+    return msg;
+  }
+
+  return NULL;
+}
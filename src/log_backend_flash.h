@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_flash.h
+ * @author Evan Stoddard
+ * @brief NOR flash log backend with sector rotation
+ *
+ * Records are collected in RAM and programmed a page at a time.  A record
+ * never spans pages, so every programmed page starts with a record and an
+ * erased page is recognized by its first half-word.  Each sector starts with
+ * a log_backend_flash_sector_t whose sequence number orders the sectors.
+ * The sector after the one being written is erased ahead of time.  When
+ * the last sector is full, writing wraps around to the first and the
+ * oldest sector is overwritten.
+ *
+ * Record layout: log_backend_flash_record_t, followed by the raw log_msg_t
+ * and padding to a multiple of 4 bytes.  A `size` of 0xFFFF marks the
+ * erased rest of a page.
+ */
+
+#ifndef log_backend_flash_h
+#define log_backend_flash_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_backend.h"
+#include "log_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Marks a sector holding log records, "LOGF" */
+#define LOG_BACKEND_FLASH_MAGIC 0x46474F4Cu
+
+/** @brief Sector index that is not set */
+#define LOG_BACKEND_FLASH_NO_SECTOR UINT32_MAX
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_flash_geometry_t
+ * @brief Layout of the flash area used for logs
+ *
+ */
+typedef struct log_flash_geometry_t {
+  uint32_t page_size;
+  uint32_t sector_size;
+  uint32_t sector_count;
+} log_flash_geometry_t;
+
+/**
+ * @typedef log_flash_driver_t
+ * @brief NOR flash access, addresses are relative to the log area
+ *
+ * Called on the thread running the backend, see log_backend_start_worker to
+ * keep erase times off the log thread.
+ */
+typedef struct log_flash_driver_t {
+  /**
+   * @brief Read bytes
+   *
+   * @param ctx Driver context
+   * @param addr Address
+   * @param buf Output buffer
+   * @param len Number of bytes
+   * @return 0 on success, negative error code otherwise
+   */
+  int (*read)(void *ctx, uint32_t addr, void *buf, size_t len);
+
+  /**
+   * @brief Program whole page
+   *
+   * @param ctx Driver context
+   * @param addr Page aligned address
+   * @param data Page contents
+   * @param len Page size
+   * @return 0 on success, negative error code otherwise
+   */
+  int (*program)(void *ctx, uint32_t addr, const void *data, size_t len);
+
+  /**
+   * @brief Erase sector
+   *
+   * @param ctx Driver context
+   * @param addr Sector aligned address
+   * @return 0 on success, negative error code otherwise
+   */
+  int (*erase)(void *ctx, uint32_t addr);
+} log_flash_driver_t;
+
+/**
+ * @typedef log_backend_flash_sector_t
+ * @brief Header at the start of every sector in use
+ *
+ * `check` is `magic ^ sequence ^ build_id`, a header that was only partly
+ * programmed does not match.
+ */
+typedef struct log_backend_flash_sector_t {
+  uint32_t magic;
+  uint32_t sequence;
+  uint32_t build_id;
+  uint32_t check;
+} log_backend_flash_sector_t;
+
+/**
+ * @typedef log_backend_flash_record_t
+ * @brief Header of a record in flash
+ *
+ * `crc` is a CRC-16/CCITT-FALSE over the rest of the record.
+ * `callsite_ref` is the log_callsite_get_ref reference of the callsite, 0
+ * for internal records.
+ */
+typedef struct log_backend_flash_record_t {
+  uint16_t size;
+  uint16_t crc;
+  intptr_t callsite_ref;
+} log_backend_flash_record_t;
+
+/**
+ * @typedef log_backend_flash_cursor_t
+ * @brief Read position for log_backend_flash_read
+ *
+ */
+typedef struct log_backend_flash_cursor_t {
+  uint32_t sector;
+  uint32_t sequence;
+  uint32_t offset;
+  uint32_t remaining;
+} log_backend_flash_cursor_t;
+
+/**
+ * @typedef log_backend_flash_t
+ * @brief NOR flash log backend
+ *
+ */
+typedef struct log_backend_flash_t {
+  log_backend_t backend;
+
+  const log_flash_driver_t *driver;
+  void *ctx;
+  log_flash_geometry_t geometry;
+  uint32_t build_id;
+
+  // Write position
+  uint32_t sector;
+  uint32_t page;
+  uint32_t sequence;
+  uint32_t erased;
+
+  // Where this run started writing, older records are stale
+  uint32_t run_sequence;
+  uint32_t run_offset;
+
+  // Page being collected
+  uint8_t page_buf[LOG_FLASH_MAX_PAGE_SIZE];
+  uint32_t page_len;
+
+  // Statistics
+  uint32_t programs;
+  uint32_t erases;
+  uint32_t errors;
+  uint32_t oversized;
+
+  // Message handed out by log_backend_flash_read
+  uint8_t msg[LOG_FLASH_MAX_MSG_SIZE] __attribute__((aligned(8)));
+} log_backend_flash_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize backend and find the write position
+ *
+ * Only sector headers and O(log pages) page starts are read.  Writing
+ * continues after the last programmed page of the newest sector, or in a
+ * new sector if that one was written by a different build.  Register
+ * `&flash->backend` with log_backend_register_backend.
+ *
+ * @param flash Pointer to backend
+ * @param driver Flash driver
+ * @param ctx Driver context
+ * @param geometry Flash layout, at least 2 sectors
+ * @param build_id Identifies the firmware image
+ * @return 0 on success, -EINVAL on invalid arguments or geometry
+ */
+int log_backend_flash_init(log_backend_flash_t *flash,
+                           const log_flash_driver_t *driver, void *ctx,
+                           const log_flash_geometry_t *geometry,
+                           uint32_t build_id);
+
+/**
+ * @brief Start reading records, oldest first
+ *
+ * Only programmed pages are read, call log_flush() first to include
+ * records still collected in RAM.
+ *
+ * @param flash Pointer to backend
+ * @param cursor Cursor to initialize
+ */
+void log_backend_flash_read_begin(const log_backend_flash_t *flash,
+                                  log_backend_flash_cursor_t *cursor);
+
+/**
+ * @brief Read next record
+ *
+ * Records written by other builds and damaged records are skipped.
+ * Messages of an earlier run carry LOG_MSG_FLAG_STALE_STRINGS, string
+ * arguments are rendered as addresses.  Must not run concurrently with the
+ * backend writing, e.g. read before registering it.
+ *
+ * @param flash Pointer to backend
+ * @param cursor Cursor from log_backend_flash_read_begin
+ * @return Message, valid until the next call, NULL when done
+ */
+const log_msg_t *log_backend_flash_read(log_backend_flash_t *flash,
+                                        log_backend_flash_cursor_t *cursor);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_backend_flash_h */
@@ -0,0 +1,400 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_persist.c
+ * @author Evan Stoddard
+ * @brief Crash persistent RAM ring backend implementation
+ */
+
+#include "log_backend_persist.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "task.h"
+
+#include "log_cobs.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Size of a record in the ring
+ *
+ * @param msg_size Size of the message, header included
+ */
+#define LOG_BACKEND_PERSIST_RECORD_SIZE(msg_size)                              \
+  ((sizeof(log_backend_persist_record_t) + (msg_size) + 3u) & ~(size_t)3u)
+
+/** @brief Offset of the first record byte covered by the CRC */
+#define LOG_BACKEND_PERSIST_CRC_START                                          \
+  offsetof(log_backend_persist_record_t, generation)
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Read record header
+ *
+ * @param persist Pointer to backend
+ * @param off Offset of record
+ * @param record Filled with the record header
+ */
+static void prv_read_record(const log_backend_persist_t *persist, uint32_t off,
+                            log_backend_persist_record_t *record) {
+  memcpy(record, persist->ring + off, sizeof(*record));
+}
+
+/**
+ * @brief Skip wrap marker or unused tail end of the ring
+ *
+ * @param persist Pointer to backend
+ * @param off Offset of the next record
+ * @return Offset of the record, 0 if it wraps to the start
+ */
+static uint32_t prv_skip_wrap(const log_backend_persist_t *persist,
+                              uint32_t off) {
+  log_backend_persist_record_t record;
+
+  if (persist->size - off < sizeof(record)) {
+    return 0;
+  }
+
+  prv_read_record(persist, off, &record);
+
+  return record.size == 0 ? 0 : off;
+}
+
+/**
+ * @brief Compute record CRC
+ *
+ * @param persist Pointer to backend
+ * @param off Offset of record
+ * @param size Size of record
+ * @return CRC over the record past its `crc` field
+ */
+static uint16_t prv_crc(const log_backend_persist_t *persist, uint32_t off,
+                        uint32_t size) {
+  return log_cobs_crc16(LOG_COBS_CRC16_INIT,
+                        persist->ring + off + LOG_BACKEND_PERSIST_CRC_START,
+                        size - LOG_BACKEND_PERSIST_CRC_START);
+}
+
+/**
+ * @brief Check record found in the ring after a reset
+ *
+ * @param persist Pointer to backend
+ * @param off Offset of record
+ * @param end Offset the record must not cross
+ * @return Size of the record, 0 if it is damaged
+ */
+static uint32_t prv_check_record(const log_backend_persist_t *persist,
+                                 uint32_t off, uint32_t end) {
+  log_backend_persist_record_t record;
+  log_msg_t msg;
+  uint32_t avail = (end - off + persist->size) % persist->size;
+
+  prv_read_record(persist, off, &record);
+
+  if (record.size < sizeof(record) + sizeof(msg) || (record.size & 3u) ||
+      record.size >
+          LOG_BACKEND_PERSIST_RECORD_SIZE(LOG_PERSIST_MAX_MSG_SIZE) ||
+      record.size > avail || off + record.size > persist->size) {
+    return 0;
+  }
+
+  memcpy(&msg, persist->ring + off + sizeof(record), sizeof(msg));
+
+  if (sizeof(record) + sizeof(msg) + msg.args_buffer_size > record.size ||
+      prv_crc(persist, off, record.size) != record.crc) {
+    return 0;
+  }
+
+  return record.size;
+}
+
+/**
+ * @brief Walk records left by an earlier run, cut off at the first damaged
+ *
+ * @param persist Pointer to backend
+ * @return Number of intact records
+ */
+static uint32_t prv_recover(log_backend_persist_t *persist) {
+  log_backend_persist_header_t *header = persist->header;
+  uint32_t head = header->head;
+  uint32_t off = header->tail;
+  uint32_t count = 0;
+
+  while (off != head) {
+    uint32_t next = prv_skip_wrap(persist, off);
+
+    // A wrap may not jump over the write index
+    if (next != off && head > off) {
+      break;
+    }
+
+    off = next;
+    if (off == head) {
+      return count;
+    }
+
+    uint32_t size = prv_check_record(persist, off, head);
+    if (size == 0) {
+      break;
+    }
+
+    off = (off + size) % persist->size;
+    count++;
+  }
+
+  header->head = off;
+
+  return count;
+}
+
+/**
+ * @brief Drop oldest record to make room (critical section or panic)
+ *
+ * @param persist Pointer to backend
+ */
+static void prv_evict(log_backend_persist_t *persist) {
+  log_backend_persist_header_t *header = persist->header;
+  log_backend_persist_record_t record;
+  uint32_t tail = header->tail;
+
+  if (tail == header->head) {
+    return;
+  }
+
+  tail = prv_skip_wrap(persist, tail);
+
+  if (tail != header->head) {
+    prv_read_record(persist, tail, &record);
+    tail = (tail + record.size) % persist->size;
+  }
+
+  header->tail = tail;
+}
+
+/**
+ * @brief Append message to the ring
+ *
+ * A panic write takes no locks, the fault may have hit while the current
+ * task held the critical section.  The writer it interrupted never moves
+ * head, so its space is simply reused.
+ *
+ * @param persist Pointer to backend
+ * @param msg Pointer to message
+ * @param panic True if called from log_panic
+ */
+static void prv_write(log_backend_persist_t *persist, const log_msg_t *msg,
+                      bool panic) {
+  log_backend_persist_header_t *header = persist->header;
+  size_t msg_size = sizeof(log_msg_t) + msg->args_buffer_size;
+
+  if (msg_size > LOG_PERSIST_MAX_MSG_SIZE) {
+    persist->oversized++;
+    return;
+  }
+
+  uint32_t size = (uint32_t)LOG_BACKEND_PERSIST_RECORD_SIZE(msg_size);
+  uint32_t head;
+  uint32_t pad;
+
+  // Make room, the ring never fills up completely so head != tail after
+  if (!panic) {
+    taskENTER_CRITICAL();
+  }
+
+  while (true) {
+    head = header->head;
+    pad = (persist->size - head < size) ? persist->size - head : 0;
+
+    uint32_t tail = header->tail;
+    uint32_t avail = (tail == head) ? persist->size
+                                    : (tail - head + persist->size) %
+                                          persist->size;
+
+    if (avail > pad + size) {
+      break;
+    }
+
+    prv_evict(persist);
+  }
+
+  if (!panic) {
+    taskEXIT_CRITICAL();
+  }
+
+  // Readers stop at head, so the record is written before head moves
+  log_backend_persist_record_t record = {
+      .size = (uint16_t)size,
+      .crc = 0,
+      .generation = header->generation,
+      .callsite_ref = log_callsite_get_ref(msg->callsite_id),
+  };
+  uint32_t off = head;
+
+  if (pad > 0) {
+    if (pad >= sizeof(record)) {
+      memset(persist->ring + off, 0, sizeof(record));
+    }
+    off = 0;
+  }
+
+  uint8_t *dst = persist->ring + off;
+
+  memcpy(dst, &record, sizeof(record));
+  memcpy(dst + sizeof(record), msg, msg_size);
+  memset(dst + sizeof(record) + msg_size, 0,
+         size - sizeof(record) - msg_size);
+
+  record.crc = prv_crc(persist, off, size);
+  memcpy(dst + offsetof(log_backend_persist_record_t, crc), &record.crc,
+         sizeof(record.crc));
+
+  if (panic) {
+    header->head = (off + size) % persist->size;
+    return;
+  }
+
+  taskENTER_CRITICAL();
+  header->head = (off + size) % persist->size;
+  taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief Backend process_msg
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_process_msg(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  prv_write((log_backend_persist_t *)backend, msg, false);
+}
+
+/**
+ * @brief Backend panic_write, takes no locks
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_panic_write(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  prv_write((log_backend_persist_t *)backend, msg, true);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_backend_persist_init(log_backend_persist_t *persist, void *region,
+                             size_t size, uint32_t build_id) {
+  log_backend_persist_header_t *header = region;
+
+  if (persist == NULL || region == NULL || ((uintptr_t)region & 3u) ||
+      size < sizeof(*header)) {
+    return -EINVAL;
+  }
+
+  uint32_t ring_size = (uint32_t)((size - sizeof(*header)) & ~(size_t)3u);
+
+  // Room for a record even when the previous one ended just short of the end
+  if (ring_size <=
+      2 * LOG_BACKEND_PERSIST_RECORD_SIZE(LOG_PERSIST_MAX_MSG_SIZE)) {
+    return -EINVAL;
+  }
+
+  memset(persist, 0, sizeof(*persist));
+
+  persist->header = header;
+  persist->ring = (uint8_t *)region + sizeof(*header);
+  persist->size = ring_size;
+
+  bool valid = header->magic == LOG_BACKEND_PERSIST_MAGIC &&
+               header->build_id == build_id && header->size == ring_size &&
+               header->head < ring_size && header->tail < ring_size &&
+               (header->head & 3u) == 0 && (header->tail & 3u) == 0;
+
+  if (valid) {
+    persist->recovered = prv_recover(persist);
+    header->generation++;
+  } else {
+    header->size = ring_size;
+    header->build_id = build_id;
+    header->generation = 1;
+    header->head = 0;
+    header->tail = 0;
+    header->magic = LOG_BACKEND_PERSIST_MAGIC;
+  }
+
+  persist->backend.api.process_msg = prv_process_msg;
+  persist->backend.api.panic_write = prv_panic_write;
+
+  return 0;
+}
+
+const log_msg_t *log_backend_persist_next(log_backend_persist_t *persist,
+                                          uint32_t *generation) {
+  log_backend_persist_record_t record;
+
+  if (persist == NULL || persist->header == NULL) {
+    return NULL;
+  }
+
+  log_backend_persist_header_t *header = persist->header;
+  log_msg_t *msg = (log_msg_t *)persist->msg;
+
+  taskENTER_CRITICAL();
+
+  uint32_t tail = header->tail;
+
+  if (tail != header->head) {
+    tail = prv_skip_wrap(persist, tail);
+  }
+
+  if (tail == header->head) {
+    header->tail = tail;
+    taskEXIT_CRITICAL();
+    return NULL;
+  }
+
+  prv_read_record(persist, tail, &record);
+
+  const uint8_t *src = persist->ring + tail + sizeof(record);
+  memcpy(msg, src, sizeof(*msg));
+  memcpy(msg->args_buffer, src + sizeof(*msg), msg->args_buffer_size);
+
+  header->tail = (tail + record.size) % persist->size;
+
+  taskEXIT_CRITICAL();
+
+  log_callsite_remap(msg, record.callsite_ref);
+
+  // `%s` arguments of an earlier run point at memory that was reused since
+  if (record.generation != header->generation) {
+    msg->level_flags |= LOG_MSG_FLAG_STALE_STRINGS;
+  }
+
+  if (generation) {
+    *generation = record.generation;
+  }
+
+  return msg;
+}
+
+void log_backend_persist_clear(log_backend_persist_t *persist) {
+  if (persist == NULL || persist->header == NULL) {
+    return;
+  }
+
+  taskENTER_CRITICAL();
+  persist->header->tail = persist->header->head;
+  taskEXIT_CRITICAL();
+}
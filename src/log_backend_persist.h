@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_persist.h
+ * @author Evan Stoddard
+ * @brief Crash persistent RAM ring backend
+ *
+ * Messages are stored as binary records in a RAM region that is not cleared
+ * at startup, e.g. a `.noinit` section.  After a watchdog or fault reset the
+ * records written before the reset are still there and can be read back with
+ * log_backend_persist_next.
+ *
+ * Region layout: log_backend_persist_header_t, followed by the ring.  Each
+ * record is a log_backend_persist_record_t, followed by the raw log_msg_t
+ * and padding to a multiple of 4 bytes.  A record header with `size` 0, or
+ * less room than a record header before the end of the ring, wraps to the
+ * start.
+ */
+
+#ifndef log_backend_persist_h
+#define log_backend_persist_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_backend.h"
+#include "log_callsite.h"
+#include "log_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Marks an initialized region, "LOGP" */
+#define LOG_BACKEND_PERSIST_MAGIC 0x504F474Cu
+
+/** @brief Place region in the section that survives a warm reset */
+#define LOG_BACKEND_PERSIST_NOINIT __attribute__((section(".noinit")))
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_backend_persist_header_t
+ * @brief Header at the start of the persistent region
+ *
+ * `head` and `tail` are byte offsets into the ring.  The ring is empty when
+ * they are equal and is never filled completely.
+ */
+typedef struct log_backend_persist_header_t {
+  uint32_t magic;
+  uint32_t build_id;
+  uint32_t size;
+  uint32_t generation;
+  volatile uint32_t head;
+  volatile uint32_t tail;
+} log_backend_persist_header_t;
+
+/**
+ * @typedef log_backend_persist_record_t
+ * @brief Header of a record in the ring
+ *
+ * `crc` is a CRC-16/CCITT-FALSE over the rest of the record.
+ * `callsite_ref` is the log_callsite_get_ref reference used to resolve the
+ * message's callsite and module IDs again after a reset, 0 for internal
+ * records.
+ */
+typedef struct log_backend_persist_record_t {
+  uint16_t size;
+  uint16_t crc;
+  uint32_t generation;
+  intptr_t callsite_ref;
+} log_backend_persist_record_t;
+
+/**
+ * @typedef log_backend_persist_t
+ * @brief Persistent RAM ring backend
+ *
+ */
+typedef struct log_backend_persist_t {
+  log_backend_t backend;
+
+  log_backend_persist_header_t *header;
+  uint8_t *ring;
+  uint32_t size;
+
+  // Records found intact by log_backend_persist_init
+  uint32_t recovered;
+
+  // Messages larger than LOG_PERSIST_MAX_MSG_SIZE
+  uint32_t oversized;
+
+  // Message handed out by log_backend_persist_next
+  uint8_t msg[LOG_PERSIST_MAX_MSG_SIZE] __attribute__((aligned(8)));
+} log_backend_persist_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize backend over persistent region
+ *
+ * Records left in the region by an earlier run of the same build are kept
+ * and the generation is incremented, otherwise the region is formatted.
+ * The ring is checked record by record and cut off at the first damaged
+ * one.  Register `&persist->backend` with log_backend_register_backend.
+ *
+ * @param persist Pointer to backend
+ * @param region Persistent region, 4 byte aligned
+ * @param size Size of region in bytes
+ * @param build_id Identifies the firmware image, records written by a
+ * different image are discarded
+ * @return 0 on success, -EINVAL on invalid arguments
+ */
+int log_backend_persist_init(log_backend_persist_t *persist, void *region,
+                             size_t size, uint32_t build_id);
+
+/**
+ * @brief Remove oldest record from the ring
+ *
+ * Safe to call while the backend is registered.  Records of the previous
+ * run are the ones with a generation below `persist->header->generation`.
+ * Their messages carry LOG_MSG_FLAG_STALE_STRINGS, string arguments are
+ * rendered as addresses.
+ *
+ * @param persist Pointer to backend
+ * @param generation Set to the generation that wrote the record, may be
+ * NULL
+ * @return Message, valid until the next call, NULL if the ring is empty
+ */
+const log_msg_t *log_backend_persist_next(log_backend_persist_t *persist,
+                                          uint32_t *generation);
+
+/**
+ * @brief Drop every record in the ring
+ *
+ * @param persist Pointer to backend
+ */
+void log_backend_persist_clear(log_backend_persist_t *persist);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_backend_persist_h */
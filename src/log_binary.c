@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_binary.c
+ * @author Evan Stoddard
+ * @brief Encoding of binary log stream frames
+ */
+
+#include "log_binary.h"
+
+#include <string.h>
+
+#include "log_callsite.h"
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef prv_frame_t
+ * @brief Frame encoder that also tracks size and CRC of the record
+ *
+ */
+typedef struct prv_frame_t {
+  log_cobs_encoder_t enc;
+  uint16_t crc;
+  size_t size;
+} prv_frame_t;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Start frame of record type
+ *
+ * @param frame Frame being built
+ * @param out Output, LOG_BINARY_MAX_FRAME_SIZE bytes
+ * @param type Record type
+ */
+static void prv_frame_begin(prv_frame_t *frame, uint8_t *out, uint8_t type) {
+  log_cobs_begin(&frame->enc, out, LOG_BINARY_MAX_FRAME_SIZE);
+  frame->crc = LOG_COBS_CRC16_INIT;
+  frame->size = 0;
+
+  log_cobs_put(&frame->enc, &type, sizeof(type));
+  frame->crc = log_cobs_crc16(frame->crc, &type, sizeof(type));
+}
+
+/**
+ * @brief Append record bytes to frame
+ *
+ * @param frame Frame being built
+ * @param data Record bytes
+ * @param len Number of bytes
+ */
+static void prv_frame_put(prv_frame_t *frame, const void *data, size_t len) {
+  frame->size += len;
+  if (frame->size > LOG_BINARY_MAX_RECORD_SIZE) {
+    return;
+  }
+
+  log_cobs_put(&frame->enc, data, len);
+  frame->crc = log_cobs_crc16(frame->crc, data, len);
+}
+
+/**
+ * @brief Append string including its terminator to frame
+ *
+ * @param frame Frame being built
+ * @param str String, NULL is sent as an empty string
+ */
+static void prv_frame_put_str(prv_frame_t *frame, const char *str) {
+  if (str == NULL) {
+    str = "";
+  }
+
+  prv_frame_put(frame, str, strlen(str) + 1);
+}
+
+/**
+ * @brief Append CRC and terminate frame
+ *
+ * @param frame Frame being built
+ * @return Size of the encoded frame, 0 if the record was too large
+ */
+static size_t prv_frame_end(prv_frame_t *frame) {
+  if (frame->size > LOG_BINARY_MAX_RECORD_SIZE) {
+    return 0;
+  }
+
+  uint8_t crc[LOG_BINARY_CRC_SIZE] = {
+      (uint8_t)(frame->crc & 0xFF),
+      (uint8_t)(frame->crc >> 8),
+  };
+
+  log_cobs_put(&frame->enc, crc, sizeof(crc));
+
+  return log_cobs_end(&frame->enc);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+size_t log_binary_frame_msg(const log_msg_t *msg, uint8_t *frame) {
+  prv_frame_t enc;
+
+  prv_frame_begin(&enc, frame, LOG_BINARY_RECORD_MSG);
+  prv_frame_put(&enc, msg, sizeof(log_msg_t) + msg->args_buffer_size);
+
+  return prv_frame_end(&enc);
+}
+
+size_t log_binary_frame_callsite(const struct log_callsite_t *callsite,
+                                 uint16_t id, uint8_t *frame) {
+  log_binary_callsite_t record = {
+      .id = id,
+      .level = callsite->level,
+      .kv_count = callsite->kv_keys ? callsite->kv_count : 0,
+  };
+  prv_frame_t enc;
+
+  prv_frame_begin(&enc, frame, LOG_BINARY_RECORD_CALLSITE);
+  prv_frame_put(&enc, &record, sizeof(record));
+  prv_frame_put_str(&enc, callsite->module ? callsite->module->name : NULL);
+  prv_frame_put_str(&enc, callsite->function_name);
+  prv_frame_put_str(&enc, callsite->fmt_str);
+
+  for (uint8_t i = 0; i < record.kv_count; i++) {
+    prv_frame_put_str(&enc, callsite->kv_keys[i].key);
+  }
+
+  return prv_frame_end(&enc);
+}
+
+size_t log_binary_frame_delta(log_delta_t *delta, const log_msg_t *msg,
+                              uint8_t *frame) {
+  uint8_t record[LOG_BINARY_MAX_RECORD_SIZE];
+  prv_frame_t enc;
+
+  size_t len = log_delta_encode(delta, msg, record, sizeof(record));
+  if (len == 0) {
+    return log_binary_frame_msg(msg, frame);
+  }
+
+  prv_frame_begin(&enc, frame, LOG_BINARY_RECORD_DELTA);
+  prv_frame_put(&enc, record, len);
+
+  return prv_frame_end(&enc);
+}
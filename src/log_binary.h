@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_binary.h
+ * @author Evan Stoddard
+ * @brief Wire format of the COBS framed binary log stream
+ *
+ * Every frame is COBS encoded and terminated by a zero byte.  Decoded, it
+ * holds a record type byte, the record and a little endian CRC-16 over both.
+ * A receiver that loses bytes discards data up to the next zero byte and
+ * continues with the following frame.
+ *
+ * LOG_BINARY_RECORD_MSG carries a raw log_msg_t, header and argument
+ * buffer, exactly as it sits in the pool.
+ *
+ * LOG_BINARY_RECORD_CALLSITE is sent before the first message of a callsite
+ * and describes it: log_binary_callsite_t, followed by NUL terminated module
+ * name, function name and format string, followed by `kv_count` NUL
+ * terminated keys.
+ *
+ * LOG_BINARY_RECORD_DELTA carries a message as a full or delta record of
+ * log_delta.h.  The receiver resets its decoder whenever it drops a frame,
+ * delta records it then cannot resolve are skipped until the sender's next
+ * refresh.
+ */
+
+#ifndef log_binary_h
+#define log_binary_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_cobs.h"
+#include "log_config.h"
+#include "log_delta.h"
+#include "log_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Frame holds a raw log_msg_t */
+#define LOG_BINARY_RECORD_MSG 0x01
+
+/** @brief Frame describes a callsite */
+#define LOG_BINARY_RECORD_CALLSITE 0x02
+
+/** @brief Frame holds a log_delta record */
+#define LOG_BINARY_RECORD_DELTA 0x03
+
+/** @brief Size of the CRC trailing every decoded frame */
+#define LOG_BINARY_CRC_SIZE 2u
+
+/** @brief Largest encoded frame, type byte, CRC and delimiter included */
+#define LOG_BINARY_MAX_FRAME_SIZE                                              \
+  LOG_COBS_MAX_ENCODED_SIZE(1u + LOG_BINARY_MAX_RECORD_SIZE +                  \
+                            LOG_BINARY_CRC_SIZE)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_binary_callsite_t
+ * @brief Fixed part of a LOG_BINARY_RECORD_CALLSITE record
+ *
+ */
+typedef struct log_binary_callsite_t {
+  uint16_t id;
+  uint8_t level;
+  uint8_t kv_count;
+} log_binary_callsite_t;
+
+struct log_callsite_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Encode message as a LOG_BINARY_RECORD_MSG frame
+ *
+ * @param msg Pointer to message
+ * @param frame Output, LOG_BINARY_MAX_FRAME_SIZE bytes
+ * @return Size of the frame, 0 if the record exceeds
+ * LOG_BINARY_MAX_RECORD_SIZE
+ */
+size_t log_binary_frame_msg(const log_msg_t *msg, uint8_t *frame);
+
+/**
+ * @brief Encode callsite description as a LOG_BINARY_RECORD_CALLSITE frame
+ *
+ * @param callsite Pointer to callsite
+ * @param id Callsite ID
+ * @param frame Output, LOG_BINARY_MAX_FRAME_SIZE bytes
+ * @return Size of the frame, 0 if the record exceeds
+ * LOG_BINARY_MAX_RECORD_SIZE
+ */
+size_t log_binary_frame_callsite(const struct log_callsite_t *callsite,
+                                 uint16_t id, uint8_t *frame);
+
+/**
+ * @brief Encode message as a LOG_BINARY_RECORD_DELTA frame
+ *
+ * Messages the delta encoder cannot fit in LOG_BINARY_MAX_RECORD_SIZE fall
+ * back to a LOG_BINARY_RECORD_MSG frame.
+ *
+ * @param delta Pointer to encoder state
+ * @param msg Pointer to message
+ * @param frame Output, LOG_BINARY_MAX_FRAME_SIZE bytes
+ * @return Size of the frame, 0 if the record exceeds
+ * LOG_BINARY_MAX_RECORD_SIZE
+ */
+size_t log_binary_frame_delta(log_delta_t *delta, const log_msg_t *msg,
+                              uint8_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_binary_h */
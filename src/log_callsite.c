@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_callsite.c
+ * @author Evan Stoddard
+ * @brief Log callsite registry implementation
+ */
+
+#include "log_callsite.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// FreeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance
+ */
+static struct {
+  const log_callsite_t *callsites[LOG_MAX_CALLSITES];
+  uint16_t count;
+} prv_inst;
+
+/** @brief Reference point of image relative callsite references */
+static const uint8_t prv_anchor;
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+uint16_t log_callsite_register(log_callsite_t *callsite) {
+  if (callsite == NULL) {
+    return LOG_CALLSITE_ID_OVERFLOW;
+  }
+
+  if (callsite->id != LOG_CALLSITE_ID_UNASSIGNED) {
+    return callsite->id;
+  }
+
+  if (callsite->module != NULL) {
+    log_module_register(callsite->module);
+  }
+
+  uint16_t id = LOG_CALLSITE_ID_OVERFLOW;
+  UBaseType_t saved_isr_state = 0;
+  bool in_isr = xPortIsInsideInterrupt();
+
+  if (in_isr) {
+    saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+  } else {
+    taskENTER_CRITICAL();
+  }
+
+  // Re-check under lock, callsite may have been registered concurrently
+  if (callsite->id != LOG_CALLSITE_ID_UNASSIGNED) {
+    id = callsite->id;
+  } else if (prv_inst.count < LOG_MAX_CALLSITES) {
+    id = prv_inst.count;
+    prv_inst.callsites[prv_inst.count++] = callsite;
+    callsite->id = id;
+  } else {
+    // Remember overflow so later calls fail fast without locking
+    callsite->id = id;
+  }
+
+  if (in_isr) {
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskEXIT_CRITICAL();
+  }
+
+  return id;
+}
+
+const log_callsite_t *log_callsite_get(uint16_t id) {
+  if (id >= prv_inst.count) {
+    return NULL;
+  }
+
+  return prv_inst.callsites[id];
+}
+
+uint16_t log_callsite_get_count(void) { return prv_inst.count; }
+
+intptr_t log_callsite_get_ref(uint16_t id) {
+  const log_callsite_t *callsite = log_callsite_get(id);
+
+  if (callsite == NULL) {
+    return 0;
+  }
+
+  return (intptr_t)((uintptr_t)callsite - (uintptr_t)&prv_anchor);
+}
+
+uint16_t log_callsite_resolve_ref(intptr_t ref) {
+  if (ref == 0) {
+    return LOG_CALLSITE_ID_OVERFLOW;
+  }
+
+  return log_callsite_register(
+      (log_callsite_t *)((uintptr_t)&prv_anchor + (uintptr_t)ref));
+}
+
+void log_callsite_remap(log_msg_t *msg, intptr_t ref) {
+  if (msg == NULL || ref == 0) {
+    return;
+  }
+
+  msg->callsite_id = log_callsite_resolve_ref(ref);
+
+  const log_callsite_t *callsite = log_callsite_get(msg->callsite_id);
+  msg->module_id = (callsite && callsite->module) ? callsite->module->id
+                                                  : LOG_MODULE_ID_UNASSIGNED;
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_callsite.h
+ * @author Evan Stoddard
+ * @brief Log callsite registry
+ */
+
+#ifndef log_callsite_h
+#define log_callsite_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_config.h"
+#include "log_kv.h"
+#include "log_module.h"
+#include "log_msg.h"
+#include "log_ratelimit.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief ID of a callsite that has not been registered yet */
+#define LOG_CALLSITE_ID_UNASSIGNED 0xFFFF
+
+/** @brief ID returned when the callsite table is full */
+#define LOG_CALLSITE_ID_OVERFLOW 0xFFFE
+
+/** @brief First ID reserved for internal records without a callsite */
+#define LOG_CALLSITE_ID_RESERVED_START 0xFFF0
+
+/** @brief Internal record carrying a log_timestamp_sync_t payload */
+#define LOG_CALLSITE_ID_SYNC 0xFFF0
+
+/** @brief Internal record carrying a uint32_t repeat count */
+#define LOG_CALLSITE_ID_REPEAT 0xFFF1
+
+/** @brief Internal record carrying a log_event_payload_t */
+#define LOG_CALLSITE_ID_EVENT 0xFFF2
+
+/**
+ * @brief Static initializer for a callsite descriptor
+ *
+ * @param module_ptr Pointer to module descriptor
+ * @param log_level Log level of callsite
+ * @param function_name_str Function name
+ * @param fmt Format string
+ */
+#define LOG_CALLSITE_INIT(module_ptr, log_level, function_name_str, fmt)       \
+  LOG_CALLSITE_INIT_RATELIMITED(module_ptr, log_level, function_name_str, fmt, \
+                                NULL)
+
+/**
+ * @brief Static initializer for a rate limited callsite descriptor
+ *
+ * @param module_ptr Pointer to module descriptor
+ * @param log_level Log level of callsite
+ * @param function_name_str Function name
+ * @param fmt Format string
+ * @param ratelimit_ptr Pointer to rate limiter, NULL if not rate limited
+ */
+#define LOG_CALLSITE_INIT_RATELIMITED(module_ptr, log_level,                   \
+                                      function_name_str, fmt, ratelimit_ptr)   \
+  {                                                                            \
+      .fmt_str = (fmt),                                                        \
+      .function_name = (function_name_str),                                    \
+      .module = (module_ptr),                                                  \
+      .ratelimit = (ratelimit_ptr),                                            \
+      .kv_keys = NULL,                                                         \
+      .kv_count = 0,                                                           \
+      .level = (log_level),                                                    \
+      .id = LOG_CALLSITE_ID_UNASSIGNED,                                        \
+  }
+
+/**
+ * @brief Static initializer for a structured key/value callsite descriptor
+ *
+ * @param module_ptr Pointer to module descriptor
+ * @param log_level Log level of callsite
+ * @param function_name_str Function name
+ * @param event_name Event name, rendered in place of a format string
+ * @param keys Static key table
+ * @param count Number of entries in key table
+ */
+#define LOG_CALLSITE_INIT_KV(module_ptr, log_level, function_name_str,         \
+                             event_name, keys, count)                          \
+  {                                                                            \
+      .fmt_str = (event_name),                                                 \
+      .function_name = (function_name_str),                                    \
+      .module = (module_ptr),                                                  \
+      .ratelimit = NULL,                                                       \
+      .kv_keys = (keys),                                                       \
+      .kv_count = (count),                                                     \
+      .level = (log_level),                                                    \
+      .id = LOG_CALLSITE_ID_UNASSIGNED,                                        \
+  }
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_callsite_t
+ * @brief Static descriptor of a single LOG_* invocation
+ *
+ * Everything that is constant for a callsite lives here instead of in every
+ * message.  Messages only carry the compact callsite ID.  `ratelimit` is
+ * only set by the LOG_*_RATELIMITED macros, `kv_keys` only by LOG_KV_*.
+ */
+typedef struct log_callsite_t {
+  const char *fmt_str;
+  const char *function_name;
+  log_module_t *module;
+  log_ratelimit_t *ratelimit;
+  const log_kv_key_t *kv_keys;
+  uint8_t kv_count;
+  uint8_t level;
+  uint16_t id;
+} log_callsite_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Register callsite and assign it a compact ID (ISR safe)
+ *
+ * Also registers the callsite's module.  Calling this on an already
+ * registered callsite is a no-op.
+ *
+ * @param callsite Pointer to callsite descriptor
+ * @return Assigned callsite ID, or LOG_CALLSITE_ID_OVERFLOW if table is full
+ */
+uint16_t log_callsite_register(log_callsite_t *callsite);
+
+/**
+ * @brief Look up a registered callsite by ID
+ *
+ * @param id Callsite ID
+ * @return Pointer to callsite descriptor, or NULL if unknown
+ */
+const log_callsite_t *log_callsite_get(uint16_t id);
+
+/**
+ * @brief Get number of registered callsites
+ *
+ * @return Number of callsites in the registry
+ */
+uint16_t log_callsite_get_count(void);
+
+/**
+ * @brief Get image relative reference of a registered callsite
+ *
+ * Unlike the ID, which is handed out at runtime, the reference stays the
+ * same across resets of the same firmware image, also when the image is
+ * loaded at a different address.  Used by backends that keep records across
+ * resets.
+ *
+ * @param id Callsite ID
+ * @return Reference, 0 if the ID is unknown
+ */
+intptr_t log_callsite_get_ref(uint16_t id);
+
+/**
+ * @brief Resolve reference to the callsite's ID in this run
+ *
+ * Registers the callsite if it has not logged yet.  Only valid for
+ * references taken by the same firmware image.
+ *
+ * @param ref Reference from log_callsite_get_ref
+ * @return Callsite ID, or LOG_CALLSITE_ID_OVERFLOW if ref is 0 or the table
+ * is full
+ */
+uint16_t log_callsite_resolve_ref(intptr_t ref);
+
+/**
+ * @brief Map IDs of a message read back from storage to this run
+ *
+ * Callsite and module IDs are handed out at runtime, so a stored message
+ * is resolved again through the reference saved alongside it.
+ *
+ * @param msg Pointer to message, updated in place
+ * @param ref Reference from log_callsite_get_ref, 0 leaves internal records
+ * untouched
+ */
+void log_callsite_remap(log_msg_t *msg, intptr_t ref);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_callsite_h */
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_cobs.c
+ * @author Evan Stoddard
+ * @brief COBS framing and CRC-16 for binary log streams implementation
+ */
+
+#include "log_cobs.h"
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Write byte to encoder output
+ *
+ * @param enc Encoder
+ * @param byte Byte to write
+ */
+static void prv_emit(log_cobs_encoder_t *enc, uint8_t byte) {
+  if (enc->len >= enc->size) {
+    enc->overflow = true;
+    return;
+  }
+
+  enc->out[enc->len++] = byte;
+}
+
+/**
+ * @brief Close current block by writing its code byte
+ *
+ * @param enc Encoder
+ */
+static void prv_close_block(log_cobs_encoder_t *enc) {
+  if (enc->code_pos < enc->size) {
+    enc->out[enc->code_pos] = enc->code;
+  }
+
+  // Reserve code byte of the next block
+  enc->code_pos = enc->len;
+  enc->code = 1;
+  prv_emit(enc, 0);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+void log_cobs_begin(log_cobs_encoder_t *enc, uint8_t *out, size_t size) {
+  enc->out = out;
+  enc->size = size;
+  enc->len = 0;
+  enc->code_pos = 0;
+  enc->code = 1;
+  enc->overflow = false;
+
+  prv_emit(enc, 0);
+}
+
+void log_cobs_put(log_cobs_encoder_t *enc, const void *data, size_t len) {
+  const uint8_t *bytes = data;
+
+  for (size_t i = 0; i < len; i++) {
+    if (bytes[i] == LOG_COBS_DELIMITER) {
+      prv_close_block(enc);
+      continue;
+    }
+
+    prv_emit(enc, bytes[i]);
+    enc->code++;
+
+    // Block of 254 data bytes ends without an implied zero
+    if (enc->code == 0xFF) {
+      prv_close_block(enc);
+    }
+  }
+}
+
+size_t log_cobs_end(log_cobs_encoder_t *enc) {
+  if (enc->code_pos < enc->size) {
+    enc->out[enc->code_pos] = enc->code;
+  }
+
+  prv_emit(enc, LOG_COBS_DELIMITER);
+
+  return enc->overflow ? 0 : enc->len;
+}
+
+int log_cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t pos = 0;
+  size_t out_len = 0;
+
+  while (pos < len) {
+    uint8_t code = in[pos++];
+
+    if (code == LOG_COBS_DELIMITER || pos + code - 1 > len) {
+      return -1;
+    }
+
+    for (uint8_t i = 1; i < code; i++) {
+      out[out_len++] = in[pos++];
+    }
+
+    // Every block but a full one and the last stands for a zero
+    if (code != 0xFF && pos < len) {
+      out[out_len++] = 0;
+    }
+  }
+
+  return (int)out_len;
+}
+
+uint16_t log_cobs_crc16(uint16_t crc, const void *data, size_t len) {
+  const uint8_t *bytes = data;
+
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)(bytes[i] << 8);
+
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                           : (uint16_t)(crc << 1);
+    }
+  }
+
+  return crc;
+}
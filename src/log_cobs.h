@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_cobs.h
+ * @author Evan Stoddard
+ * @brief COBS framing and CRC-16 for binary log streams
+ */
+
+#ifndef log_cobs_h
+#define log_cobs_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Byte terminating every frame, never appears inside one */
+#define LOG_COBS_DELIMITER 0x00
+
+/** @brief Initial value of log_cobs_crc16 (CRC-16/CCITT-FALSE) */
+#define LOG_COBS_CRC16_INIT 0xFFFF
+
+/**
+ * @brief Worst case encoded size of a payload, including the delimiter
+ *
+ * @param len Payload size in bytes
+ */
+#define LOG_COBS_MAX_ENCODED_SIZE(len) ((len) + (len) / 254u + 2u)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_cobs_encoder_t
+ * @brief Incremental encoder, a frame can be fed in pieces
+ *
+ */
+typedef struct log_cobs_encoder_t {
+  uint8_t *out;
+  size_t size;
+  size_t len;
+  size_t code_pos;
+  uint8_t code;
+  bool overflow;
+} log_cobs_encoder_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Start encoding a frame
+ *
+ * @param enc Encoder
+ * @param out Output buffer
+ * @param size Size of output buffer
+ */
+void log_cobs_begin(log_cobs_encoder_t *enc, uint8_t *out, size_t size);
+
+/**
+ * @brief Append payload bytes to frame
+ *
+ * @param enc Encoder
+ * @param data Payload bytes
+ * @param len Number of bytes
+ */
+void log_cobs_put(log_cobs_encoder_t *enc, const void *data, size_t len);
+
+/**
+ * @brief Finish frame and append the delimiter
+ *
+ * @param enc Encoder
+ * @return Size of the encoded frame, 0 if the output buffer was too small
+ */
+size_t log_cobs_end(log_cobs_encoder_t *enc);
+
+/**
+ * @brief Decode frame received without its delimiter
+ *
+ * May decode in place, `out` equal to `in`.
+ *
+ * @param in Encoded frame
+ * @param len Size of encoded frame
+ * @param out Output buffer, at least `len` bytes
+ * @return Size of the payload, or -1 if the frame is malformed
+ */
+int log_cobs_decode(const uint8_t *in, size_t len, uint8_t *out);
+
+/**
+ * @brief Update CRC-16/CCITT-FALSE
+ *
+ * @param crc Current value, LOG_COBS_CRC16_INIT for a new frame
+ * @param data Bytes to add
+ * @param len Number of bytes
+ * @return Updated CRC
+ */
+uint16_t log_cobs_crc16(uint16_t crc, const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_cobs_h */
@@ -31,6 +31,100 @@ extern "C" {
 /** @brief Logging thread priority */
 #define LOG_THREAD_PRIORITY 2
 
+/** @brief Most verbose level compiled in (LOG_LEVEL_DEBUG) */
+#define LOG_LEVEL_COMPILE_MAX 4
+
+/** @brief Maximum number of distinct modules (at most 254) */
+#define LOG_MAX_MODULES 32
+
+/** @brief Maximum number of tasks identified in message headers (< 4096) */
+#define LOG_MAX_TASKS 16
+
+/**
+ * @brief Thread local storage slot caching a task's ID, -1 to not use one
+ *
+ * Requires configNUM_THREAD_LOCAL_STORAGE_POINTERS above the index.
+ */
+#define LOG_CONTEXT_TLS_INDEX -1
+
+/** @brief ISR number stored in ISR messages, e.g. `__get_IPSR()` on Cortex-M */
+#define LOG_CONTEXT_ISR_NUMBER() 0
+
+/** @brief Maximum number of distinct LOG_* callsites (below 0xFFF0) */
+#define LOG_MAX_CALLSITES 256
+
+/** @brief Maximum number of rules in a runtime filter spec */
+#define LOG_FILTER_MAX_RULES 8
+
+/** @brief Maximum length of a runtime filter spec string */
+#define LOG_FILTER_SPEC_MAX_LEN 128
+
+/** @brief Level of modules not matched by any filter rule (LOG_LEVEL_DEBUG) */
+#define LOG_FILTER_DEFAULT_LEVEL 4
+
+/** @brief Fold consecutive identical messages into a repeat record (0/1) */
+#define LOG_DEDUP_ENABLE 0
+
+/** @brief Largest argument buffer considered for duplicate collapsing */
+#define LOG_DEDUP_MAX_ARGS_SIZE 64
+
+/** @brief Idle time after which a pending repeat record is emitted */
+#define LOG_DEDUP_FLUSH_MS 1000
+
+/** @brief Level of trace span records (LOG_LEVEL_DEBUG) */
+#define LOG_SPAN_LEVEL 4
+
+/** @brief Enable LOG_EVENT counter/marker events (0/1) */
+#define LOG_EVENT_ENABLE 1
+
+/** @brief Number of slots in the event ring (power of two) */
+#define LOG_EVENT_RING_SIZE 64
+
+/** @brief Time the first event in the ring waits to be drained */
+#define LOG_EVENT_FLUSH_MS 100
+
+/** @brief Number of callsite slots in a delta encoder cache */
+#define LOG_DELTA_CACHE_SIZE 8
+
+/** @brief Largest argument buffer that is delta encoded */
+#define LOG_DELTA_MAX_ARGS_SIZE 32
+
+/** @brief Slices a message is rendered into for write_iov backends */
+#define LOG_RENDER_IOV_MAX 16
+
+/** @brief Buffer for generated text of one write_iov message */
+#define LOG_RENDER_IOV_SCRATCH_SIZE 128
+
+/** @brief Messages a backend worker task can have outstanding */
+#define LOG_BACKEND_WORKER_QUEUE_SIZE 8
+
+/** @brief Stack size of a backend worker task, renders like the log thread */
+#define LOG_BACKEND_WORKER_STACK_SIZE_BYTES 2048
+
+/** @brief Size of each half of an async backend's double buffer */
+#define LOG_ASYNC_BUFFER_SIZE 512
+
+/** @brief Longest line an async backend writes from log_panic */
+#define LOG_ASYNC_LINE_SIZE 160
+
+/** @brief Largest record, before framing, the binary backend sends */
+#define LOG_BINARY_MAX_RECORD_SIZE 256
+
+/** @brief Delta encode messages sent by the binary backend (0/1) */
+#define LOG_BINARY_DELTA_ENABLE 0
+
+/** @brief Delta frames after which every callsite is sent in full again */
+#define LOG_BINARY_DELTA_REFRESH 64
+
+/** @brief Largest message, header included, the persistent backend stores */
+#define LOG_PERSIST_MAX_MSG_SIZE 128
+
+/** @brief Largest flash page size the flash backend supports */
+#define LOG_FLASH_MAX_PAGE_SIZE 256
+
+/** @brief Largest message, header included, the flash backend stores */
+#define LOG_FLASH_MAX_MSG_SIZE 128
+
 #ifdef __cplusplus
 }
 #endif
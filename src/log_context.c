@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_context.c
+ * @author Evan Stoddard
+ * @brief Capture of the calling task, ISR and core implementation
+ */
+
+#include "log_context.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// FreeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Highest task ID, IDs of a reused slot advance by LOG_MAX_TASKS */
+#define LOG_CONTEXT_TASK_ID_MAX                                                \
+  ((LOG_CONTEXT_ID_MASK / LOG_MAX_TASKS) * LOG_MAX_TASKS)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance
+ *
+ * Slots are written under the critical section, ID and name before the
+ * handle, and the count is bumped last.  A task only ever looks up its own
+ * handle, so the lookup can scan without holding the critical section.
+ * Deleted tasks leave a NULL handle behind, their ID and name stay valid
+ * until the slot is reused under a new ID.
+ */
+static struct {
+  TaskHandle_t tasks[LOG_MAX_TASKS];
+  uint16_t ids[LOG_MAX_TASKS];
+  char names[LOG_MAX_TASKS][configMAX_TASK_NAME_LEN];
+  volatile uint8_t count;
+} prv_inst;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Find registered task
+ *
+ * @param task Task handle
+ * @param count Number of entries to scan
+ * @return Task ID, or LOG_CONTEXT_TASK_ID_UNKNOWN if not found
+ */
+static uint16_t prv_find_task(TaskHandle_t task, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    if (prv_inst.tasks[i] == task) {
+      return prv_inst.ids[i];
+    }
+  }
+
+  return LOG_CONTEXT_TASK_ID_UNKNOWN;
+}
+
+/**
+ * @brief Find slot for a new task (critical section)
+ *
+ * Unused slots are taken first so names of deleted tasks last as long as
+ * possible.
+ *
+ * @return Slot index, or LOG_MAX_TASKS if every slot holds a live task
+ */
+static uint8_t prv_alloc_slot(void) {
+  if (prv_inst.count < LOG_MAX_TASKS) {
+    return prv_inst.count;
+  }
+
+  for (uint8_t i = 0; i < LOG_MAX_TASKS; i++) {
+    if (prv_inst.tasks[i] == NULL) {
+      return i;
+    }
+  }
+
+  return LOG_MAX_TASKS;
+}
+
+/**
+ * @brief Get compact ID of the current task, registering it if needed
+ *
+ * @return Task ID, or LOG_CONTEXT_TASK_ID_UNKNOWN if the table is full
+ */
+static uint16_t prv_task_id(void) {
+  TaskHandle_t task = xTaskGetCurrentTaskHandle();
+  if (task == NULL) {
+    return LOG_CONTEXT_TASK_ID_UNKNOWN;
+  }
+
+#if LOG_CONTEXT_TLS_INDEX >= 0
+  uintptr_t cached = (uintptr_t)pvTaskGetThreadLocalStoragePointer(
+      NULL, LOG_CONTEXT_TLS_INDEX);
+  if (cached != 0) {
+    return (uint16_t)cached;
+  }
+#endif
+
+  uint16_t id = prv_find_task(task, prv_inst.count);
+  if (id != LOG_CONTEXT_TASK_ID_UNKNOWN) {
+    return id;
+  }
+
+  // Copied now, the task may be deleted before its messages are rendered
+  char name[configMAX_TASK_NAME_LEN] = {0};
+  const char *task_name = pcTaskGetName(NULL);
+
+  if (task_name != NULL) {
+    strncpy(name, task_name, sizeof(name) - 1);
+  }
+
+  // Only the task itself registers its handle, other tasks may append
+  taskENTER_CRITICAL();
+
+  uint8_t slot = prv_alloc_slot();
+
+  if (slot < LOG_MAX_TASKS) {
+    // A reused slot gets a new ID so queued messages of the old task do not
+    // pick up the new name
+    id = prv_inst.ids[slot] + LOG_MAX_TASKS;
+    if (prv_inst.ids[slot] == LOG_CONTEXT_TASK_ID_UNKNOWN ||
+        id > LOG_CONTEXT_TASK_ID_MAX) {
+      id = (uint16_t)(slot + 1);
+    }
+
+    prv_inst.ids[slot] = id;
+    memcpy(prv_inst.names[slot], name, sizeof(name));
+    prv_inst.tasks[slot] = task;
+
+    if (slot == prv_inst.count) {
+      prv_inst.count++;
+    }
+  }
+
+  taskEXIT_CRITICAL();
+
+#if LOG_CONTEXT_TLS_INDEX >= 0
+  if (id != LOG_CONTEXT_TASK_ID_UNKNOWN) {
+    vTaskSetThreadLocalStoragePointer(NULL, LOG_CONTEXT_TLS_INDEX,
+                                      (void *)(uintptr_t)id);
+  }
+#endif
+
+  return id;
+}
+
+/**
+ * @brief Get ID of the core executing the caller
+ *
+ * @return Core ID, always 0 on single core builds
+ */
+static uint16_t prv_core_id(void) {
+#if defined(configNUMBER_OF_CORES) && (configNUMBER_OF_CORES > 1)
+  return (uint16_t)portGET_CORE_ID();
+#else
+  return 0;
+#endif
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+uint16_t log_context_capture(bool in_isr) {
+  uint16_t context = (uint16_t)((prv_core_id() & LOG_CONTEXT_CORE_MASK)
+                                << LOG_CONTEXT_CORE_SHIFT);
+
+  if (in_isr) {
+    return context | LOG_CONTEXT_ISR |
+           ((uint16_t)LOG_CONTEXT_ISR_NUMBER() & LOG_CONTEXT_ID_MASK);
+  }
+
+  return context | (prv_task_id() & LOG_CONTEXT_ID_MASK);
+}
+
+const char *log_context_task_name(uint16_t context) {
+  uint16_t id = LOG_CONTEXT_GET_ID(context);
+
+  if (LOG_CONTEXT_IS_ISR(context) || id == LOG_CONTEXT_TASK_ID_UNKNOWN) {
+    return NULL;
+  }
+
+  uint8_t slot = (uint8_t)((id - 1) % LOG_MAX_TASKS);
+
+  // Slot was reused since the message was logged
+  if (slot >= prv_inst.count || prv_inst.ids[slot] != id) {
+    return NULL;
+  }
+
+  return prv_inst.names[slot][0] != '\0' ? prv_inst.names[slot] : NULL;
+}
+
+void log_context_task_deleted(void *task) {
+  if (task == NULL) {
+    return;
+  }
+
+  // Nests inside the kernel's own critical section around the trace hook
+  taskENTER_CRITICAL();
+
+  for (uint8_t i = 0; i < prv_inst.count; i++) {
+    if (prv_inst.tasks[i] == (TaskHandle_t)task) {
+      prv_inst.tasks[i] = NULL;
+      break;
+    }
+  }
+
+  taskEXIT_CRITICAL();
+}
+
+uint8_t log_context_get_task_count(void) { return prv_inst.count; }
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_context.h
+ * @author Evan Stoddard
+ * @brief Capture of the calling task, ISR and core in the message header
+ */
+
+#ifndef log_context_h
+#define log_context_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "log_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Message was produced in interrupt context */
+#define LOG_CONTEXT_ISR 0x8000
+
+/** @brief Position of the core ID within the context */
+#define LOG_CONTEXT_CORE_SHIFT 12
+
+/** @brief Mask of the core ID after shifting */
+#define LOG_CONTEXT_CORE_MASK 0x7
+
+/** @brief Mask of the task ID, or ISR number in interrupt context */
+#define LOG_CONTEXT_ID_MASK 0x0FFF
+
+/** @brief Task ID of messages logged before a task could be identified */
+#define LOG_CONTEXT_TASK_ID_UNKNOWN 0
+
+/**
+ * @brief Check if context belongs to an ISR
+ *
+ * @param context Packed context
+ */
+#define LOG_CONTEXT_IS_ISR(context) (((context) & LOG_CONTEXT_ISR) != 0)
+
+/**
+ * @brief Get core ID of context
+ *
+ * @param context Packed context
+ */
+#define LOG_CONTEXT_GET_CORE(context)                                          \
+  (((context) >> LOG_CONTEXT_CORE_SHIFT) & LOG_CONTEXT_CORE_MASK)
+
+/**
+ * @brief Get task ID, or ISR number if LOG_CONTEXT_IS_ISR
+ *
+ * @param context Packed context
+ */
+#define LOG_CONTEXT_GET_ID(context) ((context) & LOG_CONTEXT_ID_MASK)
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Capture context of the caller
+ *
+ * In task context the current task is mapped to a compact task ID, which is
+ * registered along with the task's name on the first call from that task.
+ * In interrupt context the ISR number from LOG_CONTEXT_ISR_NUMBER is stored
+ * instead.
+ *
+ * @param in_isr True if called from ISR
+ * @return Packed context for log_msg_t::context
+ */
+uint16_t log_context_capture(bool in_isr);
+
+/**
+ * @brief Get name of the task a context refers to
+ *
+ * The name is copied when the task registers, so it stays available after
+ * the task is deleted until its registry slot is reused.
+ *
+ * @param context Packed context
+ * @return Task name, or NULL for ISRs and unknown tasks
+ */
+const char *log_context_task_name(uint16_t context);
+
+/**
+ * @brief Release the registry slot of a deleted task
+ *
+ * Hook into the kernel from FreeRTOSConfig.h so a task created later, whose
+ * TCB may sit at the same address, does not inherit the ID and so the
+ * registry does not fill up with dead tasks:
+ *
+ *   void log_context_task_deleted(void *task);
+ *   #define traceTASK_DELETE(pxTCB) log_context_task_deleted(pxTCB)
+ *
+ * @param task Handle of the task being deleted
+ */
+void log_context_task_deleted(void *task);
+
+/**
+ * @brief Get number of registry slots in use
+ *
+ * @return Number of slots, live and deleted tasks
+ */
+uint8_t log_context_get_task_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_context_h */
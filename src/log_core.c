@@ -12,58 +12,177 @@
 
 #include <errno.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
 
+#include "log_context.h"
 #include "log_format.h"
+#include "log_kv.h"
 #include "log_pool.h"
 #include "log_queue.h"
+#include "log_ratelimit.h"
+#include "log_timestamp.h"
 
 /*****************************************************************************
- * Functions
+ * Private Functions
  *****************************************************************************/
 
-int log_init(void) {
-  // Initialize buffer pool
-  if (log_pool_init() != 0) {
-    return -1;
-  }
+/**
+ * @brief Allocate message for calling context
+ *
+ * @param args_size Size needed for arguments buffer
+ * @param in_isr True if called from ISR
+ * @return Allocated log message, or NULL if insufficient space
+ */
+static log_msg_t *prv_alloc(size_t args_size, bool in_isr) {
+  return in_isr ? log_pool_alloc_from_isr(args_size)
+                : log_pool_alloc(args_size);
+}
 
-  // Initialize queue system
-  if (log_queue_init() != 0) {
-    return -2;
+/**
+ * @brief Free message for calling context
+ *
+ * @param msg Log message to free
+ * @param in_isr True if called from ISR
+ */
+static void prv_free(log_msg_t *msg, bool in_isr) {
+  if (in_isr) {
+    log_pool_free_from_isr(msg);
+  } else {
+    log_pool_free(msg);
   }
+}
 
-  log_start_thread();
+/**
+ * @brief Send message for calling context, freeing it if the queue is full
+ *
+ * @param msg Log message to queue
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ * @return 0 on success, non-zero on error
+ */
+static int prv_send(log_msg_t *msg, bool in_isr, BaseType_t *higher_prio) {
+  int ret = in_isr ? log_queue_send_from_isr(msg, higher_prio)
+                   : log_queue_send(msg);
 
-  return 0;
+  if (ret != 0) {
+    prv_free(msg, in_isr);
+  }
+
+  return ret;
 }
 
-int log_start_thread(void) { return log_queue_start_thread(); }
+/**
+ * @brief Queue time sync record
+ *
+ * @param timestamp 64-bit timestamp the record refers to
+ * @param wallclock_us Wallclock at timestamp in microseconds, 0 if unknown
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ * @return 0 on success, non-zero on error
+ */
+static int prv_queue_sync_record(uint64_t timestamp, uint64_t wallclock_us,
+                                 bool in_isr, BaseType_t *higher_prio) {
+  log_msg_t *msg = prv_alloc(sizeof(log_timestamp_sync_t), in_isr);
+  if (msg == NULL) {
+    return -ENOSPC;
+  }
 
-int log_queue_deferred_message(const char *module_name,
-                               const char *function_name, uint8_t level,
-                               const char *fmt_str, ...) {
-  if (fmt_str == NULL) {
-    return -EINVAL;
+  log_timestamp_sync_t sync = {
+      .timestamp = timestamp,
+      .wallclock_us = wallclock_us,
+      .freq_hz = log_timestamp_get_freq(),
+      .reserved = 0,
+  };
+
+  msg->callsite_id = LOG_CALLSITE_ID_SYNC;
+  msg->level_flags = LOG_LEVEL_NONE;
+  msg->module_id = LOG_MODULE_ID_UNASSIGNED;
+  msg->timestamp = (uint32_t)timestamp;
+  msg->context = log_context_capture(in_isr);
+  memcpy(msg->args_buffer, &sync, sizeof(sync));
+
+  return prv_send(msg, in_isr, higher_prio);
+}
+
+/**
+ * @brief Register callsite, allocate message and populate its header
+ *
+ * @param callsite Pointer to callsite descriptor
+ * @param args_size Size of arguments buffer
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ * @param out Set to allocated message
+ * @return 0 on success, non-zero on error
+ */
+static int prv_begin_message(log_callsite_t *callsite, size_t args_size,
+                             bool in_isr, BaseType_t *higher_prio,
+                             log_msg_t **out) {
+  uint16_t callsite_id = log_callsite_register(callsite);
+  if (callsite_id == LOG_CALLSITE_ID_OVERFLOW) {
+    return -ENOSPC; // Out of callsite slots
   }
 
-  va_list args;
-  va_start(args, fmt_str);
+  if (args_size > LOG_MSG_MAX_ARGS_SIZE) {
+    return -E2BIG;
+  }
 
-  // Calculate buffer size needed for arguments
-  size_t args_buffer_size = log_format_calculate_buffer_size(fmt_str);
+  // Let the log thread know about the new upper timestamp bits first
+  uint64_t timestamp =
+      in_isr ? log_timestamp_get_from_isr() : log_timestamp_get();
+  if (log_timestamp_epoch_changed(timestamp, in_isr)) {
+    prv_queue_sync_record(timestamp, 0, in_isr, higher_prio);
+  }
 
   // Allocate log message from buffer pool
-  log_msg_t *msg = log_pool_alloc(args_buffer_size);
+  log_msg_t *msg = prv_alloc(args_size, in_isr);
   if (msg == NULL) {
-    va_end(args);
     return -ENOSPC; // Out of buffer space
   }
 
-  // Populate the log message metadata
-  msg->module_name = module_name;
-  msg->function_name = function_name;
-  msg->log_level = level;
-  msg->fmt_str = fmt_str;
+  // Populate the log message header
+  msg->callsite_id = callsite_id;
+  msg->level_flags = callsite->level & LOG_MSG_LEVEL_MASK;
+  msg->module_id = callsite->module ? callsite->module->id : 0;
+  msg->timestamp = (uint32_t)timestamp;
+  msg->context = log_context_capture(in_isr);
+
+  *out = msg;
+
+  return 0;
+}
+
+/**
+ * @brief Pack and queue message that passed validation and rate limiting
+ *
+ * @param callsite Pointer to callsite descriptor
+ * @param suppressed Number of suppressed events to report, 0 for none
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ * @param args Variable argument list
+ * @return 0 on success, non-zero on error
+ */
+static int prv_queue_message_args(log_callsite_t *callsite,
+                                  uint32_t suppressed, bool in_isr,
+                                  BaseType_t *higher_prio, va_list args) {
+  const char *fmt_str = callsite->fmt_str;
+
+  // Calculate buffer size needed for arguments, suppression count trails
+  size_t args_buffer_size = log_format_calculate_buffer_size(fmt_str);
+  size_t trailer_size = suppressed > 0 ? sizeof(suppressed) : 0;
+
+  log_msg_t *msg = NULL;
+  int ret = prv_begin_message(callsite, args_buffer_size + trailer_size,
+                              in_isr, higher_prio, &msg);
+  if (ret != 0) {
+    return ret;
+  }
+
+  if (trailer_size > 0) {
+    msg->level_flags |= LOG_MSG_FLAG_SUPPRESSED;
+    memcpy(msg->args_buffer + args_buffer_size, &suppressed,
+           sizeof(suppressed));
+  }
 
   // Copy va_list arguments into the message's args buffer (if any)
   if (args_buffer_size > 0) {
@@ -71,13 +190,244 @@ int log_queue_deferred_message(const char *module_name,
         msg->args_buffer, args_buffer_size, fmt_str, args);
 
     if (bytes_written == 0) {
-      log_pool_free(msg);
-      va_end(args);
+      prv_free(msg, in_isr);
       return -EIO;
     }
   }
 
+  return prv_send(msg, in_isr, higher_prio);
+}
+
+/**
+ * @brief Pack and queue structured key/value message
+ *
+ * @param callsite Pointer to callsite descriptor holding the key table
+ * @param values Field values, one per key
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ * @return 0 on success, non-zero on error
+ */
+static int prv_queue_kv(log_callsite_t *callsite, const log_kv_value_t *values,
+                        bool in_isr, BaseType_t *higher_prio) {
+  if (callsite == NULL || callsite->kv_keys == NULL || values == NULL) {
+    return -EINVAL;
+  }
+
+  size_t args_buffer_size =
+      log_kv_calculate_buffer_size(callsite->kv_keys, callsite->kv_count);
+
+  log_msg_t *msg = NULL;
+  int ret = prv_begin_message(callsite, args_buffer_size, in_isr, higher_prio,
+                              &msg);
+  if (ret != 0) {
+    return ret;
+  }
+
+  msg->level_flags |= LOG_MSG_FLAG_KV;
+
+  if (log_kv_pack(msg->args_buffer, args_buffer_size, callsite->kv_keys,
+                  values, callsite->kv_count) != args_buffer_size) {
+    prv_free(msg, in_isr);
+    return -EIO;
+  }
+
+  return prv_send(msg, in_isr, higher_prio);
+}
+
+/**
+ * @brief Queue message whose arguments were packed by the caller
+ *
+ * @param callsite Pointer to callsite descriptor
+ * @param args Packed argument buffer
+ * @param args_size Size of packed argument buffer
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ * @return 0 on success, non-zero on error
+ */
+static int prv_queue_packed(log_callsite_t *callsite, const void *args,
+                            size_t args_size, bool in_isr,
+                            BaseType_t *higher_prio) {
+  if (callsite == NULL || callsite->fmt_str == NULL ||
+      (args == NULL && args_size > 0)) {
+    return -EINVAL;
+  }
+
+  log_msg_t *msg = NULL;
+  int ret = prv_begin_message(callsite, args_size, in_isr, higher_prio, &msg);
+  if (ret != 0) {
+    return ret;
+  }
+
+  if (args_size > 0) {
+    memcpy(msg->args_buffer, args, args_size);
+  }
+
+  return prv_send(msg, in_isr, higher_prio);
+}
+
+/**
+ * @brief Queue trace span record
+ *
+ * @param callsite Pointer to callsite descriptor holding the span name
+ * @param end True to close the span, false to open it
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ * @return 0 on success, non-zero on error
+ */
+static int prv_queue_span(log_callsite_t *callsite, bool end, bool in_isr,
+                          BaseType_t *higher_prio) {
+  if (callsite == NULL || callsite->fmt_str == NULL) {
+    return -EINVAL;
+  }
+
+  // The task or ISR is already in the header context
+  log_msg_t *msg = NULL;
+  int ret = prv_begin_message(callsite, 0, in_isr, higher_prio, &msg);
+  if (ret != 0) {
+    return ret;
+  }
+
+  msg->level_flags |= end ? LOG_MSG_FLAG_SPAN_END : LOG_MSG_FLAG_SPAN_BEGIN;
+
+  return prv_send(msg, in_isr, higher_prio);
+}
+
+/**
+ * @brief Pack and queue message, context is decided once by the caller
+ *
+ * @param callsite Pointer to callsite descriptor
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ * @param args Variable argument list
+ * @return 0 on success, non-zero on error
+ */
+static int prv_queue_message(log_callsite_t *callsite, bool in_isr,
+                             BaseType_t *higher_prio, va_list args) {
+  if (callsite == NULL || callsite->fmt_str == NULL) {
+    return -EINVAL;
+  }
+
+  // Drop rate limited events before any sizing or allocation work
+  uint32_t suppressed = 0;
+  if (callsite->ratelimit != NULL &&
+      !log_ratelimit_take(callsite->ratelimit, in_isr, &suppressed)) {
+    return -EAGAIN;
+  }
+
+  int ret = prv_queue_message_args(callsite, suppressed, in_isr, higher_prio,
+                                   args);
+
+  // Report this event and the ones it carried on the next emitted message
+  if (ret != 0 && callsite->ratelimit != NULL) {
+    log_ratelimit_add_suppressed(callsite->ratelimit, in_isr, suppressed + 1);
+  }
+
+  return ret;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_init(void) {
+  // Initialize buffer pool
+  if (log_pool_init() != 0) {
+    return -1;
+  }
+
+  // Initialize queue system
+  if (log_queue_init() != 0) {
+    return -2;
+  }
+
+  log_start_thread();
+
+  return 0;
+}
+
+int log_start_thread(void) { return log_queue_start_thread(); }
+
+int log_flush(uint32_t timeout_ms) { return log_queue_flush(timeout_ms); }
+
+void log_panic(void) { log_queue_panic(); }
+
+int log_time_sync(uint64_t wallclock_us) {
+  return prv_queue_sync_record(log_timestamp_get(), wallclock_us, false,
+                               NULL);
+}
+
+int log_queue_deferred_message(log_callsite_t *callsite, ...) {
+  va_list args;
+  va_start(args, callsite);
+
+  int ret = prv_queue_message(callsite, false, NULL, args);
+
+  va_end(args);
+
+  return ret;
+}
+
+int log_queue_deferred_message_isr(log_callsite_t *callsite, ...) {
+  BaseType_t higher_prio = pdFALSE;
+
+  va_list args;
+  va_start(args, callsite);
+
+  int ret = prv_queue_message(callsite, true, &higher_prio, args);
+
   va_end(args);
 
-  return log_queue_send(msg);
+  // Single yield for the whole ISR path
+  portYIELD_FROM_ISR(higher_prio);
+
+  return ret;
+}
+
+int log_queue_kv_message(log_callsite_t *callsite,
+                         const log_kv_value_t *values) {
+  return prv_queue_kv(callsite, values, false, NULL);
+}
+
+int log_queue_kv_message_isr(log_callsite_t *callsite,
+                             const log_kv_value_t *values) {
+  BaseType_t higher_prio = pdFALSE;
+
+  int ret = prv_queue_kv(callsite, values, true, &higher_prio);
+
+  // Single yield for the whole ISR path
+  portYIELD_FROM_ISR(higher_prio);
+
+  return ret;
+}
+
+int log_queue_span(log_callsite_t *callsite, bool end) {
+  return prv_queue_span(callsite, end, false, NULL);
+}
+
+int log_queue_span_isr(log_callsite_t *callsite, bool end) {
+  BaseType_t higher_prio = pdFALSE;
+
+  int ret = prv_queue_span(callsite, end, true, &higher_prio);
+
+  // Single yield for the whole ISR path
+  portYIELD_FROM_ISR(higher_prio);
+
+  return ret;
+}
+
+int log_queue_packed_message(log_callsite_t *callsite, const void *args,
+                             size_t args_size) {
+  return prv_queue_packed(callsite, args, args_size, false, NULL);
+}
+
+int log_queue_packed_message_isr(log_callsite_t *callsite, const void *args,
+                                 size_t args_size) {
+  BaseType_t higher_prio = pdFALSE;
+
+  int ret = prv_queue_packed(callsite, args, args_size, true, &higher_prio);
+
+  // Single yield for the whole ISR path
+  portYIELD_FROM_ISR(higher_prio);
+
+  return ret;
 }
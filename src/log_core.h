@@ -11,12 +11,19 @@
 #ifndef log_core_h
 #define log_core_h
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "FreeRTOS.h"
 #include "task.h"
 
+#include "log_callsite.h"
+#include "log_filter.h"
+#include "log_module.h"
 #include "log_msg.h"
+#include "log_ratelimit.h"
+#include "log_sample.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -49,43 +56,113 @@ extern "C" {
  * Log Implementation Macros
  *****************************************************************************/
 
-#define LOG_AUGMENT_FMT_STR(fmt_str)                                           \
-  "%s[%u] <%s> %s::%s: " fmt_str LOG_RESET_COLOR "\r\n"
+/**
+ * @brief Drop message if the module's runtime level filters it out
+ *
+ * Levels above LOG_LEVEL_COMPILE_MAX fold to a constant and are removed.
+ *
+ * Must be expanded inside a do/while block.
+ */
+#define LOG_IMPL_FILTER(level)                                                 \
+  if ((level) > LOG_LEVEL_COMPILE_MAX ||                                       \
+      !log_filter_module_enabled(&prv_log_module, level)) {                    \
+    break;                                                                     \
+  }
+
+/**
+ * @brief Queue message of callsite
+ *
+ * Arguments are only evaluated here, after every filter has passed.
+ */
+#define LOG_IMPL_DISPATCH(callsite, ...)                                       \
+  if (xPortIsInsideInterrupt()) {                                              \
+    log_queue_deferred_message_isr(callsite, ##__VA_ARGS__);                   \
+  } else {                                                                     \
+    log_queue_deferred_message(callsite, ##__VA_ARGS__);                       \
+  }
+
+/**
+ * @brief Filter and queue message of the enclosing prv_log_callsite
+ *
+ * Must be expanded inside a do/while block that declares prv_log_callsite.
+ */
+#define LOG_IMPL_SEND(level, ...)                                              \
+  LOG_IMPL_FILTER(level)                                                       \
+  LOG_IMPL_DISPATCH(&prv_log_callsite, ##__VA_ARGS__)
 
 #define LOG_IMPL(level, fmt_str, ...)                                          \
   do {                                                                         \
-    char *level_str = LOG_LEVEL_EMPTY_STR;                                     \
-    char *color_mod = LOG_LEVEL_EMPTY_STR;                                     \
-    TickType_t ticks;                                                          \
-    switch (level) {                                                           \
-    case LOG_LEVEL_ERROR:                                                      \
-      level_str = LOG_LEVEL_ERROR_STR;                                         \
-      color_mod = LOG_LEVEL_ERROR_COLOR;                                       \
-      break;                                                                   \
-    case LOG_LEVEL_WARNING:                                                    \
-      level_str = LOG_LEVEL_WARNING_STR;                                       \
-      color_mod = LOG_LEVEL_WARNING_COLOR;                                     \
-      break;                                                                   \
-    case LOG_LEVEL_INFO:                                                       \
-      level_str = LOG_LEVEL_INFO_STR;                                          \
-      color_mod = LOG_LEVEL_INFO_COLOR;                                        \
-      break;                                                                   \
-    case LOG_LEVEL_DEBUG:                                                      \
-      level_str = LOG_LEVEL_DEBUG_STR;                                         \
-      color_mod = LOG_LEVEL_DEBUG_COLOR;                                       \
-      break;                                                                   \
-    default:                                                                   \
+    static log_callsite_t prv_log_callsite =                                   \
+        LOG_CALLSITE_INIT(&prv_log_module, level, __FUNCTION__, fmt_str);      \
+    LOG_IMPL_SEND(level, ##__VA_ARGS__)                                        \
+  } while (0);
+
+#define LOG_IMPL_RATELIMITED(level, interval_ms, burst, fmt_str, ...)          \
+  do {                                                                         \
+    static log_ratelimit_t prv_log_ratelimit =                                 \
+        LOG_RATELIMIT_INIT(interval_ms, burst);                                \
+    static log_callsite_t prv_log_callsite = LOG_CALLSITE_INIT_RATELIMITED(    \
+        &prv_log_module, level, __FUNCTION__, fmt_str, &prv_log_ratelimit);    \
+    LOG_IMPL_SEND(level, ##__VA_ARGS__)                                        \
+  } while (0);
+
+/**
+ * @brief Log only if the sampling check passes
+ *
+ * `sample_check` is evaluated after the level filter and before any message
+ * argument, and may refer to the callsite's counter as `prv_log_sample`.
+ */
+#define LOG_IMPL_SAMPLED(level, sample_check, fmt_str, ...)                    \
+  do {                                                                         \
+    static log_sample_t prv_log_sample = LOG_SAMPLE_INIT;                      \
+    static log_callsite_t prv_log_callsite =                                   \
+        LOG_CALLSITE_INIT(&prv_log_module, level, __FUNCTION__, fmt_str);      \
+    LOG_IMPL_FILTER(level)                                                     \
+    if (!(sample_check)) {                                                     \
       break;                                                                   \
     }                                                                          \
+    LOG_IMPL_DISPATCH(&prv_log_callsite, ##__VA_ARGS__)                        \
+  } while (0);
+
+/**
+ * @brief Queue structured key/value message
+ *
+ * Keys and types go into a static table referenced by the callsite, only
+ * the values are evaluated at runtime and only after the level filter.
+ */
+#define LOG_KV_IMPL(level, event_name, ...)                                    \
+  do {                                                                         \
+    static const log_kv_key_t prv_log_kv_keys[] = {                           \
+        LOG_KV_FOR_EACH(LOG_KV_KEY_ENTRY, __VA_ARGS__)};                       \
+    static log_callsite_t prv_log_callsite = LOG_CALLSITE_INIT_KV(            \
+        &prv_log_module, level, __FUNCTION__, event_name, prv_log_kv_keys,     \
+        LOG_KV_COUNT(__VA_ARGS__));                                            \
+    LOG_IMPL_FILTER(level)                                                     \
+    const log_kv_value_t prv_log_kv_values[] = {                               \
+        LOG_KV_FOR_EACH(LOG_KV_VALUE_ENTRY, __VA_ARGS__)};                     \
     if (xPortIsInsideInterrupt()) {                                            \
-      ticks = xTaskGetTickCountFromISR();                                      \
+      log_queue_kv_message_isr(&prv_log_callsite, prv_log_kv_values);          \
     } else {                                                                   \
-      ticks = xTaskGetTickCount();                                             \
+      log_queue_kv_message(&prv_log_callsite, prv_log_kv_values);              \
+    }                                                                          \
+  } while (0);
+
+/**
+ * @brief Queue trace span record
+ *
+ * No formatting is done, the record only carries the timestamp and task ID.
+ * Span records use LOG_SPAN_LEVEL for filtering.
+ */
+#define LOG_SPAN_IMPL(span_name, end)                                          \
+  do {                                                                         \
+    static log_callsite_t prv_log_callsite = LOG_CALLSITE_INIT(                \
+        &prv_log_module, LOG_SPAN_LEVEL, __FUNCTION__, span_name);             \
+    LOG_IMPL_FILTER(LOG_SPAN_LEVEL)                                            \
+    if (xPortIsInsideInterrupt()) {                                            \
+      log_queue_span_isr(&prv_log_callsite, end);                              \
+    } else {                                                                   \
+      log_queue_span(&prv_log_callsite, end);                                  \
     }                                                                          \
-    log_queue_deferred_message(prv_log_module_name, __FUNCTION__, level,       \
-                               LOG_AUGMENT_FMT_STR(fmt_str), color_mod, ticks, \
-                               level_str, prv_log_module_name, __FUNCTION__,   \
-                               ##__VA_ARGS__);                                 \
   } while (0);
 
 /*****************************************************************************
@@ -110,33 +187,117 @@ int log_init(void);
  */
 int log_start_thread(void);
 
+/**
+ * @brief Wait until every message queued so far has reached the backends
+ *
+ * Backends are flushed once the queue is drained.  Safe to call before the
+ * log thread runs, in which case the caller drains the queue itself.
+ *
+ * @param timeout_ms Maximum time to wait
+ * @return 0 on success, -ETIMEDOUT, -EBUSY if another flush is in progress,
+ *         or the first error reported by a backend
+ */
+int log_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Write pending messages through backends' panic path
+ *
+ * Call from a fault handler before resetting.  Takes no locks and does not
+ * return messages to the pool.
+ */
+void log_panic(void);
+
+/**
+ * @brief Queue time sync record mapping current timestamp to wallclock
+ *
+ * Lets the log thread and host tools convert timestamps to wallclock time.
+ * Call after the wallclock is known and periodically to correct drift.
+ *
+ * @param wallclock_us Current wallclock in microseconds since the epoch
+ * @return 0 on success, non-zero on error
+ */
+int log_time_sync(uint64_t wallclock_us);
+
 /**
  * @brief Queue deferred log message (thread-safe)
  *
- * @param module_name Module name
- * @param function_name Function name
- * @param level Log level
- * @param fmt_str Format string
+ * @param callsite Pointer to callsite descriptor holding the format string
  * @param ... Variable arguments
  * @return 0 on success, non-zero on error
  */
-int log_queue_deferred_message(const char *module_name,
-                               const char *function_name, uint8_t level,
-                               const char *fmt_str, ...);
+int log_queue_deferred_message(log_callsite_t *callsite, ...);
 
 /**
  * @brief Queue deferred log message from ISR
  *
- * @param module_name Module name
- * @param function_name Function name
- * @param level Log level
- * @param fmt_str Format string
+ * @param callsite Pointer to callsite descriptor holding the format string
  * @param ... Variable arguments
  * @return 0 on success, non-zero on error
  */
-int log_queue_deferred_message_isr(const char *module_name,
-                                   const char *function_name, uint8_t level,
-                                   const char *fmt_str, ...);
+int log_queue_deferred_message_isr(log_callsite_t *callsite, ...);
+
+/**
+ * @brief Queue structured key/value message (thread-safe)
+ *
+ * @param callsite Pointer to callsite descriptor holding the key table
+ * @param values Field values, one per key of the callsite
+ * @return 0 on success, non-zero on error
+ */
+int log_queue_kv_message(log_callsite_t *callsite,
+                         const log_kv_value_t *values);
+
+/**
+ * @brief Queue structured key/value message from ISR
+ *
+ * @param callsite Pointer to callsite descriptor holding the key table
+ * @param values Field values, one per key of the callsite
+ * @return 0 on success, non-zero on error
+ */
+int log_queue_kv_message_isr(log_callsite_t *callsite,
+                             const log_kv_value_t *values);
+
+/**
+ * @brief Queue trace span begin or end record (thread-safe)
+ *
+ * @param callsite Pointer to callsite descriptor holding the span name
+ * @param end True to close the span, false to open it
+ * @return 0 on success, non-zero on error
+ */
+int log_queue_span(log_callsite_t *callsite, bool end);
+
+/**
+ * @brief Queue trace span begin or end record from ISR
+ *
+ * @param callsite Pointer to callsite descriptor holding the span name
+ * @param end True to close the span, false to open it
+ * @return 0 on success, non-zero on error
+ */
+int log_queue_span_isr(log_callsite_t *callsite, bool end);
+
+/**
+ * @brief Queue message with an argument buffer packed by the caller
+ *
+ * The buffer must use the same layout log_format_copy_args_to_buffer
+ * produces for the callsite's format string.
+ *
+ * @param callsite Pointer to callsite descriptor holding the format string
+ * @param args Packed argument buffer
+ * @param args_size Size of packed argument buffer
+ * @return 0 on success, non-zero on error
+ */
+int log_queue_packed_message(log_callsite_t *callsite, const void *args,
+                             size_t args_size);
+
+/**
+ * @brief Queue message with an argument buffer packed by the caller from ISR
+ *
+ * @param callsite Pointer to callsite descriptor holding the format string
+ * @param args Packed argument buffer
+ * @param args_size Size of packed argument buffer
+ * @return 0 on success, non-zero on error
+ */
+int log_queue_packed_message_isr(log_callsite_t *callsite, const void *args,
+                                 size_t args_size);
 
 #ifdef __cplusplus
 }
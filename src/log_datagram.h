@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_datagram.h
+ * @author Evan Stoddard
+ * @brief Wire format of batched log datagrams
+ *
+ * Every datagram starts with a log_datagram_header_t in host byte order,
+ * followed by `count` whole records.  Text records are rendered lines,
+ * binary records are COBS framed as described in log_binary.h, so the
+ * payloads of consecutive datagrams concatenate to a text log or a binary
+ * stream log_reader decodes.
+ *
+ * `sequence` increments by one with every datagram of a session, a jump
+ * means datagrams were lost.  `session` changes whenever the sender
+ * restarts and its sequence starts over.
+ */
+
+#ifndef log_datagram_h
+#define log_datagram_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Marks a log datagram, "LOGD" */
+#define LOG_DATAGRAM_MAGIC 0x44474F4Cu
+
+/** @brief Records are rendered text lines */
+#define LOG_DATAGRAM_FORMAT_TEXT 0x01
+
+/** @brief Records are COBS framed binary records */
+#define LOG_DATAGRAM_FORMAT_BINARY 0x02
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_datagram_header_t
+ * @brief Header at the start of every datagram
+ *
+ */
+typedef struct log_datagram_header_t {
+  uint32_t magic;
+  uint32_t session;
+  uint32_t sequence;
+  uint16_t count;
+  uint8_t format;
+  uint8_t reserved;
+} log_datagram_header_t;
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_datagram_h */
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_dedup.c
+ * @author Evan Stoddard
+ * @brief Collapsing of consecutive duplicate messages implementation
+ */
+
+#include "log_dedup.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "log_callsite.h"
+#include "log_config.h"
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance
+ *
+ * Only touched by the log thread, so no locking is needed.
+ */
+static struct {
+  // Header and arguments of the last message that was dispatched
+  uint8_t ref[LOG_MSG_SIZE(LOG_DEDUP_MAX_ARGS_SIZE)]
+      __attribute__((aligned(8)));
+  bool has_ref;
+  uint32_t repeats;
+
+  // Repeat record handed out when a run ends
+  uint8_t summary[LOG_MSG_SIZE(sizeof(uint32_t))] __attribute__((aligned(8)));
+} prv_inst;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Check if message may take part in duplicate collapsing
+ *
+ * @param msg Pointer to message
+ * @return true if message can be compared and stored
+ */
+static bool prv_is_candidate(const log_msg_t *msg) {
+  // Span records are only meaningful with their own timestamps
+  return msg->callsite_id < LOG_CALLSITE_ID_RESERVED_START &&
+         !LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_SPAN_BEGIN |
+                                    LOG_MSG_FLAG_SPAN_END) &&
+         msg->args_buffer_size <= LOG_DEDUP_MAX_ARGS_SIZE;
+}
+
+/**
+ * @brief Check if message matches the stored reference
+ *
+ * @param msg Pointer to message
+ * @return true if message is a duplicate
+ */
+static bool prv_matches_ref(const log_msg_t *msg) {
+  const log_msg_t *ref = (const log_msg_t *)prv_inst.ref;
+
+  return prv_inst.has_ref && ref->callsite_id == msg->callsite_id &&
+         ref->level_flags == msg->level_flags &&
+         ref->module_id == msg->module_id && ref->context == msg->context &&
+         ref->args_buffer_size == msg->args_buffer_size &&
+         memcmp(ref->args_buffer, msg->args_buffer, msg->args_buffer_size) ==
+             0;
+}
+
+/**
+ * @brief Build repeat record for the current run and reset the count
+ *
+ * @return Repeat record, or NULL if the run had no repeats
+ */
+static const log_msg_t *prv_end_run(void) {
+  if (prv_inst.repeats == 0) {
+    return NULL;
+  }
+
+  const log_msg_t *ref = (const log_msg_t *)prv_inst.ref;
+  log_msg_t *summary = (log_msg_t *)prv_inst.summary;
+
+  summary->callsite_id = LOG_CALLSITE_ID_REPEAT;
+  summary->level_flags = LOG_MSG_GET_LEVEL(ref);
+  summary->module_id = ref->module_id;
+  summary->timestamp = ref->timestamp;
+  summary->args_buffer_size = sizeof(prv_inst.repeats);
+  summary->context = ref->context;
+  memcpy(summary->args_buffer, &prv_inst.repeats, sizeof(prv_inst.repeats));
+
+  prv_inst.repeats = 0;
+
+  return summary;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+bool log_dedup_process(const log_msg_t *msg, const log_msg_t **summary) {
+  if (summary != NULL) {
+    *summary = NULL;
+  }
+
+  if (msg == NULL) {
+    return false;
+  }
+
+  if (prv_matches_ref(msg)) {
+    log_msg_t *ref = (log_msg_t *)prv_inst.ref;
+
+    // Repeat record carries the time of the last repeat
+    ref->timestamp = msg->timestamp;
+    if (prv_inst.repeats < UINT32_MAX) {
+      prv_inst.repeats++;
+    }
+
+    return true;
+  }
+
+  const log_msg_t *ended = prv_end_run();
+  if (summary != NULL) {
+    *summary = ended;
+  }
+
+  prv_inst.has_ref = prv_is_candidate(msg);
+  if (prv_inst.has_ref) {
+    memcpy(prv_inst.ref, msg, sizeof(log_msg_t) + msg->args_buffer_size);
+  }
+
+  return false;
+}
+
+const log_msg_t *log_dedup_flush(void) { return prv_end_run(); }
+
+bool log_dedup_pending(void) { return prv_inst.repeats > 0; }
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_dedup.h
+ * @author Evan Stoddard
+ * @brief Collapsing of consecutive duplicate messages on the log thread
+ */
+
+#ifndef log_dedup_h
+#define log_dedup_h
+
+#include <stdbool.h>
+
+#include "log_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Compare message with the previous one (log thread only)
+ *
+ * Messages match when callsite, level, flags, module and packed arguments
+ * are identical.  A matching message is counted and must be dropped by the
+ * caller.  Otherwise it becomes the new reference and, if the previous run
+ * had repeats, `summary` is set to a repeat record that must be dispatched
+ * before the message.
+ *
+ * @param msg Pointer to received message
+ * @param summary Set to repeat record of the ended run, or NULL
+ * @return true if message is a duplicate
+ */
+bool log_dedup_process(const log_msg_t *msg, const log_msg_t **summary);
+
+/**
+ * @brief End the current run, e.g. when the log thread is idle
+ *
+ * @return Repeat record of the ended run, or NULL if nothing was repeated
+ */
+const log_msg_t *log_dedup_flush(void);
+
+/**
+ * @brief Check whether a run with repeats is waiting to be flushed
+ *
+ * @return true if log_dedup_flush would return a repeat record
+ */
+bool log_dedup_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_dedup_h */
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_delta.c
+ * @author Evan Stoddard
+ * @brief Per-callsite delta encoding of messages implementation
+ */
+
+#include "log_delta.h"
+
+#include <string.h>
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Longest LEB128 encoding of a 32-bit value */
+#define LOG_DELTA_VARINT_MAX_SIZE 5
+
+/** @brief Bytes of changed-word bitmask for an argument buffer */
+#define LOG_DELTA_MASK_SIZE(words) (((words) + 7) / 8)
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Get cache slot of callsite
+ *
+ * @param delta Pointer to encoder or decoder state
+ * @param callsite_id Callsite ID
+ * @return Pointer to cache entry
+ */
+static log_delta_entry_t *prv_slot(log_delta_t *delta, uint16_t callsite_id) {
+  return &delta->cache[callsite_id % LOG_DELTA_CACHE_SIZE];
+}
+
+/**
+ * @brief Check if message can be cached
+ *
+ * @param callsite_id Callsite ID
+ * @param args_size Size of argument buffer
+ * @return true if message takes part in delta encoding
+ */
+static bool prv_is_cacheable(uint16_t callsite_id, size_t args_size) {
+  // Internal records and the overflow ID have no callsite of their own
+  return callsite_id < LOG_MAX_CALLSITES &&
+         args_size <= LOG_DELTA_MAX_ARGS_SIZE;
+}
+
+/**
+ * @brief Remember message as the last record of its callsite
+ *
+ * @param entry Cache entry
+ * @param msg Pointer to message
+ */
+static void prv_store(log_delta_entry_t *entry, const log_msg_t *msg) {
+  entry->callsite_id = msg->callsite_id;
+  entry->level_flags = msg->level_flags;
+  entry->module_id = msg->module_id;
+  entry->context = msg->context;
+  entry->timestamp = msg->timestamp;
+  entry->args_size = msg->args_buffer_size;
+  entry->valid = true;
+  memcpy(entry->args, msg->args_buffer, msg->args_buffer_size);
+}
+
+/**
+ * @brief Get size of argument word, the last word may be partial
+ *
+ * @param args_size Size of argument buffer
+ * @param word Word index
+ * @return Size in bytes
+ */
+static size_t prv_word_size(size_t args_size, size_t word) {
+  size_t offset = word * 4;
+
+  return (args_size - offset < 4) ? args_size - offset : 4;
+}
+
+/**
+ * @brief Write 16-bit little-endian value
+ *
+ * @param out Output position
+ * @param value Value
+ */
+static void prv_put_u16(uint8_t *out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+/**
+ * @brief Write 32-bit little-endian value
+ *
+ * @param out Output position
+ * @param value Value
+ */
+static void prv_put_u32(uint8_t *out, uint32_t value) {
+  prv_put_u16(out, (uint16_t)value);
+  prv_put_u16(out + 2, (uint16_t)(value >> 16));
+}
+
+/**
+ * @brief Read 16-bit little-endian value
+ *
+ * @param in Input position
+ * @return Value
+ */
+static uint16_t prv_get_u16(const uint8_t *in) {
+  return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+/**
+ * @brief Read 32-bit little-endian value
+ *
+ * @param in Input position
+ * @return Value
+ */
+static uint32_t prv_get_u32(const uint8_t *in) {
+  return prv_get_u16(in) | ((uint32_t)prv_get_u16(in + 2) << 16);
+}
+
+/**
+ * @brief Write LEB128 varint
+ *
+ * @param out Output position, must hold LOG_DELTA_VARINT_MAX_SIZE bytes
+ * @param value Value
+ * @return Number of bytes written
+ */
+static size_t prv_put_varint(uint8_t *out, uint32_t value) {
+  size_t len = 0;
+
+  while (value >= 0x80) {
+    out[len++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+
+  out[len++] = (uint8_t)value;
+
+  return len;
+}
+
+/**
+ * @brief Read LEB128 varint
+ *
+ * @param in Input position
+ * @param in_size Bytes available
+ * @param value Decoded value
+ * @return Number of bytes consumed, 0 if truncated or too long
+ */
+static size_t prv_get_varint(const uint8_t *in, size_t in_size,
+                             uint32_t *value) {
+  uint32_t result = 0;
+
+  for (size_t i = 0; i < in_size && i < LOG_DELTA_VARINT_MAX_SIZE; i++) {
+    result |= (uint32_t)(in[i] & 0x7F) << (7 * i);
+
+    if ((in[i] & 0x80) == 0) {
+      *value = result;
+      return i + 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Encode message as full record
+ *
+ * @param msg Pointer to message
+ * @param out_buf Pointer to output buffer
+ * @param out_buf_size_bytes Size of output buffer
+ * @return Number of bytes written, 0 if the output buffer is too small
+ */
+static size_t prv_encode_full(const log_msg_t *msg, uint8_t *out_buf,
+                              size_t out_buf_size_bytes) {
+  size_t len = LOG_DELTA_MAX_RECORD_SIZE(msg->args_buffer_size);
+
+  if (len > out_buf_size_bytes) {
+    return 0;
+  }
+
+  out_buf[0] = LOG_DELTA_RECORD_FULL;
+  prv_put_u16(&out_buf[1], msg->callsite_id);
+  out_buf[3] = msg->level_flags;
+  out_buf[4] = msg->module_id;
+  prv_put_u32(&out_buf[5], msg->timestamp);
+  prv_put_u16(&out_buf[9], msg->args_buffer_size);
+  prv_put_u16(&out_buf[11], msg->context);
+  memcpy(&out_buf[LOG_DELTA_FULL_HEADER_SIZE], msg->args_buffer,
+         msg->args_buffer_size);
+
+  return len;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+void log_delta_reset(log_delta_t *delta) {
+  if (delta == NULL) {
+    return;
+  }
+
+  for (size_t i = 0; i < LOG_DELTA_CACHE_SIZE; i++) {
+    delta->cache[i].valid = false;
+  }
+}
+
+size_t log_delta_encode(log_delta_t *delta, const log_msg_t *msg,
+                        uint8_t *out_buf, size_t out_buf_size_bytes) {
+  if (delta == NULL || msg == NULL || out_buf == NULL) {
+    return 0;
+  }
+
+  size_t args_size = msg->args_buffer_size;
+
+  if (!prv_is_cacheable(msg->callsite_id, args_size)) {
+    return prv_encode_full(msg, out_buf, out_buf_size_bytes);
+  }
+
+  log_delta_entry_t *entry = prv_slot(delta, msg->callsite_id);
+
+  bool hit = entry->valid && entry->callsite_id == msg->callsite_id &&
+             entry->level_flags == msg->level_flags &&
+             entry->module_id == msg->module_id &&
+             entry->context == msg->context && entry->args_size == args_size;
+
+  if (hit) {
+    uint8_t record[3 + LOG_DELTA_VARINT_MAX_SIZE +
+                   LOG_DELTA_MASK_SIZE(LOG_DELTA_MAX_WORDS) +
+                   LOG_DELTA_MAX_WORDS * 4];
+    size_t words = (args_size + 3) / 4;
+    size_t mask_size = LOG_DELTA_MASK_SIZE(words);
+
+    record[0] = LOG_DELTA_RECORD_DELTA;
+    prv_put_u16(&record[1], msg->callsite_id);
+
+    size_t len = 3;
+    len += prv_put_varint(&record[len], msg->timestamp - entry->timestamp);
+
+    uint8_t *mask = &record[len];
+    memset(mask, 0, mask_size);
+    len += mask_size;
+
+    // Only words that differ from the cached record go on the wire
+    for (size_t word = 0; word < words; word++) {
+      size_t offset = word * 4;
+      size_t word_size = prv_word_size(args_size, word);
+
+      if (memcmp(&entry->args[offset], &msg->args_buffer[offset],
+                 word_size) == 0) {
+        continue;
+      }
+
+      mask[word / 8] |= (uint8_t)(1u << (word % 8));
+      memcpy(&record[len], &msg->args_buffer[offset], word_size);
+      len += word_size;
+    }
+
+    // Bitmask overhead can outgrow the full header for large buffers
+    if (len < LOG_DELTA_MAX_RECORD_SIZE(args_size)) {
+      if (len > out_buf_size_bytes) {
+        return 0;
+      }
+
+      memcpy(out_buf, record, len);
+      prv_store(entry, msg);
+
+      return len;
+    }
+  }
+
+  size_t len = prv_encode_full(msg, out_buf, out_buf_size_bytes);
+  if (len > 0) {
+    prv_store(entry, msg);
+  }
+
+  return len;
+}
+
+size_t log_delta_decode(log_delta_t *delta, const uint8_t *in_buf,
+                        size_t in_buf_size_bytes, log_msg_t *msg,
+                        size_t msg_size_bytes) {
+  if (delta == NULL || in_buf == NULL || msg == NULL ||
+      in_buf_size_bytes < 3) {
+    return 0;
+  }
+
+  uint16_t callsite_id = prv_get_u16(&in_buf[1]);
+
+  if (in_buf[0] == LOG_DELTA_RECORD_FULL) {
+    if (in_buf_size_bytes < LOG_DELTA_FULL_HEADER_SIZE) {
+      return 0;
+    }
+
+    uint16_t args_size = prv_get_u16(&in_buf[9]);
+
+    if (in_buf_size_bytes < LOG_DELTA_MAX_RECORD_SIZE(args_size) ||
+        msg_size_bytes < sizeof(log_msg_t) + args_size) {
+      return 0;
+    }
+
+    msg->callsite_id = callsite_id;
+    msg->level_flags = in_buf[3];
+    msg->module_id = in_buf[4];
+    msg->timestamp = prv_get_u32(&in_buf[5]);
+    msg->args_buffer_size = args_size;
+    msg->context = prv_get_u16(&in_buf[11]);
+    memcpy(msg->args_buffer, &in_buf[LOG_DELTA_FULL_HEADER_SIZE], args_size);
+
+    if (prv_is_cacheable(callsite_id, args_size)) {
+      prv_store(prv_slot(delta, callsite_id), msg);
+    }
+
+    return LOG_DELTA_MAX_RECORD_SIZE(args_size);
+  }
+
+  if (in_buf[0] != LOG_DELTA_RECORD_DELTA) {
+    return 0;
+  }
+
+  log_delta_entry_t *entry = prv_slot(delta, callsite_id);
+
+  if (!entry->valid || entry->callsite_id != callsite_id ||
+      msg_size_bytes < sizeof(log_msg_t) + entry->args_size) {
+    return 0;
+  }
+
+  uint32_t timestamp_delta = 0;
+  size_t len = 3;
+  size_t varint_len = prv_get_varint(&in_buf[len], in_buf_size_bytes - len,
+                                     &timestamp_delta);
+  if (varint_len == 0) {
+    return 0;
+  }
+  len += varint_len;
+
+  size_t args_size = entry->args_size;
+  size_t words = (args_size + 3) / 4;
+  size_t mask_size = LOG_DELTA_MASK_SIZE(words);
+
+  if (in_buf_size_bytes < len + mask_size) {
+    return 0;
+  }
+
+  const uint8_t *mask = &in_buf[len];
+  len += mask_size;
+
+  msg->callsite_id = callsite_id;
+  msg->level_flags = entry->level_flags;
+  msg->module_id = entry->module_id;
+  msg->timestamp = entry->timestamp + timestamp_delta;
+  msg->args_buffer_size = (uint16_t)args_size;
+  msg->context = entry->context;
+  memcpy(msg->args_buffer, entry->args, args_size);
+
+  for (size_t word = 0; word < words; word++) {
+    if ((mask[word / 8] & (1u << (word % 8))) == 0) {
+      continue;
+    }
+
+    size_t word_size = prv_word_size(args_size, word);
+    if (in_buf_size_bytes < len + word_size) {
+      return 0;
+    }
+
+    memcpy(&msg->args_buffer[word * 4], &in_buf[len], word_size);
+    len += word_size;
+  }
+
+  prv_store(entry, msg);
+
+  return len;
+}
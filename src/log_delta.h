@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_delta.h
+ * @author Evan Stoddard
+ * @brief Per-callsite delta encoding of messages for binary backends
+ */
+
+#ifndef log_delta_h
+#define log_delta_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_config.h"
+#include "log_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Record carrying the complete header and argument buffer */
+#define LOG_DELTA_RECORD_FULL 0x00
+
+/** @brief Record carrying only the fields that changed since last record */
+#define LOG_DELTA_RECORD_DELTA 0x01
+
+/** @brief Size of a full record header in bytes */
+#define LOG_DELTA_FULL_HEADER_SIZE 13u
+
+/** @brief Number of 32-bit words in a cached argument buffer */
+#define LOG_DELTA_MAX_WORDS ((LOG_DELTA_MAX_ARGS_SIZE + 3) / 4)
+
+/** @brief Upper bound of a single encoded record */
+#define LOG_DELTA_MAX_RECORD_SIZE(args_size)                                   \
+  (LOG_DELTA_FULL_HEADER_SIZE + (args_size))
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_delta_entry_t
+ * @brief Last record seen from one callsite
+ *
+ */
+typedef struct log_delta_entry_t {
+  uint16_t callsite_id;
+  uint8_t level_flags;
+  uint8_t module_id;
+  uint16_t context;
+  uint32_t timestamp;
+  uint16_t args_size;
+  bool valid;
+  uint8_t args[LOG_DELTA_MAX_WORDS * 4];
+} log_delta_entry_t;
+
+/**
+ * @typedef log_delta_t
+ * @brief Encoder or decoder state
+ *
+ * Direct-mapped cache indexed by callsite ID.  Encoder and decoder must use
+ * the same LOG_DELTA_CACHE_SIZE and must be reset together whenever the
+ * stream is interrupted.
+ */
+typedef struct log_delta_t {
+  log_delta_entry_t cache[LOG_DELTA_CACHE_SIZE];
+} log_delta_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Reset encoder or decoder, next record of every callsite is full
+ *
+ * @param delta Pointer to encoder or decoder state
+ */
+void log_delta_reset(log_delta_t *delta);
+
+/**
+ * @brief Encode message as full or delta record
+ *
+ * A delta record is used when the previous record in the callsite's cache
+ * slot came from the same callsite with the same header, context and
+ * argument size.  It consists of the record type, callsite ID, the
+ * timestamp delta as a LEB128 varint, a bitmask of changed 32-bit argument
+ * words and the changed words themselves.  Multi-byte header fields are
+ * little-endian, argument words keep the producer's byte order.
+ *
+ * @param delta Pointer to encoder state
+ * @param msg Pointer to message
+ * @param out_buf Pointer to output buffer
+ * @param out_buf_size_bytes Size of output buffer
+ * @return Number of bytes written, 0 if the output buffer is too small
+ */
+size_t log_delta_encode(log_delta_t *delta, const log_msg_t *msg,
+                        uint8_t *out_buf, size_t out_buf_size_bytes);
+
+/**
+ * @brief Decode one record back into a message
+ *
+ * @param delta Pointer to decoder state
+ * @param in_buf Pointer to encoded records
+ * @param in_buf_size_bytes Number of bytes available
+ * @param msg Pointer to message to fill, must hold `msg_size_bytes`
+ * @param msg_size_bytes Size of message storage including argument buffer
+ * @return Number of bytes consumed, 0 if the record is malformed,
+ *         truncated or refers to a callsite missing from the cache
+ */
+size_t log_delta_decode(log_delta_t *delta, const uint8_t *in_buf,
+                        size_t in_buf_size_bytes, log_msg_t *msg,
+                        size_t msg_size_bytes);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_delta_h */
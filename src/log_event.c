@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_event.c
+ * @author Evan Stoddard
+ * @brief Format-free counter and marker events implementation
+ */
+
+#include "log_event.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "task.h"
+
+#include "log_callsite.h"
+#include "log_context.h"
+#include "log_core.h"
+#include "log_module.h"
+#include "log_queue.h"
+#include "log_timestamp.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#if (LOG_EVENT_RING_SIZE & (LOG_EVENT_RING_SIZE - 1)) != 0
+#error "LOG_EVENT_RING_SIZE must be a power of two"
+#endif
+
+/** @brief Mask turning a free running index into a ring slot */
+#define LOG_EVENT_RING_MASK (LOG_EVENT_RING_SIZE - 1)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance
+ *
+ * Producers append under a critical section, only the log thread consumes.
+ */
+static struct {
+  log_event_t ring[LOG_EVENT_RING_SIZE];
+  uint32_t head;
+  uint32_t tail;
+  uint32_t dropped;
+
+  // Log thread is blocked without a timeout, the next event wakes it
+  bool idle;
+
+  // Record handed out to the log thread
+  uint8_t record[LOG_MSG_SIZE(sizeof(log_event_payload_t))]
+      __attribute__((aligned(8)));
+} prv_inst;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Append event to ring
+ *
+ * @param id Event ID
+ * @param value Event value
+ * @param in_isr True if called from ISR
+ * @param higher_prio Set if a higher priority task was woken (ISR only)
+ * @return 0 on success, -EINVAL for a reserved ID, -ENOSPC if the ring is
+ * full
+ */
+static int prv_record(uint16_t id, uint32_t value, bool in_isr,
+                      BaseType_t *higher_prio) {
+  // Would be rendered as a drop report
+  if (id > LOG_EVENT_ID_MAX) {
+    return -EINVAL;
+  }
+
+  uint32_t timestamp = (uint32_t)(in_isr ? log_timestamp_get_from_isr()
+                                         : log_timestamp_get());
+  uint16_t context = log_context_capture(in_isr);
+  UBaseType_t saved_isr_state = 0;
+  bool wake = false;
+  int ret = 0;
+
+  if (in_isr) {
+    saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+  } else {
+    taskENTER_CRITICAL();
+  }
+
+  uint32_t used = prv_inst.head - prv_inst.tail;
+
+  if (used >= LOG_EVENT_RING_SIZE) {
+    if (prv_inst.dropped < UINT32_MAX) {
+      prv_inst.dropped++;
+    }
+    ret = -ENOSPC;
+  } else {
+    log_event_t *event = &prv_inst.ring[prv_inst.head & LOG_EVENT_RING_MASK];
+    event->id = id;
+    event->context = context;
+    event->timestamp = timestamp;
+    event->value = value;
+    prv_inst.head++;
+
+    // Only one producer sees the ring cross the halfway mark
+    wake = (used + 1 == LOG_EVENT_RING_SIZE / 2);
+
+    // First event after the ring ran empty starts the drain timeout
+    if (used == 0 && prv_inst.idle) {
+      prv_inst.idle = false;
+      wake = true;
+    }
+  }
+
+  if (in_isr) {
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskEXIT_CRITICAL();
+  }
+
+  if (wake) {
+    if (in_isr) {
+      log_queue_wake_from_isr(higher_prio);
+    } else {
+      log_queue_wake();
+    }
+  }
+
+  return ret;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_event_record(uint16_t id, uint32_t value) {
+  return prv_record(id, value, false, NULL);
+}
+
+int log_event_record_isr(uint16_t id, uint32_t value) {
+  BaseType_t higher_prio = pdFALSE;
+
+  int ret = prv_record(id, value, true, &higher_prio);
+
+  portYIELD_FROM_ISR(higher_prio);
+
+  return ret;
+}
+
+bool log_event_pending(void) {
+  taskENTER_CRITICAL();
+
+  bool pending = prv_inst.tail != prv_inst.head || prv_inst.dropped > 0;
+  prv_inst.idle = !pending;
+
+  taskEXIT_CRITICAL();
+
+  return pending;
+}
+
+const log_msg_t *log_event_next(void) {
+  log_event_t event;
+  bool has_event = false;
+  uint32_t dropped = 0;
+
+  taskENTER_CRITICAL();
+
+  if (prv_inst.tail != prv_inst.head) {
+    event = prv_inst.ring[prv_inst.tail & LOG_EVENT_RING_MASK];
+    prv_inst.tail++;
+    has_event = true;
+  } else {
+    dropped = prv_inst.dropped;
+    prv_inst.dropped = 0;
+  }
+
+  taskEXIT_CRITICAL();
+
+  if (!has_event) {
+    if (dropped == 0) {
+      return NULL;
+    }
+
+    event.id = LOG_EVENT_ID_DROPPED;
+    event.context = 0;
+    event.timestamp = (uint32_t)log_timestamp_get();
+    event.value = dropped;
+  }
+
+  log_msg_t *msg = (log_msg_t *)prv_inst.record;
+  log_event_payload_t payload = {
+      .id = event.id,
+      .reserved = 0,
+      .value = event.value,
+  };
+
+  msg->callsite_id = LOG_CALLSITE_ID_EVENT;
+  msg->level_flags = LOG_LEVEL_NONE;
+  msg->module_id = LOG_MODULE_ID_UNASSIGNED;
+  msg->timestamp = event.timestamp;
+  msg->args_buffer_size = sizeof(payload);
+  msg->context = event.context;
+  memcpy(msg->args_buffer, &payload, sizeof(payload));
+
+  return msg;
+}
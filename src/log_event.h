@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_event.h
+ * @author Evan Stoddard
+ * @brief Format-free counter and marker events
+ */
+
+#ifndef log_event_h
+#define log_event_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "log_config.h"
+#include "log_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Event ID reporting the number of events lost to a full ring */
+#define LOG_EVENT_ID_DROPPED 0xFFFF
+
+/** @brief Highest event ID available to the application */
+#define LOG_EVENT_ID_MAX 0xFFFE
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_event_t
+ * @brief Fixed size event record, one ring slot
+ *
+ */
+typedef struct log_event_t {
+  uint16_t id;
+  uint16_t context;
+  uint32_t timestamp;
+  uint32_t value;
+} log_event_t;
+
+/**
+ * @typedef log_event_payload_t
+ * @brief Argument buffer of a LOG_CALLSITE_ID_EVENT record
+ *
+ * The timestamp is carried in the message header.
+ */
+typedef struct log_event_payload_t {
+  uint16_t id;
+  uint16_t reserved;
+  uint32_t value;
+} log_event_payload_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Record event (task context)
+ *
+ * Writes a fixed size record into the event ring without touching the
+ * message pool.  The log thread is woken once the ring is half full and
+ * otherwise picks events up LOG_EVENT_FLUSH_MS after the first one.
+ *
+ * @param id Application defined event ID, at most LOG_EVENT_ID_MAX
+ * @param value Counter, queue depth or any other 32-bit value
+ * @return 0 on success, -EINVAL for a reserved ID, -ENOSPC if the ring is
+ * full
+ */
+int log_event_record(uint16_t id, uint32_t value);
+
+/**
+ * @brief Record event from ISR
+ *
+ * @param id Application defined event ID, at most LOG_EVENT_ID_MAX
+ * @param value Counter, queue depth or any other 32-bit value
+ * @return 0 on success, -EINVAL for a reserved ID, -ENOSPC if the ring is
+ * full
+ */
+int log_event_record_isr(uint16_t id, uint32_t value);
+
+/**
+ * @brief Check for events waiting to be taken (log thread only)
+ *
+ * If there are none, the next recorded event wakes the log thread so it can
+ * start its drain timeout.  The thread does not have to wake up periodically
+ * while no events are recorded.
+ *
+ * @return true if log_event_next has something to return
+ */
+bool log_event_pending(void);
+
+/**
+ * @brief Take oldest event as a message (log thread only)
+ *
+ * Once the ring is empty a LOG_EVENT_ID_DROPPED event is returned if events
+ * were lost since the last one.
+ *
+ * @return Event record valid until the next call, or NULL if none
+ */
+const log_msg_t *log_event_next(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_event_h */
@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_filter.c
+ * @author Evan Stoddard
+ * @brief Runtime per-module level filtering implementation
+ */
+
+#include "log_filter.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+// FreeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "log_core.h"
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_filter_rule_t
+ * @brief Single compiled `pattern=LEVEL` rule
+ *
+ */
+typedef struct log_filter_rule_t {
+  uint16_t pattern_offset;
+  uint32_t pattern_hash;
+  bool is_glob;
+  uint8_t level;
+} log_filter_rule_t;
+
+/**
+ * @typedef log_filter_spec_t
+ * @brief Compiled filter spec
+ *
+ * Patterns are stored as offsets into the private copy of the spec string so
+ * the whole spec can be swapped with a single copy.
+ */
+typedef struct log_filter_spec_t {
+  char buffer[LOG_FILTER_SPEC_MAX_LEN];
+  log_filter_rule_t rules[LOG_FILTER_MAX_RULES];
+  uint8_t rule_count;
+  uint8_t fallback_level;
+} log_filter_spec_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+uint8_t log_filter_module_levels[LOG_MAX_MODULES + 1];
+
+/**
+ * @brief Private instance
+ */
+static struct {
+  log_filter_spec_t active;
+  bool has_spec;
+} prv_inst;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Enter critical section from task or ISR context
+ *
+ * @param in_isr True if called from ISR
+ * @return Saved interrupt state to pass to prv_exit_critical
+ */
+static UBaseType_t prv_enter_critical(bool in_isr) {
+  if (in_isr) {
+    return taskENTER_CRITICAL_FROM_ISR();
+  }
+
+  taskENTER_CRITICAL();
+  return 0;
+}
+
+/**
+ * @brief Exit critical section from task or ISR context
+ *
+ * @param in_isr True if called from ISR
+ * @param saved_isr_state Value returned by prv_enter_critical
+ */
+static void prv_exit_critical(bool in_isr, UBaseType_t saved_isr_state) {
+  if (in_isr) {
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskEXIT_CRITICAL();
+  }
+}
+
+/**
+ * @brief Match string against glob pattern supporting `*` and `?`
+ *
+ * @param pattern Glob pattern
+ * @param str String to match
+ * @return true on match
+ */
+static bool prv_glob_match(const char *pattern, const char *str) {
+  const char *star = NULL;
+  const char *retry = NULL;
+
+  while (*str) {
+    if (*pattern == '*') {
+      star = pattern++;
+      retry = str;
+    } else if (*pattern == '?' || *pattern == *str) {
+      pattern++;
+      str++;
+    } else if (star) {
+      pattern = star + 1;
+      str = ++retry;
+    } else {
+      return false;
+    }
+  }
+
+  while (*pattern == '*') {
+    pattern++;
+  }
+
+  return *pattern == '\0';
+}
+
+/**
+ * @brief Compare token against level name ignoring case
+ *
+ * @param token Token to compare
+ * @param name Upper case level name
+ * @return true if equal
+ */
+static bool prv_level_name_equals(const char *token, const char *name) {
+  while (*token && *name) {
+    char c = *token;
+
+    if (c >= 'a' && c <= 'z') {
+      c = (char)(c - 'a' + 'A');
+    }
+
+    if (c != *name) {
+      return false;
+    }
+
+    token++;
+    name++;
+  }
+
+  return *token == '\0' && *name == '\0';
+}
+
+/**
+ * @brief Parse level token
+ *
+ * @param token Null terminated token
+ * @param level Pointer to parsed level
+ * @return 0 on success, -EINVAL on unknown level
+ */
+static int prv_parse_level(const char *token, uint8_t *level) {
+  static const struct {
+    const char *name;
+    uint8_t level;
+  } names[] = {
+      {"NONE", LOG_LEVEL_NONE},
+      {"OFF", LOG_LEVEL_NONE},
+      {LOG_LEVEL_ERROR_STR, LOG_LEVEL_ERROR},
+      {LOG_LEVEL_WARNING_STR, LOG_LEVEL_WARNING},
+      {LOG_LEVEL_INFO_STR, LOG_LEVEL_INFO},
+      {LOG_LEVEL_DEBUG_STR, LOG_LEVEL_DEBUG},
+  };
+
+  if (token[0] >= '0' && token[0] <= '9' && token[1] == '\0') {
+    if (token[0] - '0' > LOG_LEVEL_DEBUG) {
+      return -EINVAL;
+    }
+
+    *level = (uint8_t)(token[0] - '0');
+    return 0;
+  }
+
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    if (prv_level_name_equals(token, names[i].name)) {
+      *level = names[i].level;
+      return 0;
+    }
+  }
+
+  return -EINVAL;
+}
+
+/**
+ * @brief Trim leading and trailing whitespace in place
+ *
+ * @param start Start of token
+ * @param end One past end of token
+ * @return Pointer to trimmed, null terminated token
+ */
+static char *prv_trim(char *start, char *end) {
+  while (start < end && (*start == ' ' || *start == '\t')) {
+    start++;
+  }
+
+  while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+    end--;
+  }
+
+  *end = '\0';
+
+  return start;
+}
+
+/**
+ * @brief Parse spec string into compiled spec
+ *
+ * @param spec Spec string
+ * @param out Compiled spec
+ * @return 0 on success, negative errno on error
+ */
+static int prv_compile_spec(const char *spec, log_filter_spec_t *out) {
+  size_t len = strlen(spec);
+
+  if (len >= sizeof(out->buffer)) {
+    return -ENOSPC;
+  }
+
+  memcpy(out->buffer, spec, len + 1);
+  out->rule_count = 0;
+  out->fallback_level = LOG_FILTER_DEFAULT_LEVEL;
+
+  char *cursor = out->buffer;
+  bool has_catch_all = false;
+
+  while (*cursor) {
+    char *rule_end = strchr(cursor, ',');
+    if (rule_end == NULL) {
+      rule_end = cursor + strlen(cursor);
+    }
+
+    bool last_rule = (*rule_end == '\0');
+
+    char *equals = memchr(cursor, '=', (size_t)(rule_end - cursor));
+    if (equals == NULL) {
+      return -EINVAL;
+    }
+
+    char *pattern = prv_trim(cursor, equals);
+    char *level_token = prv_trim(equals + 1, rule_end);
+
+    if (*pattern == '\0') {
+      return -EINVAL;
+    }
+
+    if (out->rule_count >= LOG_FILTER_MAX_RULES) {
+      return -ENOSPC;
+    }
+
+    log_filter_rule_t *rule = &out->rules[out->rule_count];
+
+    if (prv_parse_level(level_token, &rule->level) != 0) {
+      return -EINVAL;
+    }
+
+    rule->pattern_offset = (uint16_t)(pattern - out->buffer);
+    rule->is_glob = strpbrk(pattern, "*?") != NULL;
+    rule->pattern_hash = rule->is_glob ? 0 : log_module_hash(pattern);
+
+    // Catch-all rule also covers modules without a table slot
+    if (!has_catch_all && pattern[0] == '*' && pattern[1] == '\0') {
+      out->fallback_level = rule->level;
+      has_catch_all = true;
+    }
+
+    out->rule_count++;
+
+    if (last_rule) {
+      break;
+    }
+
+    cursor = rule_end + 1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Resolve level for module against compiled spec
+ *
+ * @param spec Compiled spec
+ * @param module Module descriptor
+ * @return Level of first matching rule or fallback level
+ */
+static uint8_t prv_resolve_level(const log_filter_spec_t *spec,
+                                 const log_module_t *module) {
+  for (uint8_t i = 0; i < spec->rule_count; i++) {
+    const log_filter_rule_t *rule = &spec->rules[i];
+    const char *pattern = &spec->buffer[rule->pattern_offset];
+
+    if (rule->is_glob) {
+      if (prv_glob_match(pattern, module->name)) {
+        return rule->level;
+      }
+    } else if (rule->pattern_hash == module->name_hash &&
+               strcmp(pattern, module->name) == 0) {
+      return rule->level;
+    }
+  }
+
+  return spec->fallback_level;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_filter_apply(const char *spec) {
+  if (spec == NULL) {
+    return -EINVAL;
+  }
+
+  // Compiled on the caller's stack so concurrent calls do not interfere
+  log_filter_spec_t staging;
+
+  int ret = prv_compile_spec(spec, &staging);
+  if (ret != 0) {
+    return ret;
+  }
+
+  UBaseType_t saved_isr_state = prv_enter_critical(false);
+  memcpy(&prv_inst.active, &staging, sizeof(prv_inst.active));
+  prv_inst.has_spec = true;
+  prv_exit_critical(false, saved_isr_state);
+
+  uint8_t count = log_module_get_count();
+
+  for (uint8_t id = 0; id < count; id++) {
+    log_filter_update_module(id);
+  }
+
+  log_filter_module_levels[LOG_MODULE_ID_OVERFLOW] =
+      prv_inst.active.fallback_level;
+
+  return 0;
+}
+
+void log_filter_update_module(uint8_t module_id) {
+  const log_module_t *module = log_module_get(module_id);
+  if (module == NULL) {
+    return;
+  }
+
+  uint8_t level = LOG_FILTER_DEFAULT_LEVEL;
+  bool in_isr = xPortIsInsideInterrupt();
+
+  UBaseType_t saved_isr_state = prv_enter_critical(in_isr);
+
+  if (prv_inst.has_spec) {
+    level = prv_resolve_level(&prv_inst.active, module);
+  }
+
+  log_filter_module_levels[module_id] = level;
+  log_filter_module_levels[LOG_MODULE_ID_OVERFLOW] =
+      prv_inst.has_spec ? prv_inst.active.fallback_level
+                        : LOG_FILTER_DEFAULT_LEVEL;
+
+  prv_exit_critical(in_isr, saved_isr_state);
+}
+
+uint8_t log_filter_get_module_level(uint8_t module_id) {
+  if (module_id > LOG_MODULE_ID_OVERFLOW) {
+    return LOG_LEVEL_NONE;
+  }
+
+  return log_filter_module_levels[module_id];
+}
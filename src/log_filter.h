@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_filter.h
+ * @author Evan Stoddard
+ * @brief Runtime per-module level filtering
+ */
+
+#ifndef log_filter_h
+#define log_filter_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "log_config.h"
+#include "log_module.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Compiled per-module level table indexed by module ID
+ *
+ * The extra trailing entry is shared by modules registered after the module
+ * table is full.  Only written by the filter, read on every log call.
+ */
+extern uint8_t log_filter_module_levels[LOG_MAX_MODULES + 1];
+
+/*****************************************************************************
+ * Inline Function
+ *****************************************************************************/
+
+/**
+ * @brief Check whether a message passes the module's runtime level
+ *
+ * Registers the module on first use.  Afterwards this is a single table
+ * lookup.
+ *
+ * @param module Pointer to module descriptor
+ * @param level Log level of message
+ * @return true if message should be logged
+ */
+static inline bool log_filter_module_enabled(log_module_t *module,
+                                             uint8_t level) {
+  uint8_t id = module->id;
+
+  if (id == LOG_MODULE_ID_UNASSIGNED) {
+    id = log_module_register(module);
+  }
+
+  return level <= log_filter_module_levels[id];
+}
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Parse filter spec and compile it into the module level table
+ *
+ * The spec is a comma separated list of `pattern=LEVEL` rules, e.g.
+ * `"net.*=DBG,drv.spi=WRN,*=INF"`.  Patterns may use `*` and `?` wildcards
+ * and the first matching rule wins.  Levels are `NONE`, `ERR`, `WRN`, `INF`,
+ * `DBG` or their numeric values.  Modules matching no rule use
+ * LOG_FILTER_DEFAULT_LEVEL.  On error the active filter is left untouched.
+ *
+ * @param spec Null terminated filter spec
+ * @return 0 on success, -EINVAL on malformed spec, -ENOSPC if too large
+ */
+int log_filter_apply(const char *spec);
+
+/**
+ * @brief Resolve level of a newly registered module against active spec
+ *
+ * @param module_id Module ID
+ */
+void log_filter_update_module(uint8_t module_id);
+
+/**
+ * @brief Get runtime level of a module
+ *
+ * @param module_id Module ID
+ * @return Maximum level that will be logged for module
+ */
+uint8_t log_filter_get_module_level(uint8_t module_id);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_filter_h */
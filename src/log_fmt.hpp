@@ -0,0 +1,413 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_fmt.hpp
+ * @author Evan Stoddard
+ * @brief Optional C++20 front end accepting {}-style format strings
+ *
+ * The format string is translated by consteval into a printf-style
+ * descriptor stored with the callsite.  The calling task only packs raw
+ * values, the log thread renders them through the normal renderer.
+ */
+
+#ifndef log_fmt_hpp
+#define log_fmt_hpp
+
+#if __cplusplus < 202002L
+#error "log_fmt.hpp requires C++20"
+#endif
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+
+#include "log.hpp"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#define LOG_FMT_IMPL(level, fmt_str, ...)                                      \
+  do {                                                                         \
+    if constexpr ((level) <= LOG_LEVEL_COMPILE_MAX) {                          \
+      static constexpr const char *prv_log_function = __FUNCTION__;            \
+      logger::fmt::write<level, fmt_str>(                                      \
+          []() constexpr { return &prv_log_module; },                          \
+          []() constexpr { return prv_log_function; }, ##__VA_ARGS__);         \
+    }                                                                          \
+  } while (0)
+
+#define LOG_FMT_DBG(fmt_str, ...)                                              \
+  LOG_FMT_IMPL(LOG_LEVEL_DEBUG, fmt_str, ##__VA_ARGS__)
+
+#define LOG_FMT_INF(fmt_str, ...)                                              \
+  LOG_FMT_IMPL(LOG_LEVEL_INFO, fmt_str, ##__VA_ARGS__)
+
+#define LOG_FMT_WRN(fmt_str, ...)                                              \
+  LOG_FMT_IMPL(LOG_LEVEL_WARNING, fmt_str, ##__VA_ARGS__)
+
+#define LOG_FMT_ERR(fmt_str, ...)                                              \
+  LOG_FMT_IMPL(LOG_LEVEL_ERROR, fmt_str, ##__VA_ARGS__)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @brief Serialization trait for user types
+ *
+ * Specialize with a printf-style `format` fragment that replaces `{}` and a
+ * `values` function returning a tuple of the fragment's arguments:
+ *
+ * @code
+ * template <> struct log_serialize<point_t> {
+ *   static constexpr const char *format = "(%d, %d)";
+ *   static auto values(const point_t &p) { return std::tuple(p.x, p.y); }
+ * };
+ * @endcode
+ */
+template <typename T> struct log_serialize;
+
+namespace logger {
+namespace fmt {
+
+/**
+ * @brief String literal usable as a template argument
+ *
+ */
+template <std::size_t N> struct fixed_string {
+  char data[N];
+
+  consteval fixed_string(const char (&str)[N]) {
+    for (std::size_t i = 0; i < N; i++) {
+      data[i] = str[i];
+    }
+  }
+};
+
+namespace detail {
+
+/**
+ * @brief Compile time description of a placeholder's argument type
+ *
+ */
+struct arg_desc_t {
+  const char *fragment; // Replaces the placeholder for log_serialize types
+  const char *length;   // printf length modifier
+  char conversion;      // Default conversion
+  bool is_integer;
+  bool is_unsigned;
+  bool is_float;
+  bool is_string;
+  bool is_pointer;
+};
+
+template <typename T, typename = void> struct has_serialize : std::false_type {};
+
+template <typename T>
+struct has_serialize<T, std::void_t<decltype(log_serialize<T>::format)>>
+    : std::true_type {};
+
+/**
+ * @brief Called when a format is invalid, not constexpr so it stops the build
+ *
+ */
+inline void format_error(const char *) {}
+
+/**
+ * @brief Describe argument type
+ *
+ */
+template <typename T> consteval arg_desc_t describe() {
+  arg_desc_t desc{nullptr, "", 'd', false, false, false, false, false};
+
+  if constexpr (has_serialize<T>::value) {
+    desc.fragment = log_serialize<T>::format;
+  } else if constexpr (std::is_same_v<T, bool>) {
+    desc.conversion = 's';
+    desc.is_string = true;
+  } else if constexpr (std::is_same_v<T, char>) {
+    desc.conversion = 'c';
+    desc.is_integer = true;
+  } else if constexpr (std::is_integral_v<T> || std::is_enum_v<T>) {
+    using U = typename std::conditional_t<std::is_enum_v<T>,
+                                          std::underlying_type<T>,
+                                          std::type_identity<T>>::type;
+    desc.is_integer = true;
+    desc.is_unsigned = std::is_unsigned_v<U>;
+    desc.conversion = desc.is_unsigned ? 'u' : 'd';
+    desc.length = sizeof(U) <= sizeof(int)    ? ""
+                  : sizeof(U) <= sizeof(long) ? "l"
+                                              : "ll";
+  } else if constexpr (std::is_floating_point_v<T>) {
+    static_assert(sizeof(T) <= sizeof(double), "long double is not supported");
+    desc.conversion = 'g';
+    desc.is_float = true;
+  } else if constexpr (std::is_convertible_v<T, const char *>) {
+    desc.conversion = 's';
+    desc.is_string = true;
+  } else if constexpr (std::is_pointer_v<T> || std::is_null_pointer_v<T>) {
+    desc.conversion = 'p';
+    desc.is_pointer = true;
+  } else {
+    static_assert(has_serialize<T>::value,
+                  "type needs a log_serialize specialization");
+  }
+
+  return desc;
+}
+
+/**
+ * @brief Check that a conversion requested in a spec fits the argument
+ *
+ */
+consteval bool conversion_fits(const arg_desc_t &desc, char conversion) {
+  switch (conversion) {
+  case 'd':
+  case 'x':
+  case 'X':
+  case 'o':
+  case 'c':
+    return desc.is_integer;
+  case 'e':
+  case 'E':
+  case 'f':
+  case 'F':
+  case 'g':
+  case 'G':
+    return desc.is_float;
+  case 's':
+    return desc.is_string;
+  case 'p':
+    return desc.is_pointer;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief Output cursor that only counts when out is null
+ *
+ */
+struct writer_t {
+  char *out;
+  std::size_t len;
+
+  consteval void put(char c) {
+    if (out) {
+      out[len] = c;
+    }
+    len++;
+  }
+
+  consteval void put(const char *str) {
+    while (*str) {
+      put(*str++);
+    }
+  }
+};
+
+/**
+ * @brief Translate {}-style format into printf-style descriptor
+ *
+ * Supported placeholders are `{}` and `{:[<>][+ ][#][0][width][.prec][type]}`
+ * where type is one of `d x X o c e E f F g G s p`.  `{{` and `}}` are
+ * literal braces.
+ *
+ * @param fmt {}-style format string
+ * @param args Argument descriptions, one per placeholder
+ * @param count Number of arguments
+ * @param out Output buffer, nullptr to only compute the length
+ * @return Length of translated format excluding null terminator
+ */
+consteval std::size_t translate(const char *fmt, const arg_desc_t *args,
+                                std::size_t count, char *out) {
+  writer_t w{out, 0};
+  std::size_t arg = 0;
+
+  for (const char *p = fmt; *p; p++) {
+    if (*p == '%') {
+      w.put("%%");
+      continue;
+    }
+
+    if (*p == '}') {
+      if (p[1] != '}') {
+        format_error("unmatched '}' in format string");
+      }
+      w.put('}');
+      p++;
+      continue;
+    }
+
+    if (*p != '{') {
+      w.put(*p);
+      continue;
+    }
+
+    if (p[1] == '{') {
+      w.put('{');
+      p++;
+      continue;
+    }
+
+    if (arg >= count) {
+      format_error("more placeholders than arguments");
+    }
+
+    const arg_desc_t &desc = args[arg++];
+    p++;
+
+    if (desc.fragment) {
+      if (*p != '}') {
+        format_error("log_serialize types take no format spec");
+      }
+      w.put(desc.fragment);
+      continue;
+    }
+
+    w.put('%');
+    char conversion = desc.conversion;
+
+    if (*p == ':') {
+      p++;
+
+      if (*p == '<') {
+        w.put('-');
+        p++;
+      } else if (*p == '>') {
+        p++;
+      }
+
+      while (*p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+        w.put(*p++);
+      }
+
+      while (*p >= '0' && *p <= '9') {
+        w.put(*p++);
+      }
+
+      if (*p == '.') {
+        w.put(*p++);
+        while (*p >= '0' && *p <= '9') {
+          w.put(*p++);
+        }
+      }
+
+      if (*p != '}') {
+        if (!conversion_fits(desc, *p)) {
+          format_error("format spec type does not match argument");
+        }
+
+        // Unsigned decimal keeps printing as unsigned
+        conversion = (*p == 'd' && desc.is_unsigned) ? 'u' : *p;
+        p++;
+      }
+    }
+
+    if (*p != '}') {
+      format_error("unterminated placeholder in format string");
+    }
+
+    if (desc.is_integer && conversion != 'c') {
+      w.put(desc.length);
+    }
+    w.put(conversion);
+  }
+
+  if (arg != count) {
+    format_error("fewer placeholders than arguments");
+  }
+
+  if (out) {
+    out[w.len] = '\0';
+  }
+
+  return w.len;
+}
+
+/**
+ * @brief Static printf-style descriptor of a {}-style format
+ *
+ */
+template <fixed_string Fmt, typename... Args> struct descriptor {
+  static constexpr std::array<arg_desc_t, sizeof...(Args)> args = {
+      describe<Args>()...};
+
+  static constexpr std::size_t size =
+      translate(Fmt.data, args.data(), args.size(), nullptr) + 1;
+
+  static consteval std::array<char, size> build() {
+    std::array<char, size> out{};
+    translate(Fmt.data, args.data(), args.size(), out.data());
+    return out;
+  }
+
+  static constexpr std::array<char, size> value = build();
+};
+
+/**
+ * @brief Convert argument into the raw values that get packed
+ *
+ */
+template <typename T> inline auto flatten(const T &value) {
+  using U = std::decay_t<T>;
+
+  if constexpr (has_serialize<U>::value) {
+    return log_serialize<U>::values(value);
+  } else if constexpr (std::is_same_v<U, bool>) {
+    return std::tuple<const char *>(value ? "true" : "false");
+  } else if constexpr (std::is_enum_v<U>) {
+    return std::tuple<std::underlying_type_t<U>>(
+        static_cast<std::underlying_type_t<U>>(value));
+  } else if constexpr (std::is_convertible_v<const T &, const char *>) {
+    return std::tuple<const char *>(value);
+  } else {
+    return std::tuple<U>(value);
+  }
+}
+
+} // namespace detail
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Translate, pack and queue {}-style message
+ *
+ * Normally reached through LOG_FMT_*.  The callsite is owned by this
+ * instantiation, which is unique per call site through the lambda types.
+ *
+ * @param module_fn Lambda returning the module descriptor
+ * @param function_fn Lambda returning the calling function's name
+ * @param args Arguments
+ */
+template <std::uint8_t Level, fixed_string Fmt, typename ModuleFn,
+          typename FunctionFn, typename... Args>
+inline void write(ModuleFn module_fn, FunctionFn function_fn,
+                  const Args &...args) {
+  if constexpr (Level <= LOG_LEVEL_COMPILE_MAX) {
+    using desc = detail::descriptor<Fmt, std::decay_t<Args>...>;
+
+    static log_callsite_t callsite = LOG_CALLSITE_INIT(
+        module_fn(), Level, function_fn(), desc::value.data());
+
+    std::apply(
+        [](const auto &...values) {
+          logger::write<Level>(
+              []() constexpr { return desc::value.data(); }, callsite,
+              values...);
+        },
+        std::tuple_cat(detail::flatten(args)...));
+  }
+}
+
+} // namespace fmt
+} // namespace logger
+
+#endif /* log_fmt_hpp */
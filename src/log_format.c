@@ -11,104 +11,157 @@
 #include "log_format.h"
 
 #include <stdint.h>
-
-#include "log_backend.h"
+#include <string.h>
 
 /*****************************************************************************
  * Functions
  *****************************************************************************/
 
+const char *log_format_next_spec(const char *fmt_str, log_format_spec_t *spec) {
+  if (!fmt_str || !spec)
+    return NULL;
+
+  const char *start = strchr(fmt_str, '%');
+  if (!start)
+    return NULL;
+
+  const char *p = start + 1;
+
+  spec->start = start;
+  spec->type = LOG_FORMAT_ARG_INVALID;
+  spec->conversion = '\0';
+
+  if (*p == '%') {
+    spec->type = LOG_FORMAT_ARG_NONE;
+    spec->conversion = '%';
+    spec->length = 2;
+    return start;
+  }
+
+  // Skip flags, width, precision
+  while (*p && (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0'))
+    p++;
+  while (*p && (*p >= '0' && *p <= '9'))
+    p++;
+  if (*p == '.') {
+    p++;
+    while (*p && (*p >= '0' && *p <= '9'))
+      p++;
+  }
+
+  // Length modifiers
+  log_format_arg_type_t int_type = LOG_FORMAT_ARG_INT;
+
+  switch (*p) {
+  case 'h':
+    // char and short are promoted to int
+    p += (*(p + 1) == 'h') ? 2 : 1;
+    break;
+  case 'l':
+    if (*(p + 1) == 'l') {
+      int_type = LOG_FORMAT_ARG_LONG_LONG;
+      p += 2;
+    } else {
+      int_type = LOG_FORMAT_ARG_LONG;
+      p++;
+    }
+    break;
+  case 'z':
+    int_type = LOG_FORMAT_ARG_SIZE;
+    p++;
+    break;
+  case 't':
+    int_type = LOG_FORMAT_ARG_PTRDIFF;
+    p++;
+    break;
+  case 'j':
+    int_type = LOG_FORMAT_ARG_INTMAX;
+    p++;
+    break;
+  default:
+    break;
+  }
+
+  // Conversion specifier
+  switch (*p) {
+  case 'd':
+  case 'i':
+  case 'o':
+  case 'u':
+  case 'x':
+  case 'X':
+    spec->type = int_type;
+    break;
+  case 'c':
+    spec->type = LOG_FORMAT_ARG_INT;
+    break;
+  case 'f':
+  case 'F':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+    spec->type = LOG_FORMAT_ARG_DOUBLE;
+    break;
+  case 's':
+    spec->type = LOG_FORMAT_ARG_STRING;
+    break;
+  case 'p':
+    spec->type = LOG_FORMAT_ARG_POINTER;
+    break;
+  case 'n':
+    spec->type = LOG_FORMAT_ARG_WRITEBACK;
+    break;
+  default:
+    // Unsupported (e.g. '*' width), consume nothing and stop here
+    spec->length = (size_t)(p - start);
+    return start;
+  }
+
+  spec->conversion = *p;
+  spec->length = (size_t)(p - start) + 1;
+
+  return start;
+}
+
+size_t log_format_arg_size(log_format_arg_type_t type) {
+  switch (type) {
+  case LOG_FORMAT_ARG_INT:
+    return sizeof(int);
+  case LOG_FORMAT_ARG_LONG:
+    return sizeof(long);
+  case LOG_FORMAT_ARG_LONG_LONG:
+    return sizeof(long long);
+  case LOG_FORMAT_ARG_SIZE:
+    return sizeof(size_t);
+  case LOG_FORMAT_ARG_PTRDIFF:
+    return sizeof(ptrdiff_t);
+  case LOG_FORMAT_ARG_INTMAX:
+    return sizeof(intmax_t);
+  case LOG_FORMAT_ARG_DOUBLE:
+    return sizeof(double);
+  case LOG_FORMAT_ARG_STRING:
+    return sizeof(char *);
+  case LOG_FORMAT_ARG_POINTER:
+    return sizeof(void *);
+  case LOG_FORMAT_ARG_WRITEBACK:
+    return sizeof(int *);
+  default:
+    return 0;
+  }
+}
+
 size_t log_format_calculate_buffer_size(const char *fmt_str) {
   if (!fmt_str)
     return 0;
 
   size_t buffer_size = 0;
+  log_format_spec_t spec;
   const char *p = fmt_str;
 
-  while (*p) {
-    if (*p == '%' && *(p + 1) != '%') {
-      p++; // Skip '%'
-
-      // Skip flags, width, precision
-      while (*p &&
-             (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0'))
-        p++;
-      while (*p && (*p >= '0' && *p <= '9'))
-        p++;
-      if (*p == '.') {
-        p++;
-        while (*p && (*p >= '0' && *p <= '9'))
-          p++;
-      }
-
-      // Handle length modifiers and get the conversion specifier
-      switch (*p) {
-      case 'h':
-        if (*(p + 1) == 'h') {
-          p++;
-          buffer_size += sizeof(int); // char promoted to int
-        } else {
-          buffer_size += sizeof(int); // short promoted to int
-        }
-        p++;
-        break;
-      case 'l':
-        if (*(p + 1) == 'l') {
-          p++;
-          buffer_size += sizeof(long long);
-        } else {
-          buffer_size += sizeof(long);
-        }
-        p++;
-        break;
-      case 'z':
-        buffer_size += sizeof(size_t);
-        p++;
-        break;
-      case 't':
-        buffer_size += sizeof(ptrdiff_t);
-        p++;
-        break;
-      case 'j':
-        buffer_size += sizeof(intmax_t);
-        p++;
-        break;
-      default:
-        // Handle conversion specifiers
-        switch (*p) {
-        case 'd':
-        case 'i':
-        case 'o':
-        case 'u':
-        case 'x':
-        case 'X':
-        case 'c':
-          buffer_size += sizeof(int);
-          break;
-        case 'f':
-        case 'F':
-        case 'e':
-        case 'E':
-        case 'g':
-        case 'G':
-          buffer_size += sizeof(double);
-          break;
-        case 's':
-          buffer_size += sizeof(char *);
-          break;
-        case 'p':
-          buffer_size += sizeof(void *);
-          break;
-        case 'n':
-          buffer_size += sizeof(int *);
-          break;
-        }
-        break;
-      }
-    } else if (*p == '%' && *(p + 1) == '%') {
-      p++; // Skip first '%' of '%%'
-    }
-    p++;
+  while ((p = log_format_next_spec(p, &spec)) != NULL) {
+    buffer_size += log_format_arg_size(spec.type);
+    p += spec.length;
   }
 
   return buffer_size;
@@ -119,108 +172,78 @@ size_t log_format_copy_args_to_buffer(void *buffer, size_t buffer_size,
   if (!buffer || !fmt_str || buffer_size == 0)
     return 0;
 
-  char *buf_ptr = (char *)buffer;
+  uint8_t *buf_ptr = (uint8_t *)buffer;
   size_t bytes_written = 0;
+  log_format_spec_t spec;
   const char *p = fmt_str;
 
-  while (*p && bytes_written < buffer_size) {
-    if (*p == '%' && *(p + 1) != '%') {
-      p++; // Skip '%'
-
-      // Skip flags, width, precision (same logic as size calculation)
-      while (*p &&
-             (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0'))
-        p++;
-      while (*p && (*p >= '0' && *p <= '9'))
-        p++;
-      if (*p == '.') {
-        p++;
-        while (*p && (*p >= '0' && *p <= '9'))
-          p++;
-      }
-
-      // Extract and store arguments based on length modifiers
-      switch (*p) {
-      case 'h':
-        if (*(p + 1) == 'h') {
-          p++;
-          // char promoted to int
-          *(int *)(buf_ptr + bytes_written) = va_arg(args, int);
-          bytes_written += sizeof(int);
-        } else {
-          // short promoted to int
-          *(int *)(buf_ptr + bytes_written) = va_arg(args, int);
-          bytes_written += sizeof(int);
-        }
-        p++;
-        break;
-      case 'l':
-        if (*(p + 1) == 'l') {
-          p++;
-          *(long long *)(buf_ptr + bytes_written) = va_arg(args, long long);
-          bytes_written += sizeof(long long);
-        } else {
-          *(long *)(buf_ptr + bytes_written) = va_arg(args, long);
-          bytes_written += sizeof(long);
-        }
-        p++;
-        break;
-      case 'z':
-        *(size_t *)(buf_ptr + bytes_written) = va_arg(args, size_t);
-        bytes_written += sizeof(size_t);
-        p++;
-        break;
-      case 't':
-        *(ptrdiff_t *)(buf_ptr + bytes_written) = va_arg(args, ptrdiff_t);
-        bytes_written += sizeof(ptrdiff_t);
-        p++;
-        break;
-      case 'j':
-        *(intmax_t *)(buf_ptr + bytes_written) = va_arg(args, intmax_t);
-        bytes_written += sizeof(intmax_t);
-        p++;
-        break;
-      default:
-        // Handle conversion specifiers without length modifiers
-        switch (*p) {
-        case 'd':
-        case 'i':
-        case 'o':
-        case 'u':
-        case 'x':
-        case 'X':
-        case 'c':
-          *(int *)(buf_ptr + bytes_written) = va_arg(args, int);
-          bytes_written += sizeof(int);
-          break;
-        case 'f':
-        case 'F':
-        case 'e':
-        case 'E':
-        case 'g':
-        case 'G':
-          *(double *)(buf_ptr + bytes_written) = va_arg(args, double);
-          bytes_written += sizeof(double);
-          break;
-        case 's':
-          *(char **)(buf_ptr + bytes_written) = va_arg(args, char *);
-          bytes_written += sizeof(char *);
-          break;
-        case 'p':
-          *(void **)(buf_ptr + bytes_written) = va_arg(args, void *);
-          bytes_written += sizeof(void *);
-          break;
-        case 'n':
-          *(int **)(buf_ptr + bytes_written) = va_arg(args, int *);
-          bytes_written += sizeof(int *);
-          break;
-        }
-        break;
-      }
-    } else if (*p == '%' && *(p + 1) == '%') {
-      p++; // Skip first '%' of '%%'
+  while ((p = log_format_next_spec(p, &spec)) != NULL) {
+    p += spec.length;
+
+    size_t arg_size = log_format_arg_size(spec.type);
+    if (arg_size == 0)
+      continue;
+
+    if (bytes_written + arg_size > buffer_size)
+      break;
+
+    // Extract and store arguments, memcpy as the buffer is only 4-byte aligned
+    switch (spec.type) {
+    case LOG_FORMAT_ARG_INT: {
+      int value = va_arg(args, int);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
     }
-    p++;
+    case LOG_FORMAT_ARG_LONG: {
+      long value = va_arg(args, long);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
+    }
+    case LOG_FORMAT_ARG_LONG_LONG: {
+      long long value = va_arg(args, long long);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
+    }
+    case LOG_FORMAT_ARG_SIZE: {
+      size_t value = va_arg(args, size_t);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
+    }
+    case LOG_FORMAT_ARG_PTRDIFF: {
+      ptrdiff_t value = va_arg(args, ptrdiff_t);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
+    }
+    case LOG_FORMAT_ARG_INTMAX: {
+      intmax_t value = va_arg(args, intmax_t);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
+    }
+    case LOG_FORMAT_ARG_DOUBLE: {
+      double value = va_arg(args, double);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
+    }
+    case LOG_FORMAT_ARG_STRING: {
+      char *value = va_arg(args, char *);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
+    }
+    case LOG_FORMAT_ARG_POINTER: {
+      void *value = va_arg(args, void *);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
+    }
+    case LOG_FORMAT_ARG_WRITEBACK: {
+      int *value = va_arg(args, int *);
+      memcpy(buf_ptr + bytes_written, &value, sizeof(value));
+      break;
+    }
+    default:
+      break;
+    }
+
+    bytes_written += arg_size;
   }
 
   return bytes_written;
@@ -18,10 +18,63 @@
 extern "C" {
 #endif
 
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_format_arg_type_t
+ * @brief Type an argument is stored as in the args buffer
+ *
+ */
+typedef enum log_format_arg_type_t {
+  LOG_FORMAT_ARG_NONE = 0,  // Escaped '%%', consumes no argument
+  LOG_FORMAT_ARG_INVALID,   // Unsupported specifier, rendered literally
+  LOG_FORMAT_ARG_INT,
+  LOG_FORMAT_ARG_LONG,
+  LOG_FORMAT_ARG_LONG_LONG,
+  LOG_FORMAT_ARG_SIZE,
+  LOG_FORMAT_ARG_PTRDIFF,
+  LOG_FORMAT_ARG_INTMAX,
+  LOG_FORMAT_ARG_DOUBLE,
+  LOG_FORMAT_ARG_STRING,
+  LOG_FORMAT_ARG_POINTER,
+  LOG_FORMAT_ARG_WRITEBACK, // '%n', consumes a pointer but renders nothing
+} log_format_arg_type_t;
+
+/**
+ * @typedef log_format_spec_t
+ * @brief Single conversion specifier within a format string
+ *
+ */
+typedef struct log_format_spec_t {
+  const char *start;
+  size_t length;
+  char conversion;
+  log_format_arg_type_t type;
+} log_format_spec_t;
+
 /*****************************************************************************
  * Function Prototypes
  *****************************************************************************/
 
+/**
+ * @brief Find next conversion specifier in format string
+ *
+ * @param fmt_str Position in format string to start scanning from
+ * @param spec Filled with the specifier found
+ * @return Pointer to the '%' of the specifier, or NULL if none left
+ */
+const char *log_format_next_spec(const char *fmt_str, log_format_spec_t *spec);
+
+/**
+ * @brief Get number of bytes an argument type occupies in the args buffer
+ *
+ * @param type Argument type
+ * @return Size in bytes
+ */
+size_t log_format_arg_size(log_format_arg_type_t type);
+
 /**
  * @brief Calculate required buffer size by parsing format string
  *
@@ -44,4 +97,4 @@ size_t log_format_copy_args_to_buffer(void *buffer, size_t buffer_size, const ch
 #ifdef __cplusplus
 }
 #endif
-#endif /* log_format_h */
\ No newline at end of file
+#endif /* log_format_h */
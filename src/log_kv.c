@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_kv.c
+ * @author Evan Stoddard
+ * @brief Typed structured key/value fields implementation
+ */
+
+#include "log_kv.h"
+
+#include <string.h>
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+size_t log_kv_value_size(log_kv_type_t type) {
+  switch (type) {
+  case LOG_KV_TYPE_BOOL:
+    return sizeof(uint8_t);
+  case LOG_KV_TYPE_I32:
+  case LOG_KV_TYPE_U32:
+    return sizeof(uint32_t);
+  case LOG_KV_TYPE_I64:
+  case LOG_KV_TYPE_U64:
+    return sizeof(uint64_t);
+  case LOG_KV_TYPE_F32:
+    return sizeof(float);
+  case LOG_KV_TYPE_F64:
+    return sizeof(double);
+  case LOG_KV_TYPE_STR:
+    return sizeof(const char *);
+  default:
+    return 0;
+  }
+}
+
+size_t log_kv_calculate_buffer_size(const log_kv_key_t *keys, uint8_t count) {
+  size_t size = 0;
+
+  if (keys == NULL) {
+    return 0;
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    size += 1 + log_kv_value_size(keys[i].type);
+  }
+
+  return size;
+}
+
+size_t log_kv_pack(void *buffer, size_t buffer_size, const log_kv_key_t *keys,
+                   const log_kv_value_t *values, uint8_t count) {
+  if (buffer == NULL || keys == NULL || values == NULL) {
+    return 0;
+  }
+
+  uint8_t *out = (uint8_t *)buffer;
+  size_t offset = 0;
+
+  for (uint8_t i = 0; i < count; i++) {
+    size_t size = log_kv_value_size(keys[i].type);
+
+    if (size == 0 || offset + 1 + size > buffer_size) {
+      return 0;
+    }
+
+    out[offset++] = (uint8_t)keys[i].type;
+
+    if (keys[i].type == LOG_KV_TYPE_BOOL) {
+      out[offset] = values[i].b ? 1 : 0;
+    } else {
+      // Union members share the start address, so copy the leading bytes
+      memcpy(&out[offset], &values[i], size);
+    }
+
+    offset += size;
+  }
+
+  return offset;
+}
+
+bool log_kv_next(const void *buffer, size_t buffer_size, size_t *offset,
+                 log_kv_type_t *type, log_kv_value_t *value) {
+  if (buffer == NULL || offset == NULL || type == NULL || value == NULL ||
+      *offset >= buffer_size) {
+    return false;
+  }
+
+  const uint8_t *in = (const uint8_t *)buffer;
+  log_kv_type_t tag = (log_kv_type_t)in[*offset];
+  size_t size = log_kv_value_size(tag);
+
+  if (size == 0 || *offset + 1 + size > buffer_size) {
+    return false;
+  }
+
+  memset(value, 0, sizeof(*value));
+
+  if (tag == LOG_KV_TYPE_BOOL) {
+    value->b = in[*offset + 1] != 0;
+  } else {
+    memcpy(value, &in[*offset + 1], size);
+  }
+
+  *type = tag;
+  *offset += 1 + size;
+
+  return true;
+}
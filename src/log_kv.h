@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_kv.h
+ * @author Evan Stoddard
+ * @brief Typed structured key/value fields
+ */
+
+#ifndef log_kv_h
+#define log_kv_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Maximum number of fields in a single LOG_KV_* call */
+#define LOG_KV_MAX_FIELDS 8
+
+/**
+ * @brief Field constructors
+ *
+ * Expand to a (type, key, value) tuple that LOG_KV_* splits into a static
+ * key table and the runtime values.
+ */
+#define KV_BOOL(key, value) (BOOL, key, value)
+#define KV_I32(key, value) (I32, key, value)
+#define KV_U32(key, value) (U32, key, value)
+#define KV_I64(key, value) (I64, key, value)
+#define KV_U64(key, value) (U64, key, value)
+#define KV_F32(key, value) (F32, key, value)
+#define KV_F64(key, value) (F64, key, value)
+#define KV_STR(key, value) (STR, key, value)
+
+/** @brief Key table entry of a field tuple */
+#define LOG_KV_KEY_ENTRY(t, k, v) {.key = (k), .type = LOG_KV_TYPE_##t},
+
+/** @brief Runtime value of a field tuple */
+#define LOG_KV_VALUE_ENTRY(t, k, v) LOG_KV_VALUE_##t(v),
+
+#define LOG_KV_VALUE_BOOL(v) {.b = (bool)(v)}
+#define LOG_KV_VALUE_I32(v) {.i32 = (int32_t)(v)}
+#define LOG_KV_VALUE_U32(v) {.u32 = (uint32_t)(v)}
+#define LOG_KV_VALUE_I64(v) {.i64 = (int64_t)(v)}
+#define LOG_KV_VALUE_U64(v) {.u64 = (uint64_t)(v)}
+#define LOG_KV_VALUE_F32(v) {.f32 = (float)(v)}
+#define LOG_KV_VALUE_F64(v) {.f64 = (double)(v)}
+#define LOG_KV_VALUE_STR(v) {.str = (v)}
+
+/** @brief Number of field tuples passed, at most LOG_KV_MAX_FIELDS */
+#define LOG_KV_COUNT(...)                                                      \
+  LOG_KV_COUNT_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_KV_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+
+/** @brief Apply macro to every field tuple */
+#define LOG_KV_FOR_EACH(m, ...)                                                \
+  LOG_KV_FOR_EACH_(LOG_KV_COUNT(__VA_ARGS__), m, __VA_ARGS__)
+#define LOG_KV_FOR_EACH_(n, m, ...) LOG_KV_FOR_EACH__(n, m, __VA_ARGS__)
+#define LOG_KV_FOR_EACH__(n, m, ...) LOG_KV_FE_##n(m, __VA_ARGS__)
+#define LOG_KV_FE_1(m, a) m a
+#define LOG_KV_FE_2(m, a, ...) m a LOG_KV_FE_1(m, __VA_ARGS__)
+#define LOG_KV_FE_3(m, a, ...) m a LOG_KV_FE_2(m, __VA_ARGS__)
+#define LOG_KV_FE_4(m, a, ...) m a LOG_KV_FE_3(m, __VA_ARGS__)
+#define LOG_KV_FE_5(m, a, ...) m a LOG_KV_FE_4(m, __VA_ARGS__)
+#define LOG_KV_FE_6(m, a, ...) m a LOG_KV_FE_5(m, __VA_ARGS__)
+#define LOG_KV_FE_7(m, a, ...) m a LOG_KV_FE_6(m, __VA_ARGS__)
+#define LOG_KV_FE_8(m, a, ...) m a LOG_KV_FE_7(m, __VA_ARGS__)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_kv_type_t
+ * @brief Type tag of a field in the message payload
+ *
+ */
+typedef enum log_kv_type_t {
+  LOG_KV_TYPE_BOOL = 1,
+  LOG_KV_TYPE_I32,
+  LOG_KV_TYPE_U32,
+  LOG_KV_TYPE_I64,
+  LOG_KV_TYPE_U64,
+  LOG_KV_TYPE_F32,
+  LOG_KV_TYPE_F64,
+  LOG_KV_TYPE_STR,
+} log_kv_type_t;
+
+/**
+ * @typedef log_kv_key_t
+ * @brief Compile time key table entry, one per field of a callsite
+ *
+ */
+typedef struct log_kv_key_t {
+  const char *key;
+  log_kv_type_t type;
+} log_kv_key_t;
+
+/**
+ * @typedef log_kv_value_t
+ * @brief Runtime field value, interpreted through the key table's type
+ *
+ * Strings are stored by pointer and must outlive the message, like `%s`.
+ */
+typedef union log_kv_value_t {
+  bool b;
+  int32_t i32;
+  uint32_t u32;
+  int64_t i64;
+  uint64_t u64;
+  float f32;
+  double f64;
+  const char *str;
+} log_kv_value_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Get number of payload bytes a value of type occupies
+ *
+ * @param type Type tag
+ * @return Size in bytes, 0 for unknown types
+ */
+size_t log_kv_value_size(log_kv_type_t type);
+
+/**
+ * @brief Calculate payload size of fields
+ *
+ * Each field is stored as a one byte type tag followed by its value.
+ *
+ * @param keys Key table
+ * @param count Number of fields
+ * @return Size in bytes
+ */
+size_t log_kv_calculate_buffer_size(const log_kv_key_t *keys, uint8_t count);
+
+/**
+ * @brief Pack type tagged values into payload
+ *
+ * @param buffer Destination buffer
+ * @param buffer_size Size of destination buffer
+ * @param keys Key table
+ * @param values Values, one per key
+ * @param count Number of fields
+ * @return Number of bytes written, or 0 on error
+ */
+size_t log_kv_pack(void *buffer, size_t buffer_size, const log_kv_key_t *keys,
+                   const log_kv_value_t *values, uint8_t count);
+
+/**
+ * @brief Read next field from payload
+ *
+ * @param buffer Payload
+ * @param buffer_size Size of payload
+ * @param offset Read position, advanced past the field
+ * @param type Type tag of field
+ * @param value Value of field
+ * @return true if a field was read
+ */
+bool log_kv_next(const void *buffer, size_t buffer_size, size_t *offset,
+                 log_kv_type_t *type, log_kv_value_t *value);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_kv_h */
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_module.c
+ * @author Evan Stoddard
+ * @brief Log module registry implementation
+ */
+
+#include "log_module.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+// FreeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "log_filter.h"
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance
+ */
+static struct {
+  const log_module_t *modules[LOG_MAX_MODULES];
+  uint8_t count;
+} prv_inst;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Find registered module with matching name
+ *
+ * @param name Module name
+ * @param hash Hash of module name
+ * @return Module ID, or LOG_MODULE_ID_OVERFLOW if not found
+ */
+static uint8_t prv_find_module(const char *name, uint32_t hash) {
+  for (uint8_t i = 0; i < prv_inst.count; i++) {
+    const log_module_t *module = prv_inst.modules[i];
+
+    if (module->name_hash == hash && strcmp(module->name, name) == 0) {
+      return i;
+    }
+  }
+
+  return LOG_MODULE_ID_OVERFLOW;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+uint32_t log_module_hash(const char *name) {
+  uint32_t hash = LOG_MODULE_FNV_OFFSET_BASIS;
+
+  if (name == NULL) {
+    return hash;
+  }
+
+  while (*name) {
+    hash ^= (uint8_t)*name++;
+    hash *= LOG_MODULE_FNV_PRIME;
+  }
+
+  return hash;
+}
+
+uint8_t log_module_register(log_module_t *module) {
+  if (module == NULL || module->name == NULL) {
+    return LOG_MODULE_ID_OVERFLOW;
+  }
+
+  if (module->id != LOG_MODULE_ID_UNASSIGNED) {
+    return module->id;
+  }
+
+  // Already set for modules declared in C++
+  if (module->name_hash == 0) {
+    module->name_hash = log_module_hash(module->name);
+  }
+
+  bool is_new = false;
+  UBaseType_t saved_isr_state = 0;
+  bool in_isr = xPortIsInsideInterrupt();
+
+  if (in_isr) {
+    saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+  } else {
+    taskENTER_CRITICAL();
+  }
+
+  uint8_t id = prv_find_module(module->name, module->name_hash);
+
+  if (id == LOG_MODULE_ID_OVERFLOW && prv_inst.count < LOG_MAX_MODULES) {
+    id = prv_inst.count;
+    prv_inst.modules[prv_inst.count++] = module;
+    is_new = true;
+  }
+
+  if (in_isr) {
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskEXIT_CRITICAL();
+  }
+
+  // Resolve level before publishing the ID so the first message is filtered
+  if (is_new) {
+    log_filter_update_module(id);
+  }
+
+  module->id = id;
+
+  return id;
+}
+
+uint8_t log_module_get_count(void) { return prv_inst.count; }
+
+const log_module_t *log_module_get(uint8_t id) {
+  if (id >= prv_inst.count) {
+    return NULL;
+  }
+
+  return prv_inst.modules[id];
+}
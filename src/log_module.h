@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_module.h
+ * @author Evan Stoddard
+ * @brief Log module registry
+ */
+
+#ifndef log_module_h
+#define log_module_h
+
+#include <stdint.h>
+
+#include "log_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief ID of a module that has not been registered yet */
+#define LOG_MODULE_ID_UNASSIGNED 0xFF
+
+/** @brief Shared ID handed out once the module table is full */
+#define LOG_MODULE_ID_OVERFLOW LOG_MAX_MODULES
+
+// The overflow ID must stay distinct from the unassigned one
+#ifdef __cplusplus
+static_assert(LOG_MAX_MODULES < LOG_MODULE_ID_UNASSIGNED,
+              "LOG_MAX_MODULES must be at most 254");
+#else
+_Static_assert(LOG_MAX_MODULES < LOG_MODULE_ID_UNASSIGNED,
+               "LOG_MAX_MODULES must be at most 254");
+#endif
+
+/** @brief FNV-1a 32-bit offset basis */
+#define LOG_MODULE_FNV_OFFSET_BASIS 0x811C9DC5u
+
+/** @brief FNV-1a 32-bit prime */
+#define LOG_MODULE_FNV_PRIME 0x01000193u
+
+/**
+ * @brief Hash of a module name known at compile time
+ *
+ * C++ computes it in a constexpr, C leaves it to log_module_register.
+ *
+ * @param module_name_str Module name string literal
+ */
+#ifdef __cplusplus
+#define LOG_MODULE_NAME_HASH(module_name_str)                                  \
+  log_module_hash_constexpr(module_name_str, LOG_MODULE_FNV_OFFSET_BASIS)
+#else
+#define LOG_MODULE_NAME_HASH(module_name_str) 0
+#endif
+
+/**
+ * @brief Static initializer for a module descriptor
+ *
+ * @param module_name_str Module name string literal
+ */
+#define LOG_MODULE_INIT(module_name_str)                                       \
+  {                                                                            \
+      .name = (module_name_str),                                               \
+      .name_hash = LOG_MODULE_NAME_HASH(module_name_str),                      \
+      .id = LOG_MODULE_ID_UNASSIGNED,                                          \
+  }
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_module_t
+ * @brief Per-source-file module descriptor
+ *
+ * Created by LOG_REGISTER_MODULE and registered lazily on the first log
+ * call, at which point the compact ID and, unless C++ already computed it,
+ * the name hash are filled in.
+ */
+typedef struct log_module_t {
+  const char *name;
+  uint32_t name_hash;
+  uint8_t id;
+} log_module_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Register module and assign it a compact ID (ISR safe)
+ *
+ * Modules with the same name share an ID.  Calling this on an already
+ * registered module is a no-op.
+ *
+ * @param module Pointer to module descriptor
+ * @return Assigned module ID
+ */
+uint8_t log_module_register(log_module_t *module);
+
+/**
+ * @brief Get number of registered modules
+ *
+ * @return Number of modules in the registry
+ */
+uint8_t log_module_get_count(void);
+
+/**
+ * @brief Look up a registered module by ID
+ *
+ * @param id Module ID
+ * @return Pointer to module descriptor, or NULL if unknown
+ */
+const log_module_t *log_module_get(uint8_t id);
+
+/**
+ * @brief Compute FNV-1a hash of a module name
+ *
+ * @param name Null terminated module name
+ * @return 32-bit hash
+ */
+uint32_t log_module_hash(const char *name);
+
+#ifdef __cplusplus
+}
+
+/**
+ * @brief Compute FNV-1a hash of a module name at compile time
+ *
+ * @param name Null terminated module name
+ * @param hash Hash of the characters before `name`
+ * @return 32-bit hash, same as log_module_hash
+ */
+constexpr uint32_t log_module_hash_constexpr(const char *name, uint32_t hash) {
+  return *name == '\0'
+             ? hash
+             : log_module_hash_constexpr(
+                   name + 1, (hash ^ (uint8_t)*name) * LOG_MODULE_FNV_PRIME);
+}
+#endif
+#endif /* log_module_h */
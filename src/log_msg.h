@@ -18,29 +18,100 @@
 extern "C" {
 #endif
 
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Mask of log level within log_msg_t::level_flags */
+#define LOG_MSG_LEVEL_MASK 0x07
+
+/** @brief Mask of flags within log_msg_t::level_flags */
+#define LOG_MSG_FLAGS_MASK 0xF8
+
+/**
+ * @brief Message is followed by a uint32_t count of suppressed messages
+ *
+ * Set by rate limited callsites.  The count occupies the last 4 bytes of the
+ * argument buffer.
+ */
+#define LOG_MSG_FLAG_SUPPRESSED 0x08
+
+/**
+ * @brief Argument buffer holds type tagged key/value fields
+ *
+ * Field keys are taken in order from the callsite's key table.
+ */
+#define LOG_MSG_FLAG_KV 0x10
+
+/**
+ * @brief Message opens a trace span
+ *
+ * The callsite's format string is the span name, the argument buffer is
+ * empty.  The task or ISR that opened it is in the header context.
+ */
+#define LOG_MSG_FLAG_SPAN_BEGIN 0x20
+
+/** @brief Message closes a trace span, see LOG_MSG_FLAG_SPAN_BEGIN */
+#define LOG_MSG_FLAG_SPAN_END 0x40
+
+/**
+ * @brief String arguments point into memory of an earlier run
+ *
+ * Set on messages read back from storage that survives a reset.  Renderers
+ * print the address as `<str@0x...>` instead of following the pointer.
+ */
+#define LOG_MSG_FLAG_STALE_STRINGS 0x80
+
+/** @brief Maximum size of a message's argument buffer */
+#define LOG_MSG_MAX_ARGS_SIZE UINT16_MAX
+
+/**
+ * @brief Get log level of message
+ *
+ * @param msg Pointer to message
+ */
+#define LOG_MSG_GET_LEVEL(msg) ((msg)->level_flags & LOG_MSG_LEVEL_MASK)
+
+/**
+ * @brief Check if flag is set on message
+ *
+ * @param msg Pointer to message
+ * @param flag Flag to check
+ */
+#define LOG_MSG_HAS_FLAG(msg, flag) (((msg)->level_flags & (flag)) != 0)
+
 /*****************************************************************************
  * Structs, Unions, Enums, & Typedefs
  *****************************************************************************/
 
 /**
- * @brief Log message structure with variable-length args buffer
+ * @brief Compact log message header with variable-length args buffer
+ *
+ * Format string, function and module name are resolved on the log thread
+ * through the callsite and module registries.  `context` identifies the
+ * producing task or ISR and core, see log_context.h.
  */
 typedef struct log_msg_t {
-  const char *module_name;
-  const char *function_name;
-  uint8_t log_level;
-  const char *fmt_str;
-  size_t args_buffer_size;
+  uint16_t callsite_id;
+  uint8_t level_flags;
+  uint8_t module_id;
+  uint32_t timestamp;
+  uint16_t args_buffer_size;
+  uint16_t context;
   uint8_t args_buffer[];  // Variable length array (C99 flexible array member)
 } log_msg_t;
 
 /**
  * @brief Calculate the total size needed for a log message
  *
+ * Rounded up to a multiple of 4 bytes so consecutive messages in the pool
+ * stay aligned.
+ *
  * @param args_size Size of the arguments buffer
  * @return Total size in bytes for the log message
  */
-#define LOG_MSG_SIZE(args_size) (sizeof(log_msg_t) + (args_size))
+#define LOG_MSG_SIZE(args_size)                                                \
+  ((sizeof(log_msg_t) + (args_size) + 3u) & ~(size_t)3u)
 
 #ifdef __cplusplus
 }
@@ -12,127 +12,232 @@
 #include "log_config.h"
 
 #include <errno.h>
+#include <stdint.h>
 
 // FreeRTOS includes
 #include "FreeRTOS.h"
-#include "semphr.h"
+#include "task.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#if (LOG_BUFFER_SIZE_BYTES % 4) != 0
+#error "LOG_BUFFER_SIZE_BYTES must be a multiple of 4"
+#endif
+
+#if (LOG_BUFFER_SIZE_BYTES / 4) > UINT16_MAX
+#error "LOG_BUFFER_SIZE_BYTES too large for block headers"
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef prv_block_t
+ * @brief Header in front of every message in the pool
+ *
+ * A block with no references is free, or padding skipped at the end of the
+ * ring.  Either way it is reclaimed once it is the oldest block.
+ */
+typedef struct prv_block_t {
+  uint16_t words;
+  uint8_t refs;
+  uint8_t reserved;
+} prv_block_t;
 
 /*****************************************************************************
  * Variables
  *****************************************************************************/
 
-// Buffer pool management
-static uint8_t prv_log_buffer_pool[LOG_BUFFER_SIZE_BYTES];
+// Buffer pool management, blocks are allocated at head and reclaimed at tail
+static uint8_t prv_log_buffer_pool[LOG_BUFFER_SIZE_BYTES]
+    __attribute__((aligned(8)));
+static size_t prv_log_buffer_head = 0;
+static size_t prv_log_buffer_tail = 0;
 static size_t prv_log_buffer_used = 0;
 
-static SemaphoreHandle_t prv_log_pool_mutex = NULL;
-static StaticSemaphore_t prv_log_mutex_storage;
-
 /*****************************************************************************
- * Functions
+ * Private Functions
  *****************************************************************************/
 
-int log_pool_init(void) {
-  // Create mutex for buffer pool protection using static allocation
-  prv_log_pool_mutex = xSemaphoreCreateMutexStatic(&prv_log_mutex_storage);
-  if (!prv_log_pool_mutex) {
-    return -EIO;
-  }
+/**
+ * @brief Get block header of message
+ *
+ * @param msg Log message allocated from the pool
+ * @return Block header
+ */
+static prv_block_t *prv_block(const log_msg_t *msg) {
+  return (prv_block_t *)((uint8_t *)msg - sizeof(prv_block_t));
+}
 
-  // Initialize buffer pool
-  prv_log_buffer_used = 0;
+/**
+ * @brief Write block header
+ *
+ * @param offset Offset of block in pool
+ * @param size Size of block in bytes
+ * @param refs Initial reference count
+ */
+static void prv_put_block(size_t offset, size_t size, uint8_t refs) {
+  prv_block_t *block = (prv_block_t *)(prv_log_buffer_pool + offset);
 
-  return 0;
+  block->words = (uint16_t)(size / 4u);
+  block->refs = refs;
+  block->reserved = 0;
 }
 
-log_msg_t *log_pool_alloc(size_t args_size) {
-  size_t total_size = LOG_MSG_SIZE(args_size);
+/**
+ * @brief Allocate message, caller must hold the pool critical section
+ *
+ * @param args_size Size needed for arguments buffer
+ * @return Allocated log message, or NULL if insufficient space
+ */
+static log_msg_t *prv_alloc_locked(size_t args_size) {
+  size_t total_size = sizeof(prv_block_t) + LOG_MSG_SIZE(args_size);
 
-  if (prv_log_pool_mutex == NULL) {
-    return NULL;
+  if (total_size > LOG_BUFFER_SIZE_BYTES - prv_log_buffer_used) {
+    return NULL; // Out of space
   }
 
-  BaseType_t ret = pdFALSE;
-  BaseType_t higher_prio = pdFALSE;
-
-  // Thread-safe allocation using FreeRTOS mutex
-  if (xPortIsInsideInterrupt()) {
-    ret = xSemaphoreTakeFromISR(prv_log_pool_mutex, &higher_prio);
-  } else {
-    ret = xSemaphoreTake(prv_log_pool_mutex, portMAX_DELAY);
+  // Empty pool, start over so the whole buffer is contiguous
+  if (prv_log_buffer_used == 0) {
+    prv_log_buffer_head = 0;
+    prv_log_buffer_tail = 0;
   }
 
-  if (ret == pdFALSE) {
-    if (xPortIsInsideInterrupt()) {
-      portYIELD_FROM_ISR(higher_prio);
-    }
+  if (prv_log_buffer_head >= prv_log_buffer_tail) {
+    size_t end_space = LOG_BUFFER_SIZE_BYTES - prv_log_buffer_head;
 
+    if (total_size > end_space) {
+      // Wrap around, the end of the ring is skipped as padding
+      if (total_size > prv_log_buffer_tail) {
+        return NULL;
+      }
+
+      prv_put_block(prv_log_buffer_head, end_space, 0);
+      prv_log_buffer_used += end_space;
+      prv_log_buffer_head = 0;
+    }
+  } else if (total_size > prv_log_buffer_tail - prv_log_buffer_head) {
     return NULL;
   }
 
-  // Simple linear allocator - in production, use proper memory management
-  if (prv_log_buffer_used + total_size > LOG_BUFFER_SIZE_BYTES) {
-    if (xPortIsInsideInterrupt()) {
-      xSemaphoreGiveFromISR(prv_log_pool_mutex, &higher_prio);
-      portYIELD_FROM_ISR(higher_prio);
-    } else {
-      xSemaphoreGive(prv_log_pool_mutex);
-    }
+  prv_put_block(prv_log_buffer_head, total_size, 1);
 
-    return NULL; // Out of space
-  }
+  log_msg_t *msg = (log_msg_t *)(prv_log_buffer_pool + prv_log_buffer_head +
+                                 sizeof(prv_block_t));
 
-  log_msg_t *msg = (log_msg_t *)(prv_log_buffer_pool + prv_log_buffer_used);
+  prv_log_buffer_head = (prv_log_buffer_head + total_size) %
+                        LOG_BUFFER_SIZE_BYTES;
   prv_log_buffer_used += total_size;
 
   // Initialize the message
-  msg->args_buffer_size = args_size;
-
-  if (xPortIsInsideInterrupt()) {
-    xSemaphoreGiveFromISR(prv_log_pool_mutex, &higher_prio);
-    portYIELD_FROM_ISR(higher_prio);
-  } else {
-    xSemaphoreGive(prv_log_pool_mutex);
-  }
+  msg->args_buffer_size = (uint16_t)args_size;
 
   return msg;
 }
 
-void log_pool_free(log_msg_t *msg) {
-  if (msg == NULL) {
+/**
+ * @brief Drop reference, caller must hold the pool critical section
+ *
+ * @param msg Log message to release
+ */
+static void prv_free_locked(log_msg_t *msg) {
+  prv_block_t *block = prv_block(msg);
+
+  if (block->refs == 0 || --block->refs > 0) {
     return;
   }
 
-  if (prv_log_pool_mutex == NULL) {
-    return;
+  // Messages are usually released in order, reclaim every free block
+  while (prv_log_buffer_used > 0) {
+    block = (prv_block_t *)(prv_log_buffer_pool + prv_log_buffer_tail);
+    if (block->refs != 0) {
+      break;
+    }
+
+    size_t size = (size_t)block->words * 4u;
+    prv_log_buffer_tail = (prv_log_buffer_tail + size) % LOG_BUFFER_SIZE_BYTES;
+    prv_log_buffer_used -= size;
   }
+}
 
-  BaseType_t ret = pdFALSE;
-  BaseType_t higher_prio = pdFALSE;
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_pool_init(void) {
+  // Initialize buffer pool
+  taskENTER_CRITICAL();
+  prv_log_buffer_head = 0;
+  prv_log_buffer_tail = 0;
+  prv_log_buffer_used = 0;
+  taskEXIT_CRITICAL();
+
+  return 0;
+}
+
+log_msg_t *log_pool_alloc(size_t args_size) {
+  taskENTER_CRITICAL();
+  log_msg_t *msg = prv_alloc_locked(args_size);
+  taskEXIT_CRITICAL();
+
+  return msg;
+}
 
-  if (xPortIsInsideInterrupt()) {
-    ret = xSemaphoreTakeFromISR(prv_log_pool_mutex, &higher_prio);
+log_msg_t *log_pool_alloc_from_isr(size_t args_size) {
+  UBaseType_t saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+  log_msg_t *msg = prv_alloc_locked(args_size);
+  taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+
+  return msg;
+}
+
+bool log_pool_owns(const log_msg_t *msg) {
+  const uint8_t *ptr = (const uint8_t *)msg;
+
+  return ptr >= prv_log_buffer_pool + sizeof(prv_block_t) &&
+         ptr < prv_log_buffer_pool + LOG_BUFFER_SIZE_BYTES;
+}
+
+int log_pool_retain(log_msg_t *msg) {
+  int ret = 0;
+
+  if (msg == NULL || !log_pool_owns(msg)) {
+    return -EINVAL;
+  }
+
+  taskENTER_CRITICAL();
+
+  prv_block_t *block = prv_block(msg);
+  if (block->refs == 0 || block->refs == UINT8_MAX) {
+    ret = -EOVERFLOW;
   } else {
-    ret = xSemaphoreTake(prv_log_pool_mutex, portMAX_DELAY);
+    block->refs++;
   }
 
-  if (ret == pdFALSE) {
-    if (xPortIsInsideInterrupt()) {
-      portYIELD_FROM_ISR(higher_prio);
-    }
+  taskEXIT_CRITICAL();
 
+  return ret;
+}
+
+void log_pool_free(log_msg_t *msg) {
+  if (msg == NULL || !log_pool_owns(msg)) {
     return;
   }
 
-  if ((uint8_t *)msg + LOG_MSG_SIZE(msg->args_buffer_size) ==
-      prv_log_buffer_pool + prv_log_buffer_used) {
-    prv_log_buffer_used -= LOG_MSG_SIZE(msg->args_buffer_size);
-  }
+  taskENTER_CRITICAL();
+  prv_free_locked(msg);
+  taskEXIT_CRITICAL();
+}
 
-  if (xPortIsInsideInterrupt()) {
-    xSemaphoreGiveFromISR(prv_log_pool_mutex, &higher_prio);
-    portYIELD_FROM_ISR(higher_prio);
-  } else {
-    xSemaphoreGive(prv_log_pool_mutex);
+void log_pool_free_from_isr(log_msg_t *msg) {
+  if (msg == NULL || !log_pool_owns(msg)) {
+    return;
   }
+
+  UBaseType_t saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+  prv_free_locked(msg);
+  taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
 }
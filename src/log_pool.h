@@ -11,6 +11,7 @@
 #ifndef log_pool_h
 #define log_pool_h
 
+#include <stdbool.h>
 #include <stddef.h>
 #include "log_msg.h"
 
@@ -30,7 +31,7 @@ extern "C" {
 int log_pool_init(void);
 
 /**
- * @brief Allocate a log message from the buffer pool
+ * @brief Allocate a log message from the buffer pool (task context)
  *
  * @param args_size Size needed for arguments buffer
  * @return Allocated log message, or NULL if insufficient space
@@ -38,12 +39,50 @@ int log_pool_init(void);
 log_msg_t *log_pool_alloc(size_t args_size);
 
 /**
- * @brief Free a log message back to the buffer pool
+ * @brief Allocate a log message from the buffer pool (ISR context)
+ *
+ * @param args_size Size needed for arguments buffer
+ * @return Allocated log message, or NULL if insufficient space
+ */
+log_msg_t *log_pool_alloc_from_isr(size_t args_size);
+
+/**
+ * @brief Check if message was allocated from the buffer pool
+ *
+ * @param msg Log message
+ * @return true if the message lives in the pool
+ */
+bool log_pool_owns(const log_msg_t *msg);
+
+/**
+ * @brief Take an additional reference to a message (task context)
+ *
+ * Each reference is dropped with log_pool_free, the message returns to the
+ * pool once the last one is gone.
+ *
+ * @param msg Log message allocated from the pool
+ * @return 0 on success, -EINVAL if not a pool message, -EOVERFLOW if the
+ *         reference count is exhausted
+ */
+int log_pool_retain(log_msg_t *msg);
+
+/**
+ * @brief Drop a reference, freeing the message with the last (task context)
+ *
+ * Messages may be released in any order.  Messages not allocated from the
+ * pool are ignored.
  *
  * @param msg Log message to free
  */
 void log_pool_free(log_msg_t *msg);
 
+/**
+ * @brief Drop a reference, freeing the message with the last (ISR context)
+ *
+ * @param msg Log message to free
+ */
+void log_pool_free_from_isr(log_msg_t *msg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -17,11 +17,15 @@
 // FreeRTOS includes
 #include "FreeRTOS.h"
 #include "queue.h"
+#include "semphr.h"
 #include "task.h"
 
 #include "log_backend.h"
 #include "log_config.h"
+#include "log_dedup.h"
+#include "log_event.h"
 #include "log_pool.h"
+#include "log_timestamp.h"
 
 /*****************************************************************************
  * Variables
@@ -38,10 +42,127 @@ static StaticTask_t prv_log_task_storage;
 static StackType_t
     prv_log_task_stack[LOG_THREAD_STACK_SIZE_BYTES / sizeof(StackType_t)];
 
+// Flush requests travel through the queue behind every pending message
+static log_msg_t prv_flush_marker;
+static SemaphoreHandle_t prv_flush_done = NULL;
+static StaticSemaphore_t prv_flush_done_storage;
+static TickType_t prv_flush_deadline;
+static volatile bool prv_flush_pending = false;
+static volatile int prv_flush_result;
+
 /*****************************************************************************
  * Private Functions
  *****************************************************************************/
 
+/**
+ * @brief Get longest time the log thread may stay idle
+ *
+ * @return Ticks until the timestamp provider must be read again
+ */
+static TickType_t prv_refresh_ticks(void) {
+  uint64_t ticks =
+      (uint64_t)log_timestamp_refresh_ms() * configTICK_RATE_HZ / 1000u;
+
+  if (ticks == 0) {
+    return 1;
+  }
+
+  return (ticks < portMAX_DELAY) ? (TickType_t)ticks : portMAX_DELAY - 1;
+}
+
+/**
+ * @brief Hand message to every registered backend
+ *
+ * @param msg Log message to dispatch
+ */
+static void prv_dispatch(const log_msg_t *msg) {
+  log_timestamp_track(msg);
+  log_backend_dispatch(msg);
+}
+
+#if LOG_DEDUP_ENABLE
+/**
+ * @brief Collapse consecutive duplicates before dispatching
+ *
+ * @param msg Log message received from the queue
+ */
+static void prv_process_dedup(log_msg_t *msg) {
+  const log_msg_t *summary = NULL;
+
+  if (log_dedup_process(msg, &summary)) {
+    // Keep timestamp expansion current for the dropped message
+    log_timestamp_track(msg);
+    log_pool_free(msg);
+    return;
+  }
+
+  if (summary) {
+    prv_dispatch(summary);
+  }
+
+  log_queue_process_immediate(msg);
+}
+#endif
+
+#if LOG_EVENT_ENABLE
+/**
+ * @brief Dispatch every event recorded so far
+ *
+ */
+static void prv_drain_events(void) {
+  const log_msg_t *event;
+
+  while ((event = log_event_next()) != NULL) {
+    prv_dispatch(event);
+  }
+}
+#endif
+
+/**
+ * @brief Emit everything held back on the log thread and flush backends
+ *
+ * @param timeout Ticks the backends may take
+ * @return 0 on success, non-zero on error
+ */
+static int prv_flush(TickType_t timeout) {
+#if LOG_EVENT_ENABLE
+  prv_drain_events();
+#endif
+
+#if LOG_DEDUP_ENABLE
+  const log_msg_t *summary = log_dedup_flush();
+
+  if (summary) {
+    prv_dispatch(summary);
+  }
+#endif
+
+  uint32_t timeout_ms =
+      (uint32_t)(((uint64_t)timeout * 1000u) / configTICK_RATE_HZ);
+
+  return log_backend_flush_all(timeout_ms);
+}
+
+/**
+ * @brief Serve flush request that reached the head of the queue
+ *
+ */
+static void prv_handle_flush_marker(void) {
+  TickType_t now = xTaskGetTickCount();
+  TickType_t remaining = (TickType_t)(prv_flush_deadline - now);
+
+  // Deadline already passed, still flush so data is not held back
+  if ((int32_t)remaining < 0) {
+    remaining = 0;
+  }
+
+  prv_flush_result = prv_flush(remaining);
+  xSemaphoreGive(prv_flush_done);
+
+  // Cleared here so a timed out request cannot overlap with the next one
+  prv_flush_pending = false;
+}
+
 /**
  * @brief Logging thread
  *
@@ -49,11 +170,71 @@ static StackType_t
  */
 static void prv_log_thread_task(void *args) {
   log_msg_t *msg;
+#if LOG_DEDUP_ENABLE
+  TickType_t last_msg = xTaskGetTickCount();
+#endif
 
   while (true) {
-    if (xQueueReceive(prv_log_queue, &msg, portMAX_DELAY) == pdTRUE) {
-      log_queue_process_immediate(msg);
+    // Read the timestamp provider while idle, so a 32-bit counter it extends
+    // never wraps twice between reads
+    TickType_t timeout = prv_refresh_ticks();
+
+#if LOG_EVENT_ENABLE
+    // Events are drained LOG_EVENT_FLUSH_MS after the first one, or once the
+    // ring is half full
+    bool events_pending = log_event_pending();
+
+    if (events_pending && pdMS_TO_TICKS(LOG_EVENT_FLUSH_MS) < timeout) {
+      timeout = pdMS_TO_TICKS(LOG_EVENT_FLUSH_MS);
+    }
+#endif
+
+#if LOG_DEDUP_ENABLE
+    // Wake up to report a pending run once the thread goes idle
+    if (log_dedup_pending() && pdMS_TO_TICKS(LOG_DEDUP_FLUSH_MS) < timeout) {
+      timeout = pdMS_TO_TICKS(LOG_DEDUP_FLUSH_MS);
+    }
+#endif
+
+    BaseType_t received = xQueueReceive(prv_log_queue, &msg, timeout);
+
+#if LOG_EVENT_ENABLE
+    // Events recorded before the message are dispatched ahead of it.  The
+    // wake up for the first event only starts the timeout.
+    if (received != pdTRUE || msg != NULL || events_pending) {
+      prv_drain_events();
     }
+#endif
+
+    if (received == pdTRUE && msg == &prv_flush_marker) {
+      prv_handle_flush_marker();
+      continue;
+    }
+
+    if (received != pdTRUE) {
+      log_timestamp_refresh();
+    }
+
+    if (received != pdTRUE || msg == NULL) {
+#if LOG_DEDUP_ENABLE
+      if (xTaskGetTickCount() - last_msg >=
+          pdMS_TO_TICKS(LOG_DEDUP_FLUSH_MS)) {
+        const log_msg_t *summary = log_dedup_flush();
+
+        if (summary) {
+          prv_dispatch(summary);
+        }
+      }
+#endif
+      continue;
+    }
+
+#if LOG_DEDUP_ENABLE
+    last_msg = xTaskGetTickCount();
+    prv_process_dedup(msg);
+#else
+    log_queue_process_immediate(msg);
+#endif
   }
 }
 
@@ -70,6 +251,11 @@ int log_queue_init(void) {
     return -EIO;
   }
 
+  prv_flush_done = xSemaphoreCreateBinaryStatic(&prv_flush_done_storage);
+  if (!prv_flush_done) {
+    return -EIO;
+  }
+
   return 0;
 }
 
@@ -95,38 +281,131 @@ int log_queue_send(log_msg_t *msg) {
     return -EIO;
   }
 
-  BaseType_t ret = pdFALSE;
-  BaseType_t higher_prio = pdFALSE;
+  BaseType_t ret = xQueueSend(prv_log_queue, &msg, 0);
 
-  if (xPortIsInsideInterrupt()) {
-    ret = xQueueSendFromISR(prv_log_queue, &msg, &higher_prio);
-  } else {
-    ret = xQueueSend(prv_log_queue, &msg, 0);
+  return (ret == pdTRUE ? 0 : -ENOSPC);
+}
+
+int log_queue_send_from_isr(log_msg_t *msg, BaseType_t *higher_prio) {
+  if (msg == NULL || higher_prio == NULL) {
+    return -EINVAL;
   }
 
-  if (xPortIsInsideInterrupt()) {
-    portYIELD_FROM_ISR(higher_prio);
+  if (prv_log_queue == NULL) {
+    return -EIO;
   }
 
+  BaseType_t ret = xQueueSendFromISR(prv_log_queue, &msg, higher_prio);
+
   return (ret == pdTRUE ? 0 : -ENOSPC);
 }
 
-void log_queue_process_immediate(log_msg_t *msg) {
-  if (!msg)
-    return;
+int log_queue_wake(void) {
+  if (prv_log_queue == NULL) {
+    return -EIO;
+  }
 
-  log_backend_t *backend = log_backend_get_head();
+  // NULL is never a valid message, the thread treats it as a wake up
+  log_msg_t *msg = NULL;
+  BaseType_t ret = xQueueSend(prv_log_queue, &msg, 0);
 
-  while (backend) {
-    if (backend->api.process_msg == NULL) {
-      backend = backend->next;
-      continue;
+  return (ret == pdTRUE ? 0 : -ENOSPC);
+}
+
+int log_queue_wake_from_isr(BaseType_t *higher_prio) {
+  if (higher_prio == NULL) {
+    return -EINVAL;
+  }
+
+  if (prv_log_queue == NULL) {
+    return -EIO;
+  }
+
+  log_msg_t *msg = NULL;
+  BaseType_t ret = xQueueSendFromISR(prv_log_queue, &msg, higher_prio);
+
+  return (ret == pdTRUE ? 0 : -ENOSPC);
+}
+
+int log_queue_flush(uint32_t timeout_ms) {
+  TickType_t timeout = pdMS_TO_TICKS(timeout_ms);
+  log_msg_t *msg = NULL;
+
+  if (prv_log_queue == NULL) {
+    return -EIO;
+  }
+
+  // Without a running log thread, or on it, the caller does the work
+  if (prv_log_task_handle == NULL ||
+      xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ||
+      xTaskGetCurrentTaskHandle() == prv_log_task_handle) {
+    while (xQueueReceive(prv_log_queue, &msg, 0) == pdTRUE) {
+      if (msg == NULL || msg == &prv_flush_marker) {
+        continue;
+      }
+
+#if LOG_DEDUP_ENABLE
+      prv_process_dedup(msg);
+#else
+      log_queue_process_immediate(msg);
+#endif
     }
 
-    backend->api.process_msg(backend, msg);
-    backend = backend->next;
+    return prv_flush(timeout);
   }
 
+  taskENTER_CRITICAL();
+  bool busy = prv_flush_pending;
+  prv_flush_pending = true;
+  taskEXIT_CRITICAL();
+
+  if (busy) {
+    return -EBUSY;
+  }
+
+  // Drop completion of an earlier request that timed out
+  xSemaphoreTake(prv_flush_done, 0);
+  prv_flush_deadline = xTaskGetTickCount() + timeout;
+
+  msg = &prv_flush_marker;
+
+  if (xQueueSend(prv_log_queue, &msg, timeout) != pdTRUE) {
+    prv_flush_pending = false;
+    return -ETIMEDOUT;
+  }
+
+  // Log thread releases the request once the marker is served
+  if (xSemaphoreTake(prv_flush_done, timeout) != pdTRUE) {
+    return -ETIMEDOUT;
+  }
+
+  return prv_flush_result;
+}
+
+void log_queue_panic(void) {
+  log_msg_t *msg = NULL;
+
+  if (prv_log_queue == NULL) {
+    return;
+  }
+
+  // Messages handed to workers are older than anything still queued
+  log_backend_panic_drain_workers();
+
+  // Nothing is freed, the system is expected to reset afterwards
+  while (xQueueReceiveFromISR(prv_log_queue, &msg, NULL) == pdTRUE) {
+    if (msg != NULL && msg != &prv_flush_marker) {
+      log_backend_panic_write(msg);
+    }
+  }
+}
+
+void log_queue_process_immediate(log_msg_t *msg) {
+  if (!msg)
+    return;
+
+  prv_dispatch(msg);
+
   // Free the message back to pool
   log_pool_free(msg);
 }
@@ -11,6 +11,8 @@
 #ifndef log_queue_h
 #define log_queue_h
 
+#include "FreeRTOS.h"
+
 #include "log_msg.h"
 
 #ifdef __cplusplus
@@ -36,13 +38,57 @@ int log_queue_init(void);
 int log_queue_start_thread(void);
 
 /**
- * @brief Send a log message to the queue (thread-safe)
+ * @brief Send a log message to the queue (task context)
  *
  * @param msg Log message to queue
  * @return 0 on success, non-zero on error
  */
 int log_queue_send(log_msg_t *msg);
 
+/**
+ * @brief Send a log message to the queue (ISR context)
+ *
+ * Does not yield, the caller yields once when done.
+ *
+ * @param msg Log message to queue
+ * @param higher_prio Set to pdTRUE if a higher priority task was woken
+ * @return 0 on success, non-zero on error
+ */
+int log_queue_send_from_isr(log_msg_t *msg, BaseType_t *higher_prio);
+
+/**
+ * @brief Wake log thread without a message (task context)
+ *
+ * @return 0 on success, non-zero on error
+ */
+int log_queue_wake(void);
+
+/**
+ * @brief Wake log thread without a message (ISR context)
+ *
+ * Does not yield, the caller yields once when done.
+ *
+ * @param higher_prio Set to pdTRUE if a higher priority task was woken
+ * @return 0 on success, non-zero on error
+ */
+int log_queue_wake_from_isr(BaseType_t *higher_prio);
+
+/**
+ * @brief Wait until every queued message is dispatched and backends flushed
+ *
+ * @param timeout_ms Maximum time to wait
+ * @return 0 on success, -ETIMEDOUT, -EBUSY if another flush is in progress,
+ *         or the first error reported by a backend
+ */
+int log_queue_flush(uint32_t timeout_ms);
+
+/**
+ * @brief Write queued messages through the backends' panic_write
+ *
+ * Intended for fault handlers, runs without the log thread.
+ */
+void log_queue_panic(void);
+
 /**
  * @brief Process a log message immediately (fallback when no threading)
  *
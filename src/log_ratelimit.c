@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_ratelimit.c
+ * @author Evan Stoddard
+ * @brief Per-callsite token bucket rate limiting implementation
+ */
+
+#include "log_ratelimit.h"
+
+#include <stddef.h>
+
+// FreeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Refill bucket for ticks elapsed since last refill
+ *
+ * Caller must hold the critical section.
+ *
+ * @param ratelimit Pointer to rate limiter
+ * @param now Current tick count
+ */
+static void prv_refill_locked(log_ratelimit_t *ratelimit, TickType_t now) {
+  TickType_t elapsed = now - ratelimit->last_refill;
+
+  uint64_t refill =
+      ((uint64_t)elapsed * ratelimit->burst) / ratelimit->interval_ticks;
+  if (refill == 0) {
+    return;
+  }
+
+  if (ratelimit->tokens + refill >= ratelimit->burst) {
+    ratelimit->tokens = ratelimit->burst;
+    ratelimit->last_refill = now;
+    return;
+  }
+
+  // Only consume the ticks that produced whole tokens
+  ratelimit->tokens += (uint16_t)refill;
+  ratelimit->last_refill +=
+      (TickType_t)((refill * ratelimit->interval_ticks) / ratelimit->burst);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+bool log_ratelimit_take(log_ratelimit_t *ratelimit, bool in_isr,
+                        uint32_t *suppressed) {
+  if (ratelimit == NULL || suppressed == NULL) {
+    return true;
+  }
+
+  // A zero interval disables limiting
+  if (ratelimit->interval_ticks == 0) {
+    *suppressed = 0;
+    return true;
+  }
+
+  UBaseType_t saved_isr_state = 0;
+  TickType_t now;
+
+  if (in_isr) {
+    saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+    now = xTaskGetTickCountFromISR();
+  } else {
+    taskENTER_CRITICAL();
+    now = xTaskGetTickCount();
+  }
+
+  prv_refill_locked(ratelimit, now);
+
+  bool pass = ratelimit->tokens > 0;
+
+  if (pass) {
+    ratelimit->tokens--;
+    *suppressed = ratelimit->suppressed;
+    ratelimit->suppressed = 0;
+  } else if (ratelimit->suppressed < UINT32_MAX) {
+    ratelimit->suppressed++;
+  }
+
+  if (in_isr) {
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskEXIT_CRITICAL();
+  }
+
+  return pass;
+}
+
+void log_ratelimit_add_suppressed(log_ratelimit_t *ratelimit, bool in_isr,
+                                  uint32_t count) {
+  if (ratelimit == NULL) {
+    return;
+  }
+
+  UBaseType_t saved_isr_state = 0;
+
+  if (in_isr) {
+    saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+  } else {
+    taskENTER_CRITICAL();
+  }
+
+  uint32_t space = UINT32_MAX - ratelimit->suppressed;
+  ratelimit->suppressed += (count > space) ? space : count;
+
+  if (in_isr) {
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskEXIT_CRITICAL();
+  }
+}
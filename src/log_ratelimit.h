@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_ratelimit.h
+ * @author Evan Stoddard
+ * @brief Per-callsite token bucket rate limiting
+ */
+
+#ifndef log_ratelimit_h
+#define log_ratelimit_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Convert interval to ticks, rounding up
+ *
+ * Intervals shorter than a tick still limit, only 0 disables limiting.
+ *
+ * @param interval_ms Interval in milliseconds
+ */
+#define LOG_RATELIMIT_MS_TO_TICKS(interval_ms)                                 \
+  ((TickType_t)(((uint64_t)(interval_ms) * configTICK_RATE_HZ + 999u) /       \
+                1000u))
+
+/**
+ * @brief Static initializer for a rate limiter
+ *
+ * @param interval_ms Interval in which at most `burst_count` messages pass
+ * @param burst_count Bucket capacity, also the refill per interval
+ */
+#define LOG_RATELIMIT_INIT(interval_ms, burst_count)                           \
+  {                                                                            \
+      .interval_ticks = LOG_RATELIMIT_MS_TO_TICKS(interval_ms),                \
+      .burst = (burst_count),                                                  \
+      .tokens = (burst_count),                                                 \
+      .last_refill = 0,                                                        \
+      .suppressed = 0,                                                         \
+  }
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_ratelimit_t
+ * @brief Token bucket of a single rate limited callsite
+ *
+ * The bucket starts full and refills `burst` tokens per `interval_ticks`.
+ * Events arriving with an empty bucket are counted in `suppressed` and the
+ * count is handed to the next event that passes.
+ */
+typedef struct log_ratelimit_t {
+  TickType_t interval_ticks;
+  uint16_t burst;
+  uint16_t tokens;
+  TickType_t last_refill;
+  uint32_t suppressed;
+} log_ratelimit_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Take a token from the bucket
+ *
+ * @param ratelimit Pointer to rate limiter
+ * @param in_isr True if called from ISR
+ * @param suppressed Set to the number of events suppressed since the last
+ *                   event that passed, only written when returning true
+ * @return true if the event may be logged
+ */
+bool log_ratelimit_take(log_ratelimit_t *ratelimit, bool in_isr,
+                        uint32_t *suppressed);
+
+/**
+ * @brief Return suppressed events to the bucket after a failed emit
+ *
+ * Used when an event passed the limiter but could not be queued, so its
+ * suppression count is reported on the next emitted message instead.
+ *
+ * @param ratelimit Pointer to rate limiter
+ * @param in_isr True if called from ISR
+ * @param count Number of events to add to the suppression count
+ */
+void log_ratelimit_add_suppressed(log_ratelimit_t *ratelimit, bool in_isr,
+                                  uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_ratelimit_h */
@@ -0,0 +1,787 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_render.c
+ * @author Evan Stoddard
+ * @brief Rendering of deferred log messages into text implementation
+ */
+
+#include "log_render.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "log_callsite.h"
+#include "log_context.h"
+#include "log_core.h"
+#include "log_event.h"
+#include "log_format.h"
+#include "log_kv.h"
+#include "log_module.h"
+#include "log_timestamp.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Longest single conversion specifier that is rendered */
+#define LOG_RENDER_MAX_SPEC_LEN 24
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_render_out_t
+ * @brief Bounded output cursor
+ *
+ */
+typedef struct log_render_out_t {
+  char *buf;
+  size_t size;
+  size_t len;
+
+  // Slices of the rendered text, NULL when rendering into buf only
+  log_iov_t *iov;
+  int iov_max;
+  int iov_cnt;
+} log_render_out_t;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Add slice for text just written to the buffer
+ *
+ * @param out Output cursor
+ * @param start Offset of the text in the buffer
+ */
+static void prv_emit_buf(log_render_out_t *out, size_t start) {
+  if (out->iov == NULL || out->len == start) {
+    return;
+  }
+
+  log_iov_t *last = out->iov_cnt > 0 ? &out->iov[out->iov_cnt - 1] : NULL;
+
+  // Consecutive buffer text stays in one slice
+  if (last && (const char *)last->base + last->len == out->buf + start) {
+    last->len += out->len - start;
+  } else if (out->iov_cnt < out->iov_max) {
+    out->iov[out->iov_cnt].base = out->buf + start;
+    out->iov[out->iov_cnt].len = out->len - start;
+    out->iov_cnt++;
+  }
+}
+
+/**
+ * @brief Append string to output, truncating if full
+ *
+ * @param out Output cursor
+ * @param str String to append
+ * @param len Length of string
+ */
+static void prv_append(log_render_out_t *out, const char *str, size_t len) {
+  if (out->len + 1 >= out->size) {
+    return;
+  }
+
+  size_t space = out->size - out->len - 1;
+  if (len > space) {
+    len = space;
+  }
+
+  size_t start = out->len;
+
+  memcpy(out->buf + out->len, str, len);
+  out->len += len;
+  out->buf[out->len] = '\0';
+
+  prv_emit_buf(out, start);
+}
+
+/**
+ * @brief Append string that outlives the render call
+ *
+ * Slice output references the string instead of copying it.  The last slot
+ * is kept for buffer text, after that strings are copied.
+ *
+ * @param out Output cursor
+ * @param str String to append
+ * @param len Length of string
+ */
+static void prv_append_ref(log_render_out_t *out, const char *str,
+                           size_t len) {
+  if (out->iov == NULL || out->iov_cnt >= out->iov_max - 1) {
+    prv_append(out, str, len);
+    return;
+  }
+
+  if (len > 0) {
+    out->iov[out->iov_cnt].base = str;
+    out->iov[out->iov_cnt].len = len;
+    out->iov_cnt++;
+  }
+}
+
+/**
+ * @brief Append null terminated string that outlives the render call
+ *
+ * @param out Output cursor
+ * @param str String to append
+ */
+static void prv_append_str(log_render_out_t *out, const char *str) {
+  if (str) {
+    prv_append_ref(out, str, strlen(str));
+  }
+}
+
+/**
+ * @brief Account for characters written by snprintf into output
+ *
+ * @param out Output cursor
+ * @param ret Return value of snprintf
+ */
+static void prv_commit(log_render_out_t *out, int ret) {
+  if (ret <= 0) {
+    return;
+  }
+
+  size_t start = out->len;
+  size_t space = out->size - out->len - 1;
+  out->len += ((size_t)ret > space) ? space : (size_t)ret;
+
+  prv_emit_buf(out, start);
+}
+
+/**
+ * @brief Render task name, or ISR number for interrupt context
+ *
+ * @param out Output cursor
+ * @param context Packed context from the message header
+ */
+static void prv_render_context(log_render_out_t *out, uint16_t context) {
+  if (!LOG_CONTEXT_IS_ISR(context)) {
+    prv_append_str(out, log_context_task_name(context));
+    return;
+  }
+
+  if (out->len + 1 < out->size) {
+    prv_commit(out, snprintf(out->buf + out->len, out->size - out->len,
+                             "isr%u", (unsigned)LOG_CONTEXT_GET_ID(context)));
+  }
+}
+
+/**
+ * @brief Render one conversion specifier with its buffered argument
+ *
+ * @param out Output cursor
+ * @param spec Conversion specifier
+ * @param arg Pointer to argument in args buffer
+ * @param stale True if string arguments must not be followed
+ */
+static void prv_render_spec(log_render_out_t *out,
+                            const log_format_spec_t *spec, const uint8_t *arg,
+                            bool stale) {
+  char spec_str[LOG_RENDER_MAX_SPEC_LEN];
+
+  if (spec->length >= sizeof(spec_str)) {
+    prv_append(out, spec->start, spec->length);
+    return;
+  }
+
+  memcpy(spec_str, spec->start, spec->length);
+  spec_str[spec->length] = '\0';
+
+  if (out->len + 1 >= out->size) {
+    return;
+  }
+
+  char *dst = out->buf + out->len;
+  size_t space = out->size - out->len;
+  int ret = 0;
+
+  switch (spec->type) {
+  case LOG_FORMAT_ARG_INT: {
+    int value;
+    memcpy(&value, arg, sizeof(value));
+    ret = snprintf(dst, space, spec_str, value);
+    break;
+  }
+  case LOG_FORMAT_ARG_LONG: {
+    long value;
+    memcpy(&value, arg, sizeof(value));
+    ret = snprintf(dst, space, spec_str, value);
+    break;
+  }
+  case LOG_FORMAT_ARG_LONG_LONG: {
+    long long value;
+    memcpy(&value, arg, sizeof(value));
+    ret = snprintf(dst, space, spec_str, value);
+    break;
+  }
+  case LOG_FORMAT_ARG_SIZE: {
+    size_t value;
+    memcpy(&value, arg, sizeof(value));
+    ret = snprintf(dst, space, spec_str, value);
+    break;
+  }
+  case LOG_FORMAT_ARG_PTRDIFF: {
+    ptrdiff_t value;
+    memcpy(&value, arg, sizeof(value));
+    ret = snprintf(dst, space, spec_str, value);
+    break;
+  }
+  case LOG_FORMAT_ARG_INTMAX: {
+    intmax_t value;
+    memcpy(&value, arg, sizeof(value));
+    ret = snprintf(dst, space, spec_str, value);
+    break;
+  }
+  case LOG_FORMAT_ARG_DOUBLE: {
+    double value;
+    memcpy(&value, arg, sizeof(value));
+    ret = snprintf(dst, space, spec_str, value);
+    break;
+  }
+  case LOG_FORMAT_ARG_STRING: {
+    const char *value;
+    memcpy(&value, arg, sizeof(value));
+    ret = stale ? snprintf(dst, space, "<str@0x%llx>",
+                           (unsigned long long)(uintptr_t)value)
+                : snprintf(dst, space, spec_str, value ? value : "(null)");
+    break;
+  }
+  case LOG_FORMAT_ARG_POINTER: {
+    void *value;
+    memcpy(&value, arg, sizeof(value));
+    ret = snprintf(dst, space, spec_str, value);
+    break;
+  }
+  default:
+    // '%n' is never written through on the log thread
+    break;
+  }
+
+  prv_commit(out, ret);
+}
+
+/**
+ * @brief Render format string with buffered arguments
+ *
+ * @param out Output cursor
+ * @param fmt_str Format string
+ * @param args Pointer to args buffer
+ * @param args_size Size of args buffer
+ * @param stale True if string arguments must not be followed
+ */
+static void prv_render_fmt(log_render_out_t *out, const char *fmt_str,
+                           const uint8_t *args, size_t args_size, bool stale) {
+  log_format_spec_t spec;
+  const char *p = fmt_str;
+  size_t offset = 0;
+
+  while (*p) {
+    const char *spec_start = log_format_next_spec(p, &spec);
+
+    if (spec_start == NULL) {
+      prv_append_str(out, p);
+      return;
+    }
+
+    // Literal text preceding the specifier
+    prv_append_ref(out, p, (size_t)(spec_start - p));
+    p = spec_start + spec.length;
+
+    if (spec.type == LOG_FORMAT_ARG_NONE) {
+      prv_append(out, "%", 1);
+      continue;
+    }
+
+    if (spec.type == LOG_FORMAT_ARG_INVALID) {
+      prv_append_ref(out, spec.start, spec.length);
+      continue;
+    }
+
+    size_t arg_size = log_format_arg_size(spec.type);
+    if (offset + arg_size > args_size) {
+      return;
+    }
+
+    prv_render_spec(out, &spec, args + offset, stale);
+    offset += arg_size;
+  }
+}
+
+/**
+ * @brief Append string, escaping quotes and backslashes
+ *
+ * @param out Output cursor
+ * @param str String to append
+ */
+static void prv_append_escaped(log_render_out_t *out, const char *str) {
+  for (const char *p = str; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      prv_append(out, "\\", 1);
+    }
+
+    prv_append(out, p, 1);
+  }
+}
+
+/**
+ * @brief Render a single key/value field value
+ *
+ * @param out Output cursor
+ * @param type Type tag of field
+ * @param value Value of field
+ * @param style Output style, decides string quoting
+ * @param stale True if string values must not be followed
+ */
+static void prv_render_kv_value(log_render_out_t *out, log_kv_type_t type,
+                                const log_kv_value_t *value,
+                                log_render_kv_style_t style, bool stale) {
+  if (type == LOG_KV_TYPE_BOOL) {
+    prv_append_str(out, value->b ? "true" : "false");
+    return;
+  }
+
+  if (type == LOG_KV_TYPE_STR) {
+    const char *str = value->str ? value->str : "(null)";
+
+    // The address text lives on this stack frame, so it is copied
+    if (stale) {
+      char addr[32];
+      bool json = style == LOG_RENDER_KV_JSON;
+
+      snprintf(addr, sizeof(addr), "<str@0x%llx>",
+               (unsigned long long)(uintptr_t)value->str);
+
+      if (json) {
+        prv_append(out, "\"", 1);
+      }
+      prv_append(out, addr, strlen(addr));
+      if (json) {
+        prv_append(out, "\"", 1);
+      }
+      return;
+    }
+
+    bool quote = style == LOG_RENDER_KV_JSON || strpbrk(str, " =\"") != NULL;
+
+    if (quote) {
+      prv_append(out, "\"", 1);
+      prv_append_escaped(out, str);
+      prv_append(out, "\"", 1);
+    } else {
+      prv_append_str(out, str);
+    }
+    return;
+  }
+
+  if (out->len + 1 >= out->size) {
+    return;
+  }
+
+  char *dst = out->buf + out->len;
+  size_t space = out->size - out->len;
+  int ret = 0;
+
+  switch (type) {
+  case LOG_KV_TYPE_I32:
+    ret = snprintf(dst, space, "%ld", (long)value->i32);
+    break;
+  case LOG_KV_TYPE_U32:
+    ret = snprintf(dst, space, "%lu", (unsigned long)value->u32);
+    break;
+  case LOG_KV_TYPE_I64:
+    ret = snprintf(dst, space, "%lld", (long long)value->i64);
+    break;
+  case LOG_KV_TYPE_U64:
+    ret = snprintf(dst, space, "%llu", (unsigned long long)value->u64);
+    break;
+  case LOG_KV_TYPE_F32:
+    ret = snprintf(dst, space, "%g", (double)value->f32);
+    break;
+  case LOG_KV_TYPE_F64:
+    ret = snprintf(dst, space, "%g", value->f64);
+    break;
+  default:
+    break;
+  }
+
+  prv_commit(out, ret);
+}
+
+/**
+ * @brief Render key/value message as logfmt or JSON
+ *
+ * @param out Output cursor
+ * @param callsite Callsite holding event name and key table
+ * @param msg Pointer to message
+ * @param style Output style
+ */
+static void prv_render_kv(log_render_out_t *out,
+                          const log_callsite_t *callsite, const log_msg_t *msg,
+                          log_render_kv_style_t style) {
+  bool json = style == LOG_RENDER_KV_JSON;
+  size_t offset = 0;
+  log_kv_type_t type;
+  log_kv_value_t value;
+
+  if (json) {
+    prv_append_str(out, "{\"event\":\"");
+    prv_append_escaped(out, callsite->fmt_str);
+    prv_append(out, "\"", 1);
+  } else {
+    prv_append_str(out, callsite->fmt_str);
+  }
+
+  for (uint8_t i = 0; i < callsite->kv_count; i++) {
+    if (!log_kv_next(msg->args_buffer, msg->args_buffer_size, &offset, &type,
+                     &value)) {
+      break;
+    }
+
+    const char *key = callsite->kv_keys ? callsite->kv_keys[i].key : "";
+
+    if (json) {
+      prv_append_str(out, ",\"");
+      prv_append_escaped(out, key);
+      prv_append_str(out, "\":");
+    } else {
+      prv_append(out, " ", 1);
+      prv_append_str(out, key);
+      prv_append(out, "=", 1);
+    }
+
+    prv_render_kv_value(out, type, &value, style,
+                        LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_STALE_STRINGS));
+  }
+
+  if (json) {
+    prv_append(out, "}", 1);
+  }
+}
+
+/**
+ * @brief Render message body into output cursor
+ *
+ * @param out Output cursor
+ * @param msg Pointer to message
+ */
+static void prv_render_body(log_render_out_t *out, const log_msg_t *msg) {
+  if (msg->callsite_id == LOG_CALLSITE_ID_SYNC) {
+    log_timestamp_sync_t sync;
+
+    if (msg->args_buffer_size < sizeof(sync) || out->len + 1 >= out->size) {
+      return;
+    }
+
+    memcpy(&sync, msg->args_buffer, sizeof(sync));
+    prv_commit(out, snprintf(out->buf + out->len, out->size - out->len,
+                             "time sync ts=%llu freq=%lu wallclock_us=%llu",
+                             (unsigned long long)sync.timestamp,
+                             (unsigned long)sync.freq_hz,
+                             (unsigned long long)sync.wallclock_us));
+    return;
+  }
+
+  if (msg->callsite_id == LOG_CALLSITE_ID_REPEAT) {
+    uint32_t repeats;
+
+    if (msg->args_buffer_size < sizeof(repeats) || out->len + 1 >= out->size) {
+      return;
+    }
+
+    memcpy(&repeats, msg->args_buffer, sizeof(repeats));
+    prv_commit(out, snprintf(out->buf + out->len, out->size - out->len,
+                             "last message repeated %lu times",
+                             (unsigned long)repeats));
+    return;
+  }
+
+  if (msg->callsite_id == LOG_CALLSITE_ID_EVENT) {
+    log_event_payload_t event;
+
+    if (msg->args_buffer_size < sizeof(event) || out->len + 1 >= out->size) {
+      return;
+    }
+
+    memcpy(&event, msg->args_buffer, sizeof(event));
+
+    if (event.id == LOG_EVENT_ID_DROPPED) {
+      prv_commit(out, snprintf(out->buf + out->len, out->size - out->len,
+                               "%lu events dropped",
+                               (unsigned long)event.value));
+    } else {
+      prv_commit(out, snprintf(out->buf + out->len, out->size - out->len,
+                               "event 0x%04x value=%lu", (unsigned)event.id,
+                               (unsigned long)event.value));
+    }
+    return;
+  }
+
+  const log_callsite_t *callsite = log_callsite_get(msg->callsite_id);
+
+  if (callsite == NULL || callsite->fmt_str == NULL) {
+    return;
+  }
+
+  if (LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_KV)) {
+    prv_render_kv(out, callsite, msg, LOG_RENDER_KV_LOGFMT);
+    return;
+  }
+
+  if (LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_SPAN_BEGIN | LOG_MSG_FLAG_SPAN_END)) {
+    prv_append_str(out, LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_SPAN_END)
+                            ? "end "
+                            : "begin ");
+    prv_append_str(out, callsite->fmt_str);
+    prv_append_str(out, " task=");
+    prv_render_context(out, msg->context);
+    return;
+  }
+
+  size_t args_size = msg->args_buffer_size;
+  uint32_t suppressed = 0;
+
+  if (LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_SUPPRESSED) &&
+      args_size >= sizeof(suppressed)) {
+    args_size -= sizeof(suppressed);
+    memcpy(&suppressed, msg->args_buffer + args_size, sizeof(suppressed));
+  }
+
+  prv_render_fmt(out, callsite->fmt_str, msg->args_buffer, args_size,
+                 LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_STALE_STRINGS));
+
+  if (suppressed > 0 && out->len + 1 < out->size) {
+    prv_commit(out, snprintf(out->buf + out->len, out->size - out->len,
+                             " (suppressed %lu)", (unsigned long)suppressed));
+  }
+}
+
+/**
+ * @brief Render message according to layout template into output cursor
+ *
+ * @param out Output cursor
+ * @param msg Pointer to message
+ * @param layout Layout template, NULL for LOG_RENDER_DEFAULT_LAYOUT
+ */
+static void prv_render_layout(log_render_out_t *out, const log_msg_t *msg,
+                              const char *layout) {
+  if (layout == NULL) {
+    layout = LOG_RENDER_DEFAULT_LAYOUT;
+  }
+
+  uint8_t level = LOG_MSG_GET_LEVEL(msg);
+  const char *p = layout;
+
+  while (*p) {
+    const char *token = strchr(p, '%');
+
+    if (token == NULL) {
+      prv_append_str(out, p);
+      break;
+    }
+
+    prv_append_ref(out, p, (size_t)(token - p));
+    p = token + 1;
+
+    switch (*p) {
+    case 'C':
+      prv_append_str(out, log_render_level_color(level));
+      break;
+    case 'R':
+      prv_append_str(out, LOG_RESET_COLOR);
+      break;
+    case 'T': {
+      unsigned long long timestamp = log_timestamp_expand(msg->timestamp);
+
+      if (out->len + 1 < out->size) {
+        prv_commit(out, snprintf(out->buf + out->len, out->size - out->len,
+                                 "%llu", timestamp));
+      }
+      break;
+    }
+    case 'W': {
+      uint64_t wallclock_us = 0;
+
+      if (!log_timestamp_to_wallclock(log_timestamp_expand(msg->timestamp),
+                                      &wallclock_us)) {
+        break;
+      }
+
+      unsigned long long seconds = wallclock_us / 1000000;
+      unsigned long long micros = wallclock_us % 1000000;
+
+      if (out->len + 1 < out->size) {
+        prv_commit(out, snprintf(out->buf + out->len, out->size - out->len,
+                                 "%llu.%06llu", seconds, micros));
+      }
+      break;
+    }
+    case 'L':
+      prv_append_str(out, log_render_level_str(level));
+      break;
+    case 'M': {
+      const log_module_t *module = log_module_get(msg->module_id);
+      prv_append_str(out, module ? module->name : NULL);
+      break;
+    }
+    case 'F': {
+      const log_callsite_t *callsite = log_callsite_get(msg->callsite_id);
+      prv_append_str(out, callsite ? callsite->function_name : NULL);
+      break;
+    }
+    case 't':
+      prv_render_context(out, msg->context);
+      break;
+    case 'c': {
+      unsigned core = LOG_CONTEXT_GET_CORE(msg->context);
+
+      if (out->len + 1 < out->size) {
+        prv_commit(out, snprintf(out->buf + out->len, out->size - out->len,
+                                 "%u", core));
+      }
+      break;
+    }
+    case 'm':
+      prv_render_body(out, msg);
+      break;
+    case '%':
+      prv_append(out, "%", 1);
+      break;
+    case '\0':
+      continue;
+    default:
+      prv_append_ref(out, token, 2);
+      break;
+    }
+
+    p++;
+  }
+}
+
+/*****************************************************************************
+ * Public Functions
+ *****************************************************************************/
+
+const char *log_render_level_str(uint8_t level) {
+  switch (level) {
+  case LOG_LEVEL_ERROR:
+    return LOG_LEVEL_ERROR_STR;
+  case LOG_LEVEL_WARNING:
+    return LOG_LEVEL_WARNING_STR;
+  case LOG_LEVEL_INFO:
+    return LOG_LEVEL_INFO_STR;
+  case LOG_LEVEL_DEBUG:
+    return LOG_LEVEL_DEBUG_STR;
+  default:
+    return LOG_LEVEL_EMPTY_STR;
+  }
+}
+
+const char *log_render_level_color(uint8_t level) {
+  switch (level) {
+  case LOG_LEVEL_ERROR:
+    return LOG_LEVEL_ERROR_COLOR;
+  case LOG_LEVEL_WARNING:
+    return LOG_LEVEL_WARNING_COLOR;
+  case LOG_LEVEL_INFO:
+    return LOG_LEVEL_INFO_COLOR;
+  case LOG_LEVEL_DEBUG:
+    return LOG_LEVEL_DEBUG_COLOR;
+  default:
+    return LOG_LEVEL_EMPTY_STR;
+  }
+}
+
+size_t log_render_body(const log_msg_t *msg, char *out_buf,
+                       size_t out_buf_size_bytes) {
+  if (msg == NULL || out_buf == NULL || out_buf_size_bytes == 0) {
+    return 0;
+  }
+
+  log_render_out_t out = {
+      .buf = out_buf,
+      .size = out_buf_size_bytes,
+      .len = 0,
+  };
+
+  out_buf[0] = '\0';
+  prv_render_body(&out, msg);
+
+  return out.len;
+}
+
+size_t log_render_kv(const log_msg_t *msg, log_render_kv_style_t style,
+                     char *out_buf, size_t out_buf_size_bytes) {
+  if (msg == NULL || out_buf == NULL || out_buf_size_bytes == 0) {
+    return 0;
+  }
+
+  out_buf[0] = '\0';
+
+  const log_callsite_t *callsite = log_callsite_get(msg->callsite_id);
+
+  if (!LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_KV) || callsite == NULL ||
+      callsite->fmt_str == NULL) {
+    return 0;
+  }
+
+  log_render_out_t out = {
+      .buf = out_buf,
+      .size = out_buf_size_bytes,
+      .len = 0,
+  };
+
+  prv_render_kv(&out, callsite, msg, style);
+
+  return out.len;
+}
+
+size_t log_render_msg(const log_msg_t *msg, const char *layout, char *out_buf,
+                      size_t out_buf_size_bytes) {
+  if (msg == NULL || out_buf == NULL || out_buf_size_bytes == 0) {
+    return 0;
+  }
+
+  log_render_out_t out = {
+      .buf = out_buf,
+      .size = out_buf_size_bytes,
+      .len = 0,
+  };
+
+  out_buf[0] = '\0';
+  prv_render_layout(&out, msg, layout);
+
+  return out.len;
+}
+
+int log_render_msg_iov(const log_msg_t *msg, const char *layout,
+                       log_iov_t *iov, int iov_max, char *scratch,
+                       size_t scratch_size_bytes) {
+  if (msg == NULL || iov == NULL || iov_max < 2 || scratch == NULL ||
+      scratch_size_bytes == 0) {
+    return 0;
+  }
+
+  log_render_out_t out = {
+      .buf = scratch,
+      .size = scratch_size_bytes,
+      .len = 0,
+      .iov = iov,
+      .iov_max = iov_max,
+      .iov_cnt = 0,
+  };
+
+  scratch[0] = '\0';
+  prv_render_layout(&out, msg, layout);
+
+  return out.iov_cnt;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_render.h
+ * @author Evan Stoddard
+ * @brief Rendering of deferred log messages into text
+ */
+
+#ifndef log_render_h
+#define log_render_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "log_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/**
+ * @brief Layout used when a backend does not provide one
+ *
+ * Layout tokens:
+ *   %C level color, %R reset color, %T timestamp, %W wallclock seconds
+ *   (empty until log_time_sync is called), %L level string, %M module name,
+ *   %F function name, %t task name (`isrN` in interrupts), %c core ID,
+ *   %m message body, %% literal '%'
+ */
+#define LOG_RENDER_DEFAULT_LAYOUT "%C[%T] <%L> %M::%F: %m%R\r\n"
+
+/** @brief Layout without ANSI colors */
+#define LOG_RENDER_PLAIN_LAYOUT "[%T] <%L> %M::%F: %m\r\n"
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_iov_t
+ * @brief Slice of rendered text, layout compatible with POSIX struct iovec
+ *
+ */
+typedef struct log_iov_t {
+  const void *base;
+  size_t len;
+} log_iov_t;
+
+/**
+ * @typedef log_render_kv_style_t
+ * @brief Text representation of structured key/value messages
+ *
+ */
+typedef enum log_render_kv_style_t {
+  LOG_RENDER_KV_LOGFMT = 0, // `event key=value ...`, used for `%m`
+  LOG_RENDER_KV_JSON,       // `{"event":"...","key":value,...}`
+} log_render_kv_style_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Render message prefix and body according to layout template
+ *
+ * @param msg Pointer to message
+ * @param layout Layout template, NULL for LOG_RENDER_DEFAULT_LAYOUT
+ * @param out_buf Pointer to output buffer
+ * @param out_buf_size_bytes Size of output buffer
+ * @return Number of characters written, excluding null terminator
+ */
+size_t log_render_msg(const log_msg_t *msg, const char *layout, char *out_buf,
+                      size_t out_buf_size_bytes);
+
+/**
+ * @brief Render message as slices instead of one contiguous string
+ *
+ * Layout text, format literals, level, module and function names are
+ * referenced where they live.  Only converted arguments and other generated
+ * text are written to `scratch`.  Slices stay valid until the message,
+ * layout or scratch buffer change.
+ *
+ * @param msg Pointer to message
+ * @param layout Layout template, NULL for LOG_RENDER_DEFAULT_LAYOUT
+ * @param iov Slice array to fill
+ * @param iov_max Number of entries in iov (at least 2)
+ * @param scratch Buffer for generated text
+ * @param scratch_size_bytes Size of scratch buffer
+ * @return Number of slices written
+ */
+int log_render_msg_iov(const log_msg_t *msg, const char *layout,
+                       log_iov_t *iov, int iov_max, char *scratch,
+                       size_t scratch_size_bytes);
+
+/**
+ * @brief Render only the message body (format string and arguments)
+ *
+ * @param msg Pointer to message
+ * @param out_buf Pointer to output buffer
+ * @param out_buf_size_bytes Size of output buffer
+ * @return Number of characters written, excluding null terminator
+ */
+size_t log_render_body(const log_msg_t *msg, char *out_buf,
+                       size_t out_buf_size_bytes);
+
+/**
+ * @brief Render structured key/value message in the given style
+ *
+ * @param msg Pointer to message with LOG_MSG_FLAG_KV set
+ * @param style Output style
+ * @param out_buf Pointer to output buffer
+ * @param out_buf_size_bytes Size of output buffer
+ * @return Number of characters written, 0 if message is not key/value
+ */
+size_t log_render_kv(const log_msg_t *msg, log_render_kv_style_t style,
+                     char *out_buf, size_t out_buf_size_bytes);
+
+/**
+ * @brief Get level string of log level
+ *
+ * @param level Log level
+ * @return Level string, empty string if unknown
+ */
+const char *log_render_level_str(uint8_t level);
+
+/**
+ * @brief Get ANSI color sequence of log level
+ *
+ * @param level Log level
+ * @return Color sequence, empty string if unknown
+ */
+const char *log_render_level_color(uint8_t level);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_render_h */
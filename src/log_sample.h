@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_sample.h
+ * @author Evan Stoddard
+ * @brief Per-callsite log-once, every-N and probabilistic sampling
+ */
+
+#ifndef log_sample_h
+#define log_sample_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Static initializer for a sampling counter */
+#define LOG_SAMPLE_INIT                                                        \
+  { .count = 0 }
+
+/**
+ * @brief Convert sampling probability to a 32-bit threshold
+ *
+ * Folded at compile time for constant probabilities.  Values at or below 0
+ * never pass, values at or above 1 always pass.
+ *
+ * @param prob Probability in the range [0, 1]
+ */
+#define LOG_SAMPLE_THRESHOLD(prob)                                             \
+  ((prob) <= 0.0   ? 0u                                                        \
+   : (prob) >= 1.0 ? UINT32_MAX                                                \
+                   : (uint32_t)((prob) * 4294967296.0))
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_sample_t
+ * @brief Per-callsite event counter
+ *
+ * Only ever updated with atomic read-modify-write operations so it is safe
+ * to share between tasks and ISRs without a critical section.
+ */
+typedef struct log_sample_t {
+  uint32_t count;
+} log_sample_t;
+
+/*****************************************************************************
+ * Inline Function
+ *****************************************************************************/
+
+/**
+ * @brief Check whether this is the first event of the callsite
+ *
+ * @param sample Pointer to sampling counter
+ * @return true exactly once
+ */
+static inline bool log_sample_once(log_sample_t *sample) {
+  // Plain load first so later calls avoid the atomic write
+  if (__atomic_load_n(&sample->count, __ATOMIC_RELAXED) != 0) {
+    return false;
+  }
+
+  return __atomic_exchange_n(&sample->count, 1, __ATOMIC_RELAXED) == 0;
+}
+
+/**
+ * @brief Check whether event is the first of each group of n
+ *
+ * @param sample Pointer to sampling counter
+ * @param n Group size, 0 or 1 lets every event pass
+ * @return true for events 0, n, 2n, ...
+ */
+static inline bool log_sample_every_n(log_sample_t *sample, uint32_t n) {
+  uint32_t count = __atomic_fetch_add(&sample->count, 1, __ATOMIC_RELAXED);
+
+  return n <= 1 || (count % n) == 0;
+}
+
+/**
+ * @brief Pseudo-randomly pass events with a fixed probability
+ *
+ * The event index is scrambled with a 32-bit integer hash so no random
+ * number generator state is shared between callsites or contexts.
+ *
+ * @param sample Pointer to sampling counter
+ * @param threshold Probability as returned by LOG_SAMPLE_THRESHOLD
+ * @return true if event was sampled
+ */
+static inline bool log_sample_probability(log_sample_t *sample,
+                                          uint32_t threshold) {
+  if (threshold == 0) {
+    return false;
+  }
+
+  if (threshold == UINT32_MAX) {
+    return true;
+  }
+
+  uint32_t x = __atomic_fetch_add(&sample->count, 1, __ATOMIC_RELAXED);
+
+  // Murmur3 finalizer, offset by the address so callsites are uncorrelated
+  x ^= (uint32_t)(uintptr_t)sample;
+  x ^= x >> 16;
+  x *= 0x85EBCA6Bu;
+  x ^= x >> 13;
+  x *= 0xC2B2AE35u;
+  x ^= x >> 16;
+
+  return x < threshold;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_sample_h */
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_timestamp.c
+ * @author Evan Stoddard
+ * @brief Pluggable high-resolution timestamp source implementation
+ */
+
+#include "log_timestamp.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+// FreeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "log_callsite.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Microseconds per second */
+#define LOG_TIMESTAMP_US_PER_S 1000000ull
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance
+ */
+static struct {
+  // Producer side
+  log_timestamp_provider_t provider;
+  uint32_t freq_hz;
+  log_timestamp_ext_t tick_ext;
+  uint32_t epoch;
+
+  // Written by the log thread, read by any renderer (lock)
+  uint64_t last;
+  bool has_last;
+  uint64_t sync_timestamp;
+  uint64_t sync_wallclock_us;
+  uint32_t sync_freq_hz;
+  bool has_wallclock;
+} prv_inst;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Default provider, RTOS tick count extended to 64 bits (task)
+ *
+ * @return Tick count
+ */
+static uint64_t prv_tick_provider(void) {
+  taskENTER_CRITICAL();
+  uint64_t ticks =
+      log_timestamp_extend(&prv_inst.tick_ext, (uint32_t)xTaskGetTickCount());
+  taskEXIT_CRITICAL();
+
+  return ticks;
+}
+
+/**
+ * @brief Default provider, RTOS tick count extended to 64 bits (ISR)
+ *
+ * @return Tick count
+ */
+static uint64_t prv_tick_provider_from_isr(void) {
+  UBaseType_t saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+  uint64_t ticks = log_timestamp_extend(&prv_inst.tick_ext,
+                                        (uint32_t)xTaskGetTickCountFromISR());
+  taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+
+  return ticks;
+}
+
+/**
+ * @brief Enter critical section from task or ISR context
+ *
+ * @param in_isr True if called from ISR
+ * @return Saved interrupt state for ISR context
+ */
+static UBaseType_t prv_enter_critical(bool in_isr) {
+  if (in_isr) {
+    return taskENTER_CRITICAL_FROM_ISR();
+  }
+
+  taskENTER_CRITICAL();
+  return 0;
+}
+
+/**
+ * @brief Exit critical section from task or ISR context
+ *
+ * @param in_isr True if called from ISR
+ * @param saved_isr_state State returned by prv_enter_critical
+ */
+static void prv_exit_critical(bool in_isr, UBaseType_t saved_isr_state) {
+  if (in_isr) {
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskEXIT_CRITICAL();
+  }
+}
+
+/**
+ * @brief Expand timestamp relative to a known 64-bit reference
+ *
+ * @param last 64-bit reference timestamp
+ * @param timestamp Lower 32 bits from message header
+ * @return 64-bit timestamp closest to the reference
+ */
+static uint64_t prv_expand(uint64_t last, uint32_t timestamp) {
+  // Pick the epoch that puts the timestamp closest to the reference
+  int32_t delta = (int32_t)(timestamp - (uint32_t)last);
+
+  return last + (uint64_t)(int64_t)delta;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_timestamp_set_provider(log_timestamp_provider_t provider,
+                               uint32_t freq_hz) {
+  if (provider != NULL && freq_hz == 0) {
+    return -EINVAL;
+  }
+
+  taskENTER_CRITICAL();
+  prv_inst.provider = provider;
+  prv_inst.freq_hz = provider ? freq_hz : configTICK_RATE_HZ;
+  taskEXIT_CRITICAL();
+
+  return 0;
+}
+
+uint64_t log_timestamp_get(void) {
+  log_timestamp_provider_t provider = prv_inst.provider;
+
+  return provider ? provider() : prv_tick_provider();
+}
+
+uint64_t log_timestamp_get_from_isr(void) {
+  log_timestamp_provider_t provider = prv_inst.provider;
+
+  return provider ? provider() : prv_tick_provider_from_isr();
+}
+
+uint32_t log_timestamp_get_freq(void) {
+  return prv_inst.freq_hz ? prv_inst.freq_hz : configTICK_RATE_HZ;
+}
+
+void log_timestamp_refresh(void) { (void)log_timestamp_get(); }
+
+uint32_t log_timestamp_refresh_ms(void) {
+  uint64_t ms = (1ull << 31) * 1000u / log_timestamp_get_freq();
+
+  return (ms < UINT32_MAX) ? (uint32_t)ms : UINT32_MAX;
+}
+
+uint64_t log_timestamp_extend(log_timestamp_ext_t *ext, uint32_t raw) {
+  if (raw < ext->last) {
+    ext->high++;
+  }
+
+  ext->last = raw;
+
+  return ((uint64_t)ext->high << 32) | raw;
+}
+
+bool log_timestamp_epoch_changed(uint64_t timestamp, bool in_isr) {
+  uint32_t epoch = (uint32_t)(timestamp >> 32);
+  bool changed = false;
+
+  if (epoch == prv_inst.epoch) {
+    return false;
+  }
+
+  if (in_isr) {
+    UBaseType_t saved_isr_state = taskENTER_CRITICAL_FROM_ISR();
+    changed = (epoch != prv_inst.epoch);
+    prv_inst.epoch = epoch;
+    taskEXIT_CRITICAL_FROM_ISR(saved_isr_state);
+  } else {
+    taskENTER_CRITICAL();
+    changed = (epoch != prv_inst.epoch);
+    prv_inst.epoch = epoch;
+    taskEXIT_CRITICAL();
+  }
+
+  return changed;
+}
+
+void log_timestamp_track(const log_msg_t *msg) {
+  if (msg == NULL) {
+    return;
+  }
+
+  // Only the log thread writes, so reading without the lock is safe here
+  if (msg->callsite_id != LOG_CALLSITE_ID_SYNC) {
+    uint64_t last = prv_inst.has_last
+                        ? prv_expand(prv_inst.last, msg->timestamp)
+                        : msg->timestamp;
+
+    taskENTER_CRITICAL();
+    prv_inst.last = last;
+    prv_inst.has_last = true;
+    taskEXIT_CRITICAL();
+    return;
+  }
+
+  if (msg->args_buffer_size < sizeof(log_timestamp_sync_t)) {
+    return;
+  }
+
+  log_timestamp_sync_t sync;
+  memcpy(&sync, msg->args_buffer, sizeof(sync));
+
+  taskENTER_CRITICAL();
+  prv_inst.last = sync.timestamp;
+  prv_inst.has_last = true;
+
+  if (sync.wallclock_us != 0 && sync.freq_hz != 0) {
+    prv_inst.sync_timestamp = sync.timestamp;
+    prv_inst.sync_wallclock_us = sync.wallclock_us;
+    prv_inst.sync_freq_hz = sync.freq_hz;
+    prv_inst.has_wallclock = true;
+  }
+  taskEXIT_CRITICAL();
+}
+
+uint64_t log_timestamp_expand(uint32_t timestamp) {
+  bool in_isr = xPortIsInsideInterrupt();
+
+  UBaseType_t saved_isr_state = prv_enter_critical(in_isr);
+  uint64_t last = prv_inst.last;
+  prv_exit_critical(in_isr, saved_isr_state);
+
+  return prv_expand(last, timestamp);
+}
+
+bool log_timestamp_to_wallclock(uint64_t timestamp, uint64_t *wallclock_us) {
+  if (wallclock_us == NULL) {
+    return false;
+  }
+
+  // Snapshot the sync point so a concurrent update cannot tear it
+  bool in_isr = xPortIsInsideInterrupt();
+
+  UBaseType_t saved_isr_state = prv_enter_critical(in_isr);
+  bool has_wallclock = prv_inst.has_wallclock;
+  uint64_t sync_timestamp = prv_inst.sync_timestamp;
+  uint64_t sync_wallclock_us = prv_inst.sync_wallclock_us;
+  uint64_t freq = prv_inst.sync_freq_hz;
+  prv_exit_critical(in_isr, saved_isr_state);
+
+  if (!has_wallclock) {
+    return false;
+  }
+
+  bool before = timestamp < sync_timestamp;
+  uint64_t delta =
+      before ? sync_timestamp - timestamp : timestamp - sync_timestamp;
+
+  // Split to avoid overflowing the multiplication for large deltas
+  uint64_t delta_us = (delta / freq) * LOG_TIMESTAMP_US_PER_S +
+                      ((delta % freq) * LOG_TIMESTAMP_US_PER_S) / freq;
+
+  *wallclock_us =
+      before ? sync_wallclock_us - delta_us : sync_wallclock_us + delta_us;
+
+  return true;
+}
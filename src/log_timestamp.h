@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_timestamp.h
+ * @author Evan Stoddard
+ * @brief Pluggable high-resolution timestamp source
+ */
+
+#ifndef log_timestamp_h
+#define log_timestamp_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "log_msg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_timestamp_provider_t
+ * @brief Timestamp source, must be callable from task and ISR context
+ *
+ * @return Monotonic 64-bit timestamp
+ */
+typedef uint64_t (*log_timestamp_provider_t)(void);
+
+/**
+ * @typedef log_timestamp_ext_t
+ * @brief State for extending a wrapping 32-bit counter to 64 bits
+ *
+ */
+typedef struct log_timestamp_ext_t {
+  uint32_t last;
+  uint32_t high;
+} log_timestamp_ext_t;
+
+/**
+ * @typedef log_timestamp_sync_t
+ * @brief Payload of a time sync record
+ *
+ * Emitted whenever the upper 32 bits of the timestamp change and when the
+ * application provides a wallclock reference.  wallclock_us is 0 if unknown.
+ */
+typedef struct log_timestamp_sync_t {
+  uint64_t timestamp;
+  uint64_t wallclock_us;
+  uint32_t freq_hz;
+  uint32_t reserved;
+} log_timestamp_sync_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Install timestamp provider
+ *
+ * @param provider Timestamp source, NULL restores the tick count provider
+ * @param freq_hz Frequency the provider counts at
+ * @return 0 on success, -EINVAL on invalid frequency
+ */
+int log_timestamp_set_provider(log_timestamp_provider_t provider,
+                               uint32_t freq_hz);
+
+/**
+ * @brief Read current 64-bit timestamp from active provider (task context)
+ *
+ * @return Timestamp in provider units
+ */
+uint64_t log_timestamp_get(void);
+
+/**
+ * @brief Read current 64-bit timestamp from active provider (ISR context)
+ *
+ * @return Timestamp in provider units
+ */
+uint64_t log_timestamp_get_from_isr(void);
+
+/**
+ * @brief Get frequency of active provider
+ *
+ * @return Frequency in Hz
+ */
+uint32_t log_timestamp_get_freq(void);
+
+/**
+ * @brief Read active provider so its 64-bit extension keeps up while idle
+ *
+ * Called by the log thread whenever it has been idle for
+ * log_timestamp_refresh_ms.
+ */
+void log_timestamp_refresh(void);
+
+/**
+ * @brief Get longest interval between reads that loses no counter wrap
+ *
+ * @return Half the wrap period of a 32-bit counter at the active provider's
+ *         frequency, in ms
+ */
+uint32_t log_timestamp_refresh_ms(void);
+
+/**
+ * @brief Extend a wrapping 32-bit counter to 64 bits
+ *
+ * Must be called at least once per counter wrap and serialized by caller.
+ * The log thread reads the provider every log_timestamp_refresh_ms, so
+ * providers built on this need no traffic to keep up.
+ *
+ * @param ext Extension state
+ * @param raw Raw counter value
+ * @return 64-bit counter value
+ */
+uint64_t log_timestamp_extend(log_timestamp_ext_t *ext, uint32_t raw);
+
+/**
+ * @brief Check if timestamp starts a new 32-bit epoch since last check
+ *
+ * Returns true exactly once per epoch so only one sync record is emitted.
+ *
+ * @param timestamp 64-bit timestamp
+ * @param in_isr True if called from ISR
+ * @return true if a sync record should be emitted
+ */
+bool log_timestamp_epoch_changed(uint64_t timestamp, bool in_isr);
+
+/**
+ * @brief Track message on the log thread to keep expansion state current
+ *
+ * Called once per message by the dispatcher before it reaches backends.
+ *
+ * @param msg Pointer to message
+ */
+void log_timestamp_track(const log_msg_t *msg);
+
+/**
+ * @brief Expand 32-bit header timestamp to 64 bits
+ *
+ * Safe from any task or ISR, so backend worker tasks and panic paths can
+ * render while the log thread keeps tracking.
+ *
+ * @param timestamp Lower 32 bits from message header
+ * @return 64-bit timestamp closest to the last tracked message
+ */
+uint64_t log_timestamp_expand(uint32_t timestamp);
+
+/**
+ * @brief Convert 64-bit timestamp to wallclock using last sync record
+ *
+ * Safe from any task or ISR, like log_timestamp_expand.
+ *
+ * @param timestamp 64-bit timestamp
+ * @param wallclock_us Pointer to wallclock in microseconds
+ * @return true if a wallclock reference is known
+ */
+bool log_timestamp_to_wallclock(uint64_t timestamp, uint64_t *wallclock_us);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_timestamp_h */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_timestamp_dwt.c
+ * @author Evan Stoddard
+ * @brief DWT cycle counter timestamp provider implementation
+ */
+
+#include "log_timestamp_dwt.h"
+
+// FreeRTOS includes
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "log_timestamp.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Debug Exception and Monitor Control Register */
+#define LOG_DWT_DEMCR (*(volatile uint32_t *)0xE000EDFCu)
+
+/** @brief DWT Control Register */
+#define LOG_DWT_CTRL (*(volatile uint32_t *)0xE0001000u)
+
+/** @brief DWT Cycle Count Register */
+#define LOG_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004u)
+
+/** @brief DEMCR trace enable bit */
+#define LOG_DWT_DEMCR_TRCENA (1u << 24)
+
+/** @brief DWT_CTRL cycle counter enable bit */
+#define LOG_DWT_CTRL_CYCCNTENA (1u << 0)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance
+ */
+static struct {
+  log_timestamp_ext_t ext;
+} prv_inst;
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+uint64_t log_timestamp_dwt_get(void) {
+  // Raising BASEPRI is valid from task and ISR context on Cortex-M, so the
+  // provider does not need to detect its context
+  UBaseType_t saved_mask = portSET_INTERRUPT_MASK_FROM_ISR();
+  uint64_t cycles = log_timestamp_extend(&prv_inst.ext, LOG_DWT_CYCCNT);
+  portCLEAR_INTERRUPT_MASK_FROM_ISR(saved_mask);
+
+  return cycles;
+}
+
+int log_timestamp_dwt_init(uint32_t core_clock_hz) {
+  LOG_DWT_DEMCR |= LOG_DWT_DEMCR_TRCENA;
+  LOG_DWT_CYCCNT = 0;
+  LOG_DWT_CTRL |= LOG_DWT_CTRL_CYCCNTENA;
+
+  return log_timestamp_set_provider(log_timestamp_dwt_get, core_clock_hz);
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_timestamp_dwt.h
+ * @author Evan Stoddard
+ * @brief DWT cycle counter timestamp provider for Cortex-M3/M4/M7/M33
+ */
+
+#ifndef log_timestamp_dwt_h
+#define log_timestamp_dwt_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Enable DWT cycle counter and install it as timestamp provider
+ *
+ * The 32-bit counter is extended to 64 bits in software.  The log thread
+ * reads it at least every half wrap (e.g. ~12s at 168MHz) while idle.
+ *
+ * @param core_clock_hz CPU core clock frequency
+ * @return 0 on success, non-zero on error
+ */
+int log_timestamp_dwt_init(uint32_t core_clock_hz);
+
+/**
+ * @brief Read DWT cycle counter extended to 64 bits
+ *
+ * @return Cycle count
+ */
+uint64_t log_timestamp_dwt_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_timestamp_dwt_h */
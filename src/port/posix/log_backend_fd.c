@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_fd.c
+ * @author Evan Stoddard
+ * @brief writev backend for file descriptors on the FreeRTOS POSIX port
+ */
+
+#include "log_backend_fd.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Write slices with a single system call
+ *
+ * @param backend Pointer to backend
+ * @param iov Slices of the rendered line
+ * @param cnt Number of slices
+ */
+static void prv_write_iov(const log_backend_t *backend, const log_iov_t *iov,
+                          int cnt) {
+  const log_backend_fd_t *fd_backend = (const log_backend_fd_t *)backend;
+  struct iovec vec[LOG_RENDER_IOV_MAX];
+
+  if (cnt > LOG_RENDER_IOV_MAX) {
+    cnt = LOG_RENDER_IOV_MAX;
+  }
+
+  for (int i = 0; i < cnt; i++) {
+    vec[i].iov_base = (void *)iov[i].base;
+    vec[i].iov_len = iov[i].len;
+  }
+
+  // Short writes only happen on pipes and sockets, the rest is dropped
+  (void)writev(fd_backend->fd, vec, cnt);
+}
+
+/**
+ * @brief Render message and write it synchronously
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_panic_write(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  log_iov_t iov[LOG_RENDER_IOV_MAX];
+  char scratch[LOG_RENDER_IOV_SCRATCH_SIZE];
+
+  int cnt = log_render_msg_iov(msg, backend->layout, iov, LOG_RENDER_IOV_MAX,
+                               scratch, sizeof(scratch));
+  prv_write_iov(backend, iov, cnt);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_backend_fd_init(log_backend_fd_t *fd_backend, int fd) {
+  if (fd_backend == NULL || fd < 0) {
+    return -EINVAL;
+  }
+
+  memset(fd_backend, 0, sizeof(*fd_backend));
+
+  fd_backend->fd = fd;
+  fd_backend->backend.api.write_iov = prv_write_iov;
+  fd_backend->backend.api.panic_write = prv_panic_write;
+
+  return 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_fd.h
+ * @author Evan Stoddard
+ * @brief writev backend for file descriptors on the FreeRTOS POSIX port
+ */
+
+#ifndef log_backend_fd_h
+#define log_backend_fd_h
+
+#include "log_backend.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_backend_fd_t
+ * @brief Backend writing each line to a file descriptor with one writev
+ *
+ */
+typedef struct log_backend_fd_t {
+  log_backend_t backend;
+  int fd;
+} log_backend_fd_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize file descriptor backend
+ *
+ * Sets up the backend's API, `layout` and the masks may be adjusted
+ * afterwards.  Register it with log_backend_register_backend.
+ *
+ * @param fd_backend Pointer to backend
+ * @param fd Open file descriptor, e.g. STDOUT_FILENO
+ * @return 0 on success, -EINVAL on invalid arguments
+ */
+int log_backend_fd_init(log_backend_fd_t *fd_backend, int fd);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_backend_fd_h */
@@ -0,0 +1,807 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_file.c
+ * @author Evan Stoddard
+ * @brief Batched file backend with rotation for the FreeRTOS POSIX port
+ */
+
+#include "log_backend_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "log_render.h"
+
+#if LOG_FILE_USE_IO_URING && defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define LOG_FILE_HAVE_IO_URING 1
+#endif
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+#ifndef LOG_FILE_HAVE_IO_URING
+#define LOG_FILE_HAVE_IO_URING 0
+#endif
+
+/** @brief Alignment of the buffers */
+#define LOG_FILE_BUFFER_ALIGN 4096u
+
+/** @brief Polls of 1 ms log_panic waits for the I/O thread */
+#define LOG_FILE_PANIC_POLLS 1000u
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+#if LOG_FILE_HAVE_IO_URING
+/**
+ * @brief Mapped submission and completion rings
+ *
+ */
+struct log_backend_file_uring_t {
+  int fd;
+
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;
+  size_t cq_ring_size;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+
+  uint32_t *sq_tail;
+  uint32_t *sq_mask;
+  uint32_t *sq_array;
+  uint32_t *cq_head;
+  uint32_t *cq_tail;
+  uint32_t *cq_mask;
+  struct io_uring_cqe *cqes;
+};
+#endif
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Get monotonic time
+ *
+ * @return Milliseconds since an arbitrary point
+ */
+static uint64_t prv_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/**
+ * @brief Write all of a buffer at an offset
+ *
+ * @param file Pointer to backend
+ * @param data Data to write
+ * @param len Number of bytes
+ * @param offset File offset
+ */
+static void prv_pwrite(log_backend_file_t *file, const uint8_t *data,
+                       size_t len, uint64_t offset) {
+  while (len > 0) {
+    ssize_t ret = pwrite(file->fd, data, len, (off_t)offset);
+
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (ret <= 0) {
+      file->errors++;
+      return;
+    }
+
+    data += ret;
+    len -= (size_t)ret;
+    offset += (uint64_t)ret;
+  }
+}
+
+#if LOG_FILE_HAVE_IO_URING
+/**
+ * @brief Release io_uring instance
+ *
+ * @param file Pointer to backend
+ */
+static void prv_uring_deinit(log_backend_file_t *file) {
+  struct log_backend_file_uring_t *uring = file->uring;
+
+  if (uring == NULL) {
+    return;
+  }
+
+  if (uring->sqes != NULL && uring->sqes != MAP_FAILED) {
+    munmap(uring->sqes, uring->sqes_size);
+  }
+  if (uring->cq_ring != NULL && uring->cq_ring != MAP_FAILED &&
+      uring->cq_ring != uring->sq_ring) {
+    munmap(uring->cq_ring, uring->cq_ring_size);
+  }
+  if (uring->sq_ring != NULL && uring->sq_ring != MAP_FAILED) {
+    munmap(uring->sq_ring, uring->sq_ring_size);
+  }
+
+  close(uring->fd);
+  free(uring);
+  file->uring = NULL;
+}
+
+/**
+ * @brief Set up io_uring, leaving `file->uring` NULL if unavailable
+ *
+ * @param file Pointer to backend
+ */
+static void prv_uring_init(log_backend_file_t *file) {
+  struct io_uring_params params;
+
+  memset(&params, 0, sizeof(params));
+
+  // Fails on kernels without io_uring or where it is disabled
+  int fd = (int)syscall(__NR_io_uring_setup, LOG_FILE_BUFFER_COUNT, &params);
+  if (fd < 0) {
+    return;
+  }
+
+  struct log_backend_file_uring_t *uring = calloc(1, sizeof(*uring));
+  if (uring == NULL) {
+    close(fd);
+    return;
+  }
+
+  uring->fd = fd;
+  file->uring = uring;
+
+  uring->sq_ring_size =
+      params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  uring->cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (uring->cq_ring_size > uring->sq_ring_size) {
+      uring->sq_ring_size = uring->cq_ring_size;
+    }
+    uring->cq_ring_size = uring->sq_ring_size;
+  }
+
+  uring->sq_ring = mmap(NULL, uring->sq_ring_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (uring->sq_ring == MAP_FAILED) {
+    prv_uring_deinit(file);
+    return;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    uring->cq_ring = uring->sq_ring;
+  } else {
+    uring->cq_ring = mmap(NULL, uring->cq_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (uring->cq_ring == MAP_FAILED) {
+      prv_uring_deinit(file);
+      return;
+    }
+  }
+
+  uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  uring->sqes = mmap(NULL, uring->sqes_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (uring->sqes == MAP_FAILED) {
+    prv_uring_deinit(file);
+    return;
+  }
+
+  uint8_t *sq = uring->sq_ring;
+  uint8_t *cq = uring->cq_ring;
+
+  uring->sq_tail = (uint32_t *)(sq + params.sq_off.tail);
+  uring->sq_mask = (uint32_t *)(sq + params.sq_off.ring_mask);
+  uring->sq_array = (uint32_t *)(sq + params.sq_off.array);
+  uring->cq_head = (uint32_t *)(cq + params.cq_off.head);
+  uring->cq_tail = (uint32_t *)(cq + params.cq_off.tail);
+  uring->cq_mask = (uint32_t *)(cq + params.cq_off.ring_mask);
+  uring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+}
+
+/**
+ * @brief Write buffers with one io_uring submission
+ *
+ * Each buffer's result is stored in `res`, a negative errno or the number of
+ * bytes written.
+ *
+ * @param file Pointer to backend
+ * @param first Index of first buffer
+ * @param n Number of buffers
+ * @param res Result per buffer
+ * @return 0 on success, negative error code if the ring failed
+ */
+static int prv_uring_write(log_backend_file_t *file, uint32_t first,
+                           uint32_t n, int32_t *res) {
+  struct log_backend_file_uring_t *uring = file->uring;
+  uint32_t tail = *uring->sq_tail;
+  uint32_t mask = *uring->sq_mask;
+  uint64_t offset = file->offset;
+
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t idx = (first + i) % LOG_FILE_BUFFER_COUNT;
+    struct io_uring_sqe *sqe = &uring->sqes[tail & mask];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = file->fd;
+    sqe->addr = (uint64_t)(uintptr_t)file->buf[idx];
+    sqe->len = file->len[idx];
+    sqe->off = offset;
+    sqe->user_data = i;
+
+    uring->sq_array[tail & mask] = tail & mask;
+    offset += file->len[idx];
+    tail++;
+  }
+
+  __atomic_store_n(uring->sq_tail, tail, __ATOMIC_RELEASE);
+
+  uint32_t submitted = 0;
+  uint32_t reaped = 0;
+  uint32_t head = *uring->cq_head;
+
+  while (reaped < n) {
+    uint32_t cq_tail = __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE);
+
+    if (head == cq_tail) {
+      // Submits what is left and sleeps until every write completed
+      int ret = (int)syscall(__NR_io_uring_enter, uring->fd, n - submitted,
+                             n - reaped, IORING_ENTER_GETEVENTS, NULL, 0);
+
+      if (ret < 0 && errno == EINTR) {
+        continue;
+      }
+
+      if (ret < 0) {
+        return -errno;
+      }
+
+      submitted += (uint32_t)ret;
+      continue;
+    }
+
+    struct io_uring_cqe *cqe = &uring->cqes[head & *uring->cq_mask];
+
+    res[cqe->user_data] = cqe->res;
+    head++;
+    reaped++;
+    __atomic_store_n(uring->cq_head, head, __ATOMIC_RELEASE);
+  }
+
+  return 0;
+}
+#endif
+
+/**
+ * @brief Write consecutive buffers at the end of the file
+ *
+ * @param file Pointer to backend
+ * @param first Index of first buffer
+ * @param n Number of buffers
+ */
+static void prv_write_run(log_backend_file_t *file, uint32_t first,
+                          uint32_t n) {
+  int32_t res[LOG_FILE_BUFFER_COUNT];
+  bool submitted = false;
+
+  if (file->fd < 0) {
+    file->errors += n;
+    return;
+  }
+
+#if LOG_FILE_HAVE_IO_URING
+  if (file->uring != NULL) {
+    submitted = prv_uring_write(file, first, n, res) == 0;
+
+    // Kernels before 5.6 have io_uring but no IORING_OP_WRITE, a broken ring
+    // is closed too and pwrite rewrites whatever it may have missed
+    if (!submitted || res[0] == -EINVAL) {
+      prv_uring_deinit(file);
+      submitted = false;
+    }
+  }
+#endif
+
+  file->batches++;
+
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t idx = (first + i) % LOG_FILE_BUFFER_COUNT;
+    uint32_t len = file->len[idx];
+    uint32_t done = 0;
+
+    if (submitted && res[i] > 0) {
+      done = (uint32_t)res[i];
+    }
+
+    // Short or failed writes are finished synchronously
+    if (done < len) {
+      prv_pwrite(file, file->buf[idx] + done, len - done,
+                 file->offset + done);
+    }
+
+    file->offset += len;
+    file->bytes_written += len;
+  }
+}
+
+/**
+ * @brief Open `config.path` for appending
+ *
+ * @param file Pointer to backend
+ * @param truncate Discard existing contents
+ * @return 0 on success, negative error code otherwise
+ */
+static int prv_open_file(log_backend_file_t *file, bool truncate) {
+  struct stat st;
+  int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+
+  // O_APPEND is left out, pwrite would ignore the offset with it
+  file->fd = open(file->config.path, flags, 0644);
+  if (file->fd < 0) {
+    return -errno;
+  }
+
+  if (fstat(file->fd, &st) != 0) {
+    int ret = -errno;
+    close(file->fd);
+    file->fd = -1;
+    return ret;
+  }
+
+  file->offset = (uint64_t)st.st_size;
+  file->opened_ms = prv_now_ms();
+
+  return 0;
+}
+
+/**
+ * @brief Shift rotated files by one and start a new file
+ *
+ * @param file Pointer to backend
+ */
+static void prv_rotate(log_backend_file_t *file) {
+  char from[PATH_MAX];
+  char to[PATH_MAX];
+  const char *path = file->config.path;
+
+  if (file->fd >= 0) {
+    close(file->fd);
+    file->fd = -1;
+  }
+
+  if (file->config.keep > 0) {
+    // The oldest one is replaced by rename
+    for (uint32_t i = file->config.keep - 1; i > 0; i--) {
+      snprintf(from, sizeof(from), "%s.%u", path, (unsigned)i);
+      snprintf(to, sizeof(to), "%s.%u", path, (unsigned)(i + 1));
+      (void)rename(from, to);
+    }
+
+    snprintf(to, sizeof(to), "%s.1", path);
+    (void)rename(path, to);
+  }
+
+  if (prv_open_file(file, true) != 0) {
+    file->errors++;
+  }
+
+  file->rotations++;
+}
+
+/**
+ * @brief Check whether a buffer has to go to a new file
+ *
+ * @param file Pointer to backend
+ * @param offset Offset the buffer would be written at
+ * @param len Size of the buffer
+ * @param now_ms Current time
+ * @return True if the file is due for rotation
+ */
+static bool prv_rotate_due(const log_backend_file_t *file, uint64_t offset,
+                           uint32_t len, uint64_t now_ms) {
+  // An empty file is never rotated, a single buffer may exceed the limit
+  if (offset == 0) {
+    return false;
+  }
+
+  if (file->config.rotate_bytes > 0 &&
+      offset + len > file->config.rotate_bytes) {
+    return true;
+  }
+
+  return file->config.rotate_interval_ms > 0 &&
+         now_ms - file->opened_ms >= file->config.rotate_interval_ms;
+}
+
+/**
+ * @brief Write queued buffers, rotating between them where due (I/O thread)
+ *
+ * @param file Pointer to backend
+ * @param first Index of first buffer
+ * @param n Number of buffers
+ */
+static void prv_write_batch(log_backend_file_t *file, uint32_t first,
+                            uint32_t n) {
+  uint64_t now_ms = prv_now_ms();
+  uint32_t i = 0;
+
+  // A file that could not be opened after a rotation is retried
+  if (file->fd < 0 && prv_open_file(file, false) != 0) {
+    file->errors++;
+  }
+
+  while (i < n) {
+    uint32_t idx = (first + i) % LOG_FILE_BUFFER_COUNT;
+
+    if (prv_rotate_due(file, file->offset, file->len[idx], now_ms)) {
+      prv_rotate(file);
+    }
+
+    // Buffers going to the same file are submitted together
+    uint64_t end = file->offset + file->len[idx];
+    uint32_t run = 1;
+
+    while (i + run < n) {
+      uint32_t len = file->len[(first + i + run) % LOG_FILE_BUFFER_COUNT];
+
+      if (prv_rotate_due(file, end, len, now_ms)) {
+        break;
+      }
+
+      end += len;
+      run++;
+    }
+
+    prv_write_run(file, idx, run);
+    i += run;
+  }
+}
+
+/**
+ * @brief Queue fill buffer for writing if it has data and one is free (lock)
+ *
+ * @param file Pointer to backend
+ * @return True if the buffer was queued
+ */
+static bool prv_queue_fill(log_backend_file_t *file) {
+  if (file->len[file->fill] == 0 ||
+      file->queued == LOG_FILE_BUFFER_COUNT - 1) {
+    return false;
+  }
+
+  file->queued++;
+  file->fill = (file->fill + 1) % LOG_FILE_BUFFER_COUNT;
+  pthread_cond_signal(&file->wake);
+
+  return true;
+}
+
+/**
+ * @brief Wait for a signal or until a deadline passes (lock)
+ *
+ * @param file Pointer to backend
+ * @param deadline_ms Monotonic time to wait until
+ */
+static void prv_wait_until(log_backend_file_t *file, uint64_t deadline_ms) {
+  struct timespec ts = {
+      .tv_sec = (time_t)(deadline_ms / 1000u),
+      .tv_nsec = (long)(deadline_ms % 1000u) * 1000000L,
+  };
+
+  pthread_cond_timedwait(&file->wake, &file->lock, &ts);
+}
+
+/**
+ * @brief I/O thread, a native thread that never calls into FreeRTOS
+ *
+ * @param args Pointer to backend
+ * @return NULL
+ */
+static void *prv_io_thread(void *args) {
+  log_backend_file_t *file = args;
+  uint32_t flush_ms =
+      file->config.flush_ms > 0 ? file->config.flush_ms : LOG_FILE_FLUSH_MS;
+  uint64_t deadline_ms = 0;
+
+  pthread_mutex_lock(&file->lock);
+
+  while (true) {
+    // A partly filled buffer is written once it waited for flush_ms
+    if (file->queued == 0 && file->len[file->fill] > 0) {
+      uint64_t now_ms = prv_now_ms();
+
+      if (deadline_ms == 0) {
+        deadline_ms = now_ms + flush_ms;
+      }
+
+      if (now_ms >= deadline_ms || file->stop) {
+        prv_queue_fill(file);
+      }
+    }
+
+    if (file->queued == 0) {
+      if (file->stop) {
+        break;
+      }
+
+      if (file->len[file->fill] > 0) {
+        prv_wait_until(file, deadline_ms);
+      } else {
+        pthread_cond_wait(&file->wake, &file->lock);
+      }
+      continue;
+    }
+
+    uint32_t first = file->next;
+    uint32_t n = file->queued;
+
+    deadline_ms = 0;
+
+    // Queued buffers are not touched by the log thread until released
+    pthread_mutex_unlock(&file->lock);
+    prv_write_batch(file, first, n);
+    pthread_mutex_lock(&file->lock);
+
+    for (uint32_t i = 0; i < n; i++) {
+      file->len[(first + i) % LOG_FILE_BUFFER_COUNT] = 0;
+    }
+
+    file->next = (first + n) % LOG_FILE_BUFFER_COUNT;
+    file->queued -= n;
+  }
+
+  pthread_mutex_unlock(&file->lock);
+
+  return NULL;
+}
+
+/**
+ * @brief Copy rendered slices into the fill buffer
+ *
+ * @param backend Pointer to backend
+ * @param iov Slices of the rendered line
+ * @param cnt Number of slices
+ */
+static void prv_write_iov(const log_backend_t *backend, const log_iov_t *iov,
+                          int cnt) {
+  log_backend_file_t *file = (log_backend_file_t *)backend;
+  size_t line_len = 0;
+
+  for (int i = 0; i < cnt; i++) {
+    line_len += iov[i].len;
+  }
+
+  if (line_len == 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&file->lock);
+
+  if (file->len[file->fill] + line_len > LOG_FILE_BUFFER_SIZE) {
+    prv_queue_fill(file);
+  }
+
+  uint32_t len = file->len[file->fill];
+
+  if (len + line_len > LOG_FILE_BUFFER_SIZE) {
+    file->dropped++;
+  } else {
+    uint8_t *dst = file->buf[file->fill] + len;
+
+    for (int i = 0; i < cnt; i++) {
+      memcpy(dst, iov[i].base, iov[i].len);
+      dst += iov[i].len;
+    }
+
+    file->len[file->fill] = len + (uint32_t)line_len;
+
+    // Lets the I/O thread start the flush_ms timer
+    if (len == 0) {
+      pthread_cond_signal(&file->wake);
+    }
+  }
+
+  pthread_mutex_unlock(&file->lock);
+}
+
+/**
+ * @brief Queue the fill buffer and check whether everything was written
+ *
+ * @param file Pointer to backend
+ * @return True if nothing is left to write
+ */
+static bool prv_drain(log_backend_file_t *file) {
+  pthread_mutex_lock(&file->lock);
+
+  prv_queue_fill(file);
+  bool done = file->queued == 0 && file->len[file->fill] == 0;
+
+  pthread_mutex_unlock(&file->lock);
+
+  return done;
+}
+
+/**
+ * @brief Wait until the I/O thread has written everything buffered
+ *
+ * @param backend Pointer to backend
+ * @param timeout_ms Maximum time to wait
+ * @return 0 on success, -ETIMEDOUT otherwise
+ */
+static int prv_flush(const log_backend_t *backend, uint32_t timeout_ms) {
+  log_backend_file_t *file = (log_backend_file_t *)backend;
+  TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+
+  // Polled, blocking on the native condition would stall the scheduler
+  while (!prv_drain(file)) {
+    if ((int32_t)(deadline - xTaskGetTickCount()) <= 0) {
+      return -ETIMEDOUT;
+    }
+
+    vTaskDelay(1);
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Write message and wait for the I/O thread without the scheduler
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_panic_write(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  log_backend_file_t *file = (log_backend_file_t *)backend;
+  const struct timespec poll = {.tv_sec = 0, .tv_nsec = 1000000L};
+  log_iov_t iov[LOG_RENDER_IOV_MAX];
+  char scratch[LOG_RENDER_IOV_SCRATCH_SIZE];
+
+  int cnt = log_render_msg_iov(msg, backend->layout, iov, LOG_RENDER_IOV_MAX,
+                               scratch, sizeof(scratch));
+  prv_write_iov(backend, iov, cnt);
+
+  // The I/O thread is not a task and keeps running after a panic
+  for (uint32_t i = 0; i < LOG_FILE_PANIC_POLLS && !prv_drain(file); i++) {
+    nanosleep(&poll, NULL);
+  }
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_backend_file_open(log_backend_file_t *file,
+                          const log_backend_file_config_t *config) {
+  pthread_condattr_t attr;
+  sigset_t all_signals;
+  sigset_t saved_signals;
+
+  if (file == NULL || config == NULL || config->path == NULL) {
+    return -EINVAL;
+  }
+
+  memset(file, 0, sizeof(*file));
+
+  file->config = *config;
+  file->fd = -1;
+
+  int ret = prv_open_file(file, false);
+  if (ret != 0) {
+    return ret;
+  }
+
+  for (uint32_t i = 0; i < LOG_FILE_BUFFER_COUNT; i++) {
+    ret = posix_memalign((void **)&file->buf[i], LOG_FILE_BUFFER_ALIGN,
+                         LOG_FILE_BUFFER_SIZE);
+    if (ret != 0) {
+      file->buf[i] = NULL;
+      ret = -ret;
+      goto fail;
+    }
+  }
+
+#if LOG_FILE_HAVE_IO_URING
+  prv_uring_init(file);
+#endif
+
+  // Deadlines come from CLOCK_MONOTONIC
+  pthread_mutex_init(&file->lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&file->wake, &attr);
+  pthread_condattr_destroy(&attr);
+
+  // The port runs its scheduler on signals, keep them off the I/O thread
+  sigfillset(&all_signals);
+  pthread_sigmask(SIG_SETMASK, &all_signals, &saved_signals);
+  ret = -pthread_create(&file->thread, NULL, prv_io_thread, file);
+  pthread_sigmask(SIG_SETMASK, &saved_signals, NULL);
+  if (ret != 0) {
+    pthread_cond_destroy(&file->wake);
+    pthread_mutex_destroy(&file->lock);
+    goto fail;
+  }
+
+  file->backend.api.write_iov = prv_write_iov;
+  file->backend.api.flush = prv_flush;
+  file->backend.api.panic_write = prv_panic_write;
+
+  return 0;
+
+fail:
+#if LOG_FILE_HAVE_IO_URING
+  prv_uring_deinit(file);
+#endif
+  for (uint32_t i = 0; i < LOG_FILE_BUFFER_COUNT; i++) {
+    free(file->buf[i]);
+    file->buf[i] = NULL;
+  }
+  close(file->fd);
+  file->fd = -1;
+
+  return ret;
+}
+
+void log_backend_file_close(log_backend_file_t *file) {
+  if (file == NULL || file->buf[0] == NULL) {
+    return;
+  }
+
+  // The I/O thread writes what is buffered before it exits
+  pthread_mutex_lock(&file->lock);
+  file->stop = true;
+  pthread_cond_signal(&file->wake);
+  pthread_mutex_unlock(&file->lock);
+
+  pthread_join(file->thread, NULL);
+  pthread_cond_destroy(&file->wake);
+  pthread_mutex_destroy(&file->lock);
+
+#if LOG_FILE_HAVE_IO_URING
+  prv_uring_deinit(file);
+#endif
+
+  for (uint32_t i = 0; i < LOG_FILE_BUFFER_COUNT; i++) {
+    free(file->buf[i]);
+    file->buf[i] = NULL;
+  }
+
+  if (file->fd >= 0) {
+    close(file->fd);
+    file->fd = -1;
+  }
+}
+
+bool log_backend_file_uses_io_uring(const log_backend_file_t *file) {
+  return file != NULL && file->uring != NULL;
+}
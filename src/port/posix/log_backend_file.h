@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_file.h
+ * @author Evan Stoddard
+ * @brief Batched file backend with rotation for the FreeRTOS POSIX port
+ *
+ * The log thread copies rendered lines into large page aligned buffers and
+ * never makes a system call for a line.  Full buffers are written by a
+ * native I/O thread, several at once with io_uring where the kernel
+ * supports it and with pwrite otherwise.  The I/O thread also rotates the
+ * file, so renaming and opening files never holds up the log thread.  It
+ * blocks every signal, which the port reserves for its scheduler.
+ */
+
+#ifndef log_backend_file_h
+#define log_backend_file_h
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "log_backend.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Size of each buffer, a multiple of the page size */
+#define LOG_FILE_BUFFER_SIZE (256u * 1024u)
+
+/** @brief Number of buffers, one is filled while the others are written */
+#define LOG_FILE_BUFFER_COUNT 8u
+
+/** @brief Default time a partly filled buffer waits before it is written */
+#define LOG_FILE_FLUSH_MS 100u
+
+/** @brief Submit writes with io_uring when the kernel supports it (0/1) */
+#define LOG_FILE_USE_IO_URING 1
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_backend_file_config_t
+ * @brief File backend settings
+ *
+ * Rotation renames `path` to `path.1`, `path.1` to `path.2` and so on up to
+ * `path.<keep>`, then starts a new `path`.
+ */
+typedef struct log_backend_file_config_t {
+  // File to write, must stay valid while the backend is open
+  const char *path;
+
+  // Rotate once the file would grow past this size, 0 to disable
+  uint64_t rotate_bytes;
+
+  // Rotate once the file is this old, 0 to disable
+  uint32_t rotate_interval_ms;
+
+  // Rotated files kept, 0 truncates `path` on rotation
+  uint32_t keep;
+
+  // Time a partly filled buffer waits, 0 for LOG_FILE_FLUSH_MS
+  uint32_t flush_ms;
+} log_backend_file_config_t;
+
+/** @brief io_uring instance, private to log_backend_file.c */
+struct log_backend_file_uring_t;
+
+/**
+ * @typedef log_backend_file_t
+ * @brief Batched file backend
+ *
+ * Buffers are used in turn.  `fill` is the one the log thread copies into,
+ * the `queued` ones before it wait for or are being written by the I/O
+ * thread, starting at `next`.  Lines that do not fit while every other
+ * buffer is queued are dropped and counted.
+ */
+typedef struct log_backend_file_t {
+  log_backend_t backend;
+  log_backend_file_config_t config;
+
+  // Shared with the I/O thread, guarded by `lock`
+  uint8_t *buf[LOG_FILE_BUFFER_COUNT];
+  uint32_t len[LOG_FILE_BUFFER_COUNT];
+  uint32_t fill;
+  uint32_t next;
+  uint32_t queued;
+  bool stop;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_t thread;
+
+  // Owned by the I/O thread
+  int fd;
+  uint64_t offset;
+  uint64_t opened_ms;
+  struct log_backend_file_uring_t *uring;
+
+  // Statistics
+  uint64_t bytes_written;
+  uint32_t batches;
+  uint32_t rotations;
+  uint32_t dropped;
+  uint32_t errors;
+} log_backend_file_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Open file and start the I/O thread
+ *
+ * Lines are appended to an existing file.  Sets up the backend's API,
+ * `layout` and the masks may be adjusted afterwards.  Register
+ * `&file->backend` with log_backend_register_backend.
+ *
+ * @param file Pointer to backend
+ * @param config Settings, copied
+ * @return 0 on success, negative error code otherwise
+ */
+int log_backend_file_open(log_backend_file_t *file,
+                          const log_backend_file_config_t *config);
+
+/**
+ * @brief Write everything buffered, stop the I/O thread and close the file
+ *
+ * Unregister the backend first.
+ *
+ * @param file Pointer to backend
+ */
+void log_backend_file_close(log_backend_file_t *file);
+
+/**
+ * @brief Check whether writes are submitted with io_uring
+ *
+ * @param file Pointer to backend
+ * @return True if io_uring is in use, false if pwrite is
+ */
+bool log_backend_file_uses_io_uring(const log_backend_file_t *file);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_backend_file_h */
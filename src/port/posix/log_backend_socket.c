@@ -0,0 +1,405 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_socket.c
+ * @author Evan Stoddard
+ * @brief Batched datagram backend for the FreeRTOS POSIX port
+ */
+
+#include "log_backend_socket.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log_callsite.h"
+#include "log_render.h"
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Get monotonic time
+ *
+ * @return Milliseconds since an arbitrary point
+ */
+static uint64_t prv_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+/**
+ * @brief Send datagram being filled and start the next one (lock)
+ *
+ * @param sock Pointer to backend
+ */
+static void prv_send(log_backend_socket_t *sock) {
+  if (sock->count == 0) {
+    return;
+  }
+
+  log_datagram_header_t header = {
+      .magic = LOG_DATAGRAM_MAGIC,
+      .session = sock->session,
+      .sequence = sock->sequence++,
+      .count = sock->count,
+      .format = sock->format,
+  };
+
+  memcpy(sock->datagram, &header, sizeof(header));
+
+  ssize_t ret = sendto(sock->fd, sock->datagram, sock->len, MSG_DONTWAIT,
+                       (const struct sockaddr *)&sock->addr, sock->addr_len);
+
+  if (ret == (ssize_t)sock->len) {
+    sock->datagrams++;
+  } else {
+    // Callsite records may have been in it, describe them again
+    sock->dropped++;
+    memset(sock->announced, 0, sizeof(sock->announced));
+  }
+
+  sock->len = sizeof(header);
+  sock->count = 0;
+}
+
+/**
+ * @brief Make room for a record in the datagram being filled (lock)
+ *
+ * @param sock Pointer to backend
+ * @param len Size of record
+ * @return Where to copy the record, NULL if it can never fit
+ */
+static uint8_t *prv_reserve(log_backend_socket_t *sock, size_t len) {
+  if (sizeof(log_datagram_header_t) + len > sock->datagram_size) {
+    sock->oversized++;
+    return NULL;
+  }
+
+  if (sock->len + len > sock->datagram_size || sock->count == UINT16_MAX) {
+    prv_send(sock);
+  }
+
+  uint8_t *dst = sock->datagram + sock->len;
+
+  sock->len += (uint32_t)len;
+
+  // Lets the flush thread start timing the datagram
+  if (sock->count++ == 0) {
+    pthread_cond_signal(&sock->wake);
+  }
+
+  return dst;
+}
+
+/**
+ * @brief Append rendered line as a text record (lock)
+ *
+ * @param sock Pointer to backend
+ * @param iov Slices of the rendered line
+ * @param cnt Number of slices
+ */
+static void prv_put_iov(log_backend_socket_t *sock, const log_iov_t *iov,
+                        int cnt) {
+  size_t len = 0;
+
+  for (int i = 0; i < cnt; i++) {
+    len += iov[i].len;
+  }
+
+  uint8_t *dst = len > 0 ? prv_reserve(sock, len) : NULL;
+  if (dst == NULL) {
+    return;
+  }
+
+  for (int i = 0; i < cnt; i++) {
+    memcpy(dst, iov[i].base, iov[i].len);
+    dst += iov[i].len;
+  }
+}
+
+/**
+ * @brief Append encoded frame in `sock->frame` as a binary record (lock)
+ *
+ * @param sock Pointer to backend
+ * @param len Size of the frame, 0 if it was too large
+ * @return true if the record was added
+ */
+static bool prv_put_frame(log_backend_socket_t *sock, size_t len) {
+  if (len == 0) {
+    sock->oversized++;
+    return false;
+  }
+
+  uint8_t *dst = prv_reserve(sock, len);
+  if (dst == NULL) {
+    return false;
+  }
+
+  memcpy(dst, sock->frame, len);
+
+  return true;
+}
+
+/**
+ * @brief Append message as binary records, callsite record first (lock)
+ *
+ * @param sock Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_put_msg(log_backend_socket_t *sock, const log_msg_t *msg) {
+  uint16_t id = msg->callsite_id;
+  uint32_t bit = 1ul << (id % 32);
+
+  if (id < LOG_MAX_CALLSITES && !(sock->announced[id / 32] & bit)) {
+    const log_callsite_t *callsite = log_callsite_get(id);
+
+    // A datagram that gets dropped clears the bitmap again
+    if (callsite != NULL &&
+        prv_put_frame(sock,
+                      log_binary_frame_callsite(callsite, id, sock->frame))) {
+      sock->announced[id / 32] |= bit;
+    }
+  }
+
+  prv_put_frame(sock, log_binary_frame_msg(msg, sock->frame));
+}
+
+/**
+ * @brief Backend write_iov, text format
+ *
+ * @param backend Pointer to backend
+ * @param iov Slices of the rendered line
+ * @param cnt Number of slices
+ */
+static void prv_write_iov(const log_backend_t *backend, const log_iov_t *iov,
+                          int cnt) {
+  log_backend_socket_t *sock = (log_backend_socket_t *)backend;
+
+  pthread_mutex_lock(&sock->lock);
+  prv_put_iov(sock, iov, cnt);
+  pthread_mutex_unlock(&sock->lock);
+}
+
+/**
+ * @brief Backend process_msg, binary format
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_process_msg(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  log_backend_socket_t *sock = (log_backend_socket_t *)backend;
+
+  pthread_mutex_lock(&sock->lock);
+  prv_put_msg(sock, msg);
+  pthread_mutex_unlock(&sock->lock);
+}
+
+/**
+ * @brief Send partly filled datagram
+ *
+ * @param backend Pointer to backend
+ * @param timeout_ms Unused, sends never block
+ * @return 0
+ */
+static int prv_flush(const log_backend_t *backend, uint32_t timeout_ms) {
+  log_backend_socket_t *sock = (log_backend_socket_t *)backend;
+
+  (void)timeout_ms;
+
+  pthread_mutex_lock(&sock->lock);
+  prv_send(sock);
+  pthread_mutex_unlock(&sock->lock);
+
+  return 0;
+}
+
+/**
+ * @brief Add message and send it right away
+ *
+ * @param backend Pointer to backend
+ * @param msg Pointer to message
+ */
+static void prv_panic_write(const log_backend_t *backend,
+                            const log_msg_t *msg) {
+  log_backend_socket_t *sock = (log_backend_socket_t *)backend;
+
+  pthread_mutex_lock(&sock->lock);
+
+  if (sock->format == LOG_DATAGRAM_FORMAT_BINARY) {
+    prv_put_msg(sock, msg);
+  } else {
+    log_iov_t iov[LOG_RENDER_IOV_MAX];
+    char scratch[LOG_RENDER_IOV_SCRATCH_SIZE];
+
+    int cnt = log_render_msg_iov(msg, backend->layout, iov,
+                                 LOG_RENDER_IOV_MAX, scratch, sizeof(scratch));
+    prv_put_iov(sock, iov, cnt);
+  }
+
+  prv_send(sock);
+
+  pthread_mutex_unlock(&sock->lock);
+}
+
+/**
+ * @brief Flush thread, a native thread that never calls into FreeRTOS
+ *
+ * @param args Pointer to backend
+ * @return NULL
+ */
+static void *prv_flush_thread(void *args) {
+  log_backend_socket_t *sock = args;
+
+  pthread_mutex_lock(&sock->lock);
+
+  while (!sock->stop) {
+    if (sock->count == 0) {
+      pthread_cond_wait(&sock->wake, &sock->lock);
+      continue;
+    }
+
+    // Sending it early for size restarts the timer with the next datagram
+    uint32_t sequence = sock->sequence;
+    uint64_t deadline_ms = prv_now_ms() + sock->flush_ms;
+    struct timespec ts = {
+        .tv_sec = (time_t)(deadline_ms / 1000u),
+        .tv_nsec = (long)(deadline_ms % 1000u) * 1000000L,
+    };
+
+    while (!sock->stop && sock->sequence == sequence &&
+           prv_now_ms() < deadline_ms) {
+      pthread_cond_timedwait(&sock->wake, &sock->lock, &ts);
+    }
+
+    if (sock->sequence == sequence) {
+      prv_send(sock);
+    }
+  }
+
+  prv_send(sock);
+
+  pthread_mutex_unlock(&sock->lock);
+
+  return NULL;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_backend_socket_open(log_backend_socket_t *sock,
+                            const log_backend_socket_config_t *config) {
+  pthread_condattr_t attr;
+  struct timespec now;
+  sigset_t all_signals;
+  sigset_t saved_signals;
+
+  if (sock == NULL || config == NULL || config->addr == NULL ||
+      config->addr_len > sizeof(sock->addr) ||
+      (config->format != LOG_DATAGRAM_FORMAT_TEXT &&
+       config->format != LOG_DATAGRAM_FORMAT_BINARY)) {
+    return -EINVAL;
+  }
+
+  uint32_t size = config->datagram_size > 0 ? config->datagram_size
+                                            : LOG_SOCKET_DATAGRAM_SIZE;
+
+  // Every binary record has to fit on its own
+  if (size > LOG_SOCKET_MAX_DATAGRAM_SIZE ||
+      size < sizeof(log_datagram_header_t) + LOG_BINARY_MAX_FRAME_SIZE) {
+    return -EINVAL;
+  }
+
+  memset(sock, 0, sizeof(*sock));
+
+  sock->fd = socket(config->addr->sa_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sock->fd < 0) {
+    return -errno;
+  }
+
+  // Unix datagrams stay charged to the sender until they are received
+  int sndbuf = LOG_SOCKET_SEND_BUFFER;
+  setsockopt(sock->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+  memcpy(&sock->addr, config->addr, config->addr_len);
+  sock->addr_len = config->addr_len;
+  sock->format = config->format;
+  sock->datagram_size = size;
+  sock->flush_ms =
+      config->flush_ms > 0 ? config->flush_ms : LOG_SOCKET_FLUSH_MS;
+  sock->len = sizeof(log_datagram_header_t);
+
+  // Tells the receiver a new sequence started
+  clock_gettime(CLOCK_REALTIME, &now);
+  sock->session = (uint32_t)now.tv_nsec ^ ((uint32_t)now.tv_sec << 8) ^
+                  ((uint32_t)getpid() << 16);
+
+  // Deadlines come from CLOCK_MONOTONIC
+  pthread_mutex_init(&sock->lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&sock->wake, &attr);
+  pthread_condattr_destroy(&attr);
+
+  // The port runs its scheduler on signals, keep them off the flush thread
+  sigfillset(&all_signals);
+  pthread_sigmask(SIG_SETMASK, &all_signals, &saved_signals);
+  int ret = -pthread_create(&sock->thread, NULL, prv_flush_thread, sock);
+  pthread_sigmask(SIG_SETMASK, &saved_signals, NULL);
+  if (ret != 0) {
+    pthread_cond_destroy(&sock->wake);
+    pthread_mutex_destroy(&sock->lock);
+    close(sock->fd);
+    sock->fd = -1;
+    return ret;
+  }
+
+  if (sock->format == LOG_DATAGRAM_FORMAT_BINARY) {
+    sock->backend.api.process_msg = prv_process_msg;
+  } else {
+    sock->backend.api.write_iov = prv_write_iov;
+  }
+  sock->backend.api.flush = prv_flush;
+  sock->backend.api.panic_write = prv_panic_write;
+
+  return 0;
+}
+
+void log_backend_socket_close(log_backend_socket_t *sock) {
+  if (sock == NULL || sock->fd < 0) {
+    return;
+  }
+
+  // The flush thread sends what is left before it exits
+  pthread_mutex_lock(&sock->lock);
+  sock->stop = true;
+  pthread_cond_signal(&sock->wake);
+  pthread_mutex_unlock(&sock->lock);
+
+  pthread_join(sock->thread, NULL);
+  pthread_cond_destroy(&sock->wake);
+  pthread_mutex_destroy(&sock->lock);
+
+  close(sock->fd);
+  sock->fd = -1;
+}
+
+void log_backend_socket_reannounce(log_backend_socket_t *sock) {
+  if (sock == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&sock->lock);
+  memset(sock->announced, 0, sizeof(sock->announced));
+  pthread_mutex_unlock(&sock->lock);
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_backend_socket.h
+ * @author Evan Stoddard
+ * @brief Batched datagram backend for the FreeRTOS POSIX port
+ *
+ * Records are packed into datagrams of up to `datagram_size` bytes and sent
+ * over a UDP or Unix datagram socket, see log_datagram.h for the format.  A
+ * datagram is sent when the next record does not fit, on log_flush, or once
+ * its first record waited for `flush_ms`, which a native thread that blocks
+ * every signal takes care of.  `tools/log_receiver.c` writes the stream to
+ * disk.
+ */
+
+#ifndef log_backend_socket_h
+#define log_backend_socket_h
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "log_backend.h"
+#include "log_binary.h"
+#include "log_config.h"
+#include "log_datagram.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Default datagram size, the UDP payload of a 1500 byte MTU */
+#define LOG_SOCKET_DATAGRAM_SIZE 1472u
+
+/** @brief Largest datagram size */
+#define LOG_SOCKET_MAX_DATAGRAM_SIZE 8192u
+
+/** @brief Default time the first record of a datagram waits */
+#define LOG_SOCKET_FLUSH_MS 20u
+
+/** @brief Send buffer requested from the kernel, absorbs bursts */
+#define LOG_SOCKET_SEND_BUFFER (1024 * 1024)
+
+/** @brief Number of words in the announced callsite bitmap */
+#define LOG_BACKEND_SOCKET_CALLSITE_WORDS ((LOG_MAX_CALLSITES + 31) / 32)
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_backend_socket_config_t
+ * @brief Socket backend settings
+ *
+ */
+typedef struct log_backend_socket_config_t {
+  // Receiver, a sockaddr_in or sockaddr_un, copied
+  const struct sockaddr *addr;
+  socklen_t addr_len;
+
+  // LOG_DATAGRAM_FORMAT_TEXT or LOG_DATAGRAM_FORMAT_BINARY
+  uint8_t format;
+
+  // Bytes per datagram, header included, 0 for LOG_SOCKET_DATAGRAM_SIZE
+  uint32_t datagram_size;
+
+  // Time the first record of a datagram waits, 0 for LOG_SOCKET_FLUSH_MS
+  uint32_t flush_ms;
+} log_backend_socket_config_t;
+
+/**
+ * @typedef log_backend_socket_t
+ * @brief Batched datagram backend
+ *
+ * Sends never block.  A datagram the socket does not take is dropped and
+ * counted, its sequence number is used anyway so the receiver sees the gap.
+ */
+typedef struct log_backend_socket_t {
+  log_backend_t backend;
+
+  int fd;
+  struct sockaddr_storage addr;
+  socklen_t addr_len;
+  uint8_t format;
+  uint32_t datagram_size;
+  uint32_t flush_ms;
+
+  // Datagram being filled, guarded by `lock`
+  uint8_t datagram[LOG_SOCKET_MAX_DATAGRAM_SIZE] __attribute__((aligned(8)));
+  uint32_t len;
+  uint16_t count;
+  uint32_t session;
+  uint32_t sequence;
+
+  // Callsites described to the receiver, binary format only
+  uint32_t announced[LOG_BACKEND_SOCKET_CALLSITE_WORDS];
+  uint8_t frame[LOG_BINARY_MAX_FRAME_SIZE];
+
+  // Sends partly filled datagrams after flush_ms
+  bool stop;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_t thread;
+
+  // Statistics
+  uint32_t datagrams;
+  uint32_t dropped;
+  uint32_t oversized;
+} log_backend_socket_t;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Create socket and start the flush thread
+ *
+ * The receiver does not have to be running yet, datagrams sent before it
+ * is are counted as dropped.  Register `&sock->backend` with
+ * log_backend_register_backend.
+ *
+ * @param sock Pointer to backend
+ * @param config Settings
+ * @return 0 on success, negative error code otherwise
+ */
+int log_backend_socket_open(log_backend_socket_t *sock,
+                            const log_backend_socket_config_t *config);
+
+/**
+ * @brief Send what is left, stop the flush thread and close the socket
+ *
+ * Unregister the backend first.
+ *
+ * @param sock Pointer to backend
+ */
+void log_backend_socket_close(log_backend_socket_t *sock);
+
+/**
+ * @brief Describe every callsite again before its next message
+ *
+ * Call when a receiver (re)starts, binary format only.
+ *
+ * @param sock Pointer to backend
+ */
+void log_backend_socket_reannounce(log_backend_socket_t *sock);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_backend_socket_h */
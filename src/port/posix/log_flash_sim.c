@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_flash_sim.c
+ * @author Evan Stoddard
+ * @brief File backed NOR flash simulator for the POSIX port
+ */
+
+#include "log_flash_sim.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static int prv_read(void *ctx, uint32_t addr, void *buf, size_t len);
+static int prv_program(void *ctx, uint32_t addr, const void *data,
+                       size_t len);
+static int prv_erase(void *ctx, uint32_t addr);
+
+const log_flash_driver_t log_flash_sim_driver = {
+    .read = prv_read,
+    .program = prv_program,
+    .erase = prv_erase,
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Account for time an operation takes on real flash
+ *
+ * @param sim Pointer to instance
+ * @param us Duration in microseconds
+ */
+static void prv_busy(log_flash_sim_t *sim, uint32_t us) {
+  sim->busy_us += us;
+
+  if (sim->realtime) {
+    usleep(us);
+  }
+}
+
+/**
+ * @brief Driver read
+ *
+ * @param ctx Pointer to instance
+ * @param addr Address
+ * @param buf Output buffer
+ * @param len Number of bytes
+ * @return 0 on success, -EINVAL if out of range
+ */
+static int prv_read(void *ctx, uint32_t addr, void *buf, size_t len) {
+  log_flash_sim_t *sim = ctx;
+
+  if (addr > sim->size || len > sim->size - addr) {
+    return -EINVAL;
+  }
+
+  memcpy(buf, sim->mem + addr, len);
+
+  return 0;
+}
+
+/**
+ * @brief Driver program, clears bits within one page
+ *
+ * @param ctx Pointer to instance
+ * @param addr Address
+ * @param data Data to program
+ * @param len Number of bytes
+ * @return 0 on success, -EINVAL if out of range or crossing a page, -EIO if
+ * a bit would have to go from 0 to 1
+ */
+static int prv_program(void *ctx, uint32_t addr, const void *data,
+                       size_t len) {
+  log_flash_sim_t *sim = ctx;
+  const uint8_t *in = data;
+  uint32_t page_size = sim->geometry.page_size;
+
+  if (addr > sim->size || len > sim->size - addr ||
+      (addr % page_size) + len > page_size) {
+    sim->violations++;
+    return -EINVAL;
+  }
+
+  uint8_t *cell = sim->mem + addr;
+  bool set_bits = false;
+
+  for (size_t i = 0; i < len; i++) {
+    set_bits |= (in[i] & ~cell[i]) != 0;
+    cell[i] &= in[i];
+  }
+
+  sim->programs++;
+  sim->bytes_programmed += len;
+  prv_busy(sim, sim->program_us);
+
+  if (set_bits) {
+    sim->violations++;
+    return -EIO;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Driver erase
+ *
+ * @param ctx Pointer to instance
+ * @param addr Sector aligned address
+ * @return 0 on success, -EINVAL if out of range or not aligned
+ */
+static int prv_erase(void *ctx, uint32_t addr) {
+  log_flash_sim_t *sim = ctx;
+  uint32_t sector_size = sim->geometry.sector_size;
+
+  if (addr % sector_size != 0 || addr >= sim->size) {
+    sim->violations++;
+    return -EINVAL;
+  }
+
+  memset(sim->mem + addr, 0xFF, sector_size);
+
+  sim->erases++;
+  sim->erase_counts[addr / sector_size]++;
+  prv_busy(sim, sim->erase_us);
+
+  return 0;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_flash_sim_init(log_flash_sim_t *sim, const char *path,
+                       const log_flash_geometry_t *geometry) {
+  struct stat st;
+
+  if (sim == NULL || geometry == NULL || geometry->page_size == 0 ||
+      geometry->sector_size % geometry->page_size != 0 ||
+      geometry->sector_count == 0) {
+    return -EINVAL;
+  }
+
+  memset(sim, 0, sizeof(*sim));
+
+  sim->geometry = *geometry;
+  sim->size = (size_t)geometry->sector_size * geometry->sector_count;
+  sim->program_us = LOG_FLASH_SIM_PROGRAM_US;
+  sim->erase_us = LOG_FLASH_SIM_ERASE_US;
+
+  sim->erase_counts = calloc(geometry->sector_count, sizeof(uint32_t));
+  if (sim->erase_counts == NULL) {
+    return -ENOMEM;
+  }
+
+  if (path == NULL) {
+    sim->mem = mmap(NULL, sim->size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (sim->mem == MAP_FAILED) {
+      sim->mem = NULL;
+      log_flash_sim_deinit(sim);
+      return -ENOMEM;
+    }
+
+    memset(sim->mem, 0xFF, sim->size);
+    return 0;
+  }
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    int ret = -errno;
+    if (fd >= 0) {
+      close(fd);
+    }
+    log_flash_sim_deinit(sim);
+    return ret;
+  }
+
+  size_t old_size = (size_t)st.st_size;
+
+  if (old_size != sim->size && ftruncate(fd, (off_t)sim->size) != 0) {
+    int ret = -errno;
+    close(fd);
+    log_flash_sim_deinit(sim);
+    return ret;
+  }
+
+  sim->mem = mmap(NULL, sim->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (sim->mem == MAP_FAILED) {
+    sim->mem = NULL;
+    log_flash_sim_deinit(sim);
+    return -ENOMEM;
+  }
+
+  // Space the file did not cover yet comes out of the factory erased
+  if (old_size < sim->size) {
+    memset(sim->mem + old_size, 0xFF, sim->size - old_size);
+  }
+
+  return 0;
+}
+
+void log_flash_sim_deinit(log_flash_sim_t *sim) {
+  if (sim == NULL) {
+    return;
+  }
+
+  if (sim->mem != NULL) {
+    munmap(sim->mem, sim->size);
+    sim->mem = NULL;
+  }
+
+  free(sim->erase_counts);
+  sim->erase_counts = NULL;
+}
+
+uint32_t log_flash_sim_max_erase_count(const log_flash_sim_t *sim) {
+  uint32_t max = 0;
+
+  for (uint32_t i = 0; sim && i < sim->geometry.sector_count; i++) {
+    if (sim->erase_counts[i] > max) {
+      max = sim->erase_counts[i];
+    }
+  }
+
+  return max;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_flash_sim.h
+ * @author Evan Stoddard
+ * @brief File backed NOR flash simulator for the POSIX port
+ */
+
+#ifndef log_flash_sim_h
+#define log_flash_sim_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "log_backend_flash.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Default time to program a page, typical serial NOR */
+#define LOG_FLASH_SIM_PROGRAM_US 700u
+
+/** @brief Default time to erase a sector, typical serial NOR */
+#define LOG_FLASH_SIM_ERASE_US 45000u
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_flash_sim_t
+ * @brief Simulated NOR flash
+ *
+ * Erase sets a whole sector to 0xFF, programming can only clear bits and
+ * must stay within one page.  Operations that break these rules fail and
+ * are counted in `violations`.  `busy_us` adds up the time the operations
+ * would take on real flash, they only take that long if `realtime` is set.
+ */
+typedef struct log_flash_sim_t {
+  log_flash_geometry_t geometry;
+  uint8_t *mem;
+  size_t size;
+
+  // Timing model
+  uint32_t program_us;
+  uint32_t erase_us;
+  bool realtime;
+
+  // Statistics
+  uint64_t programs;
+  uint64_t erases;
+  uint64_t bytes_programmed;
+  uint64_t busy_us;
+  uint32_t violations;
+  uint32_t *erase_counts;
+} log_flash_sim_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/** @brief Driver to pass to log_backend_flash_init with the instance as ctx */
+extern const log_flash_driver_t log_flash_sim_driver;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize simulated flash
+ *
+ * A new backing file starts out erased.  An existing one keeps its contents,
+ * like flash across a reset.
+ *
+ * @param sim Pointer to instance
+ * @param path Backing file, NULL for flash that only lives in memory
+ * @param geometry Flash layout
+ * @return 0 on success, negative error code otherwise
+ */
+int log_flash_sim_init(log_flash_sim_t *sim, const char *path,
+                       const log_flash_geometry_t *geometry);
+
+/**
+ * @brief Release simulated flash, the backing file is kept
+ *
+ * @param sim Pointer to instance
+ */
+void log_flash_sim_deinit(log_flash_sim_t *sim);
+
+/**
+ * @brief Get highest erase count of any sector since init
+ *
+ * @param sim Pointer to instance
+ * @return Erase count of the most worn sector
+ */
+uint32_t log_flash_sim_max_erase_count(const log_flash_sim_t *sim);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_flash_sim_h */
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_persist_posix.c
+ * @author Evan Stoddard
+ * @brief File backed persistent region for the FreeRTOS POSIX port
+ */
+
+#include "log_persist_posix.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+void *log_persist_posix_map(const char *path, size_t size) {
+  struct stat st;
+
+  if (path == NULL || size == 0) {
+    return NULL;
+  }
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  // Keep the contents of an existing file, new space reads as zero
+  if (fstat(fd, &st) != 0 ||
+      ((size_t)st.st_size != size && ftruncate(fd, (off_t)size) != 0)) {
+    close(fd);
+    return NULL;
+  }
+
+  void *region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  // The mapping keeps the file referenced
+  close(fd);
+
+  return region == MAP_FAILED ? NULL : region;
+}
+
+void log_persist_posix_unmap(void *region, size_t size) {
+  if (region != NULL) {
+    munmap(region, size);
+  }
+}
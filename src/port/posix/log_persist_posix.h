@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_persist_posix.h
+ * @author Evan Stoddard
+ * @brief File backed persistent region for the FreeRTOS POSIX port
+ */
+
+#ifndef log_persist_posix_h
+#define log_persist_posix_h
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Map file as a region that survives a process restart
+ *
+ * Stands in for a `.noinit` RAM section.  The mapping is shared with the
+ * file, so whatever the process wrote is still there after it crashed or
+ * was killed.  The file is created and sized as needed.
+ *
+ * @param path Path of backing file
+ * @param size Size of region in bytes
+ * @return Region for log_backend_persist_init, NULL on error
+ */
+void *log_persist_posix_map(const char *path, size_t size);
+
+/**
+ * @brief Unmap region returned by log_persist_posix_map
+ *
+ * @param region Region
+ * @param size Size of region in bytes
+ */
+void log_persist_posix_unmap(void *region, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_persist_posix_h */
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_timestamp_posix.c
+ * @author Evan Stoddard
+ * @brief clock_gettime timestamp provider for the FreeRTOS POSIX port
+ */
+
+#include "log_timestamp_posix.h"
+
+#include <time.h>
+
+#include "log_core.h"
+#include "log_timestamp.h"
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+uint64_t log_timestamp_posix_get(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * LOG_TIMESTAMP_POSIX_FREQ_HZ +
+         (uint64_t)ts.tv_nsec;
+}
+
+int log_timestamp_posix_init(void) {
+  int ret = log_timestamp_set_provider(log_timestamp_posix_get,
+                                       LOG_TIMESTAMP_POSIX_FREQ_HZ);
+  if (ret != 0) {
+    return ret;
+  }
+
+  struct timespec wall;
+  clock_gettime(CLOCK_REALTIME, &wall);
+
+  return log_time_sync((uint64_t)wall.tv_sec * 1000000u +
+                       (uint64_t)wall.tv_nsec / 1000u);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_timestamp_posix.h
+ * @author Evan Stoddard
+ * @brief clock_gettime timestamp provider for the FreeRTOS POSIX port
+ */
+
+#ifndef log_timestamp_posix_h
+#define log_timestamp_posix_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Frequency of log_timestamp_posix_get (nanoseconds) */
+#define LOG_TIMESTAMP_POSIX_FREQ_HZ 1000000000u
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Read CLOCK_MONOTONIC in nanoseconds
+ *
+ * @return Monotonic timestamp in nanoseconds
+ */
+uint64_t log_timestamp_posix_get(void);
+
+/**
+ * @brief Install CLOCK_MONOTONIC provider and sync to CLOCK_REALTIME
+ *
+ * @return 0 on success, non-zero on error
+ */
+int log_timestamp_posix_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_timestamp_posix_h */
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_uart_sim.c
+ * @author Evan Stoddard
+ * @brief Simulated DMA UART for exercising async backends on the POSIX port
+ */
+
+#include "log_uart_sim.h"
+
+#include <errno.h>
+#include <stdbool.h>
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static int prv_start_write(void *ctx, const uint8_t *buf, size_t len);
+static void prv_poll_write(void *ctx, const uint8_t *buf, size_t len);
+
+const log_async_driver_t log_uart_sim_driver = {
+    .start_write = prv_start_write,
+    .poll_write = prv_poll_write,
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Start transfer
+ *
+ * @param ctx Simulated UART
+ * @param buf Data to transmit
+ * @param len Number of bytes
+ * @return 0 on success, -EBUSY if a transfer is in flight
+ */
+static int prv_start_write(void *ctx, const uint8_t *buf, size_t len) {
+  log_uart_sim_t *uart = ctx;
+
+  if (uart->buf != NULL) {
+    return -EBUSY;
+  }
+
+  uart->len = len;
+  uart->buf = buf;
+  xTaskNotifyGive(uart->task);
+
+  return 0;
+}
+
+/**
+ * @brief Transmit without simulated delay
+ *
+ * @param ctx Simulated UART
+ * @param buf Data to transmit
+ * @param len Number of bytes
+ */
+static void prv_poll_write(void *ctx, const uint8_t *buf, size_t len) {
+  log_uart_sim_t *uart = ctx;
+
+  fwrite(buf, 1, len, uart->out);
+  fflush(uart->out);
+}
+
+/**
+ * @brief DMA task, completes each transfer after its time on the wire
+ *
+ * @param args Simulated UART
+ */
+static void prv_dma_task(void *args) {
+  log_uart_sim_t *uart = args;
+
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    const uint8_t *buf = uart->buf;
+    if (buf == NULL) {
+      continue;
+    }
+
+    uint64_t bits = (uint64_t)uart->len * LOG_UART_SIM_BITS_PER_BYTE;
+    uint32_t ms = (uint32_t)((bits * 1000u + uart->baud - 1) / uart->baud);
+    TickType_t ticks = pdMS_TO_TICKS(ms);
+
+    vTaskDelay(ticks > 0 ? ticks : 1);
+
+    fwrite(buf, 1, uart->len, uart->out);
+    fflush(uart->out);
+    uart->bytes_written += (uint32_t)uart->len;
+
+    // Cleared first, the completion may start the next transfer
+    uart->buf = NULL;
+    log_async_write_done(uart->owner);
+  }
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int log_uart_sim_init(log_uart_sim_t *uart, uint32_t baud, FILE *out,
+                      log_async_backend_t *owner) {
+  if (uart == NULL || baud == 0 || out == NULL || owner == NULL) {
+    return -EINVAL;
+  }
+
+  uart->baud = baud;
+  uart->out = out;
+  uart->owner = owner;
+  uart->buf = NULL;
+  uart->len = 0;
+  uart->bytes_written = 0;
+
+  uart->task = xTaskCreateStatic(
+      prv_dma_task, "LogUartSim",
+      LOG_UART_SIM_STACK_SIZE_BYTES / sizeof(StackType_t), uart,
+      LOG_UART_SIM_PRIORITY, uart->stack, &uart->task_storage);
+
+  return (uart->task != NULL) ? 0 : -EIO;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_uart_sim.h
+ * @author Evan Stoddard
+ * @brief Simulated DMA UART for exercising async backends on the POSIX port
+ */
+
+#ifndef log_uart_sim_h
+#define log_uart_sim_h
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "log_async.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Stack size of the task standing in for the DMA controller */
+#define LOG_UART_SIM_STACK_SIZE_BYTES 1024
+
+/** @brief Priority of the DMA task, above the log thread like an interrupt */
+#define LOG_UART_SIM_PRIORITY (LOG_THREAD_PRIORITY + 1)
+
+/** @brief Bits on the wire per byte (8N1) */
+#define LOG_UART_SIM_BITS_PER_BYTE 10u
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef log_uart_sim_t
+ * @brief Simulated UART instance
+ *
+ * A transfer takes as long as it would on the wire at `baud`, then the data
+ * is written to `out` and completion is reported to `owner`.
+ */
+typedef struct log_uart_sim_t {
+  uint32_t baud;
+  FILE *out;
+  log_async_backend_t *owner;
+
+  // Transfer in flight, NULL while idle
+  const uint8_t *volatile buf;
+  size_t len;
+  uint32_t bytes_written;
+
+  TaskHandle_t task;
+  StaticTask_t task_storage;
+  StackType_t stack[LOG_UART_SIM_STACK_SIZE_BYTES / sizeof(StackType_t)];
+} log_uart_sim_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/** @brief Driver to pass to log_async_backend_init with the instance as ctx */
+extern const log_async_driver_t log_uart_sim_driver;
+
+/*****************************************************************************
+ * Function Prototypes
+ *****************************************************************************/
+
+/**
+ * @brief Initialize simulated UART and start its DMA task
+ *
+ * @param uart Pointer to instance
+ * @param baud Simulated baud rate
+ * @param out Stream receiving transmitted data
+ * @param owner Async backend completions are reported to
+ * @return 0 on success, negative error code otherwise
+ */
+int log_uart_sim_init(log_uart_sim_t *uart, uint32_t baud, FILE *out,
+                      log_async_backend_t *owner);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* log_uart_sim_h */
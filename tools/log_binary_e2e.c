@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_binary_e2e.c
+ * @author Evan Stoddard
+ * @brief End-to-end test of the binary backend and log_reader over a pty
+ *
+ * Runs on the FreeRTOS POSIX port.  log_backend_binary sends its frames
+ * through the simulated UART into the master side of a pty pair, and
+ * log_reader decodes them from the slave side like it would a serial port.
+ * Stray bytes and a partial frame are injected between messages, followed by
+ * a log_panic.  The reader's output must contain every expected line in
+ * order, and nothing of the message lost with the damaged frame.
+ *
+ * Build, with FREERTOS pointing at the kernel sources and CONFIG at a
+ * directory holding a FreeRTOSConfig.h with static allocation enabled:
+ *   P=$FREERTOS/portable/ThirdParty/GCC/Posix
+ *   cc -I src -I src/port/posix -I $CONFIG -I $FREERTOS/include -I $P \
+ *      -I $P/utils -o log_binary_e2e tools/log_binary_e2e.c src/log_*.c \
+ *      src/port/posix/log_uart_sim.c $FREERTOS/tasks.c $FREERTOS/queue.c \
+ *      $FREERTOS/list.c $FREERTOS/timers.c $P/port.c \
+ *      $P/utils/wait_for_event.c $FREERTOS/portable/MemMang/heap_3.c \
+ *      -lpthread
+ *
+ * Usage:
+ *   log_binary_e2e <log_reader>
+ *
+ * Exits with 0 if the stream decoded as expected, the reader's output is
+ * printed either way.
+ */
+
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "log.h"
+#include "log_backend_binary.h"
+#include "log_core.h"
+#include "log_uart_sim.h"
+
+LOG_REGISTER_MODULE(e2e)
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Simulated baud rate, fast enough to keep the run short */
+#define E2E_BAUD 1000000u
+
+/** @brief Time the reader gets to take everything written, in ms */
+#define E2E_DRAIN_TIMEOUT_MS 2000u
+
+/** @brief Time a flush may take, in ms */
+#define E2E_FLUSH_TIMEOUT_MS 1000u
+
+/** @brief Stack size of the test task */
+#define E2E_STACK_SIZE_BYTES 4096
+
+/** @brief Text of the message that is lost together with the partial frame */
+#define E2E_LOST_TEXT "lost 1"
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Lines the reader must print, in this order
+ */
+static const char *const prv_expected[] = {
+    "count=0 neg=-5 hex=ab char=q",
+    "count=1 neg=-6 hex=ac char=q",
+    "count=2 neg=-7 hex=ad char=q",
+    "after garbage 42",
+    "final 7",
+    "panic 8",
+};
+
+/** @brief Stray bytes, the terminating NUL ends them like a frame */
+static const char prv_garbage[] = "\x01\x02garbage\x03";
+
+/** @brief Start of a frame without delimiter, merges with the next one */
+static const uint8_t prv_partial[] = {0x07, 0x07, 0x07};
+
+/**
+ * @brief Private instance
+ */
+static struct {
+  int master;
+  int slave;
+  FILE *wire;
+  FILE *reader;
+
+  log_uart_sim_t uart;
+  log_backend_binary_t binary;
+
+  StaticTask_t task_storage;
+  StackType_t stack[E2E_STACK_SIZE_BYTES / sizeof(StackType_t)];
+} prv_inst;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Open pty pair, the slave side is put in raw mode
+ *
+ * @return 0 on success, -1 otherwise
+ */
+static int prv_open_pty(void) {
+  struct termios tio;
+
+  // The reader must not inherit the master, or it never sees the hangup
+  prv_inst.master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (prv_inst.master < 0 || grantpt(prv_inst.master) != 0 ||
+      unlockpt(prv_inst.master) != 0) {
+    return -1;
+  }
+
+  prv_inst.slave =
+      open(ptsname(prv_inst.master), O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (prv_inst.slave < 0 || tcgetattr(prv_inst.slave, &tio) != 0) {
+    return -1;
+  }
+
+  cfmakeraw(&tio);
+  if (tcsetattr(prv_inst.slave, TCSANOW, &tio) != 0) {
+    return -1;
+  }
+
+  prv_inst.wire = fdopen(prv_inst.master, "w");
+
+  return prv_inst.wire ? 0 : -1;
+}
+
+/**
+ * @brief Start reader on the slave side of the pty
+ *
+ * @param path Path of log_reader
+ * @return Reader's combined output, NULL on error
+ */
+static FILE *prv_start_reader(const char *path) {
+  char cmd[512];
+
+  // The simulator's long and pointers are as wide as the host's
+  snprintf(cmd, sizeof(cmd), "'%s' %s '%s' 2>&1", path,
+           sizeof(long) == 8 ? "-l" : "", ptsname(prv_inst.master));
+
+  return popen(cmd, "r");
+}
+
+/**
+ * @brief Write bytes to the wire between frames
+ *
+ * @param data Bytes to write
+ * @param len Number of bytes
+ */
+static void prv_inject(const void *data, size_t len) {
+  fwrite(data, 1, len, prv_inst.wire);
+  fflush(prv_inst.wire);
+}
+
+/**
+ * @brief Wait until the reader took everything written to the pty
+ */
+static void prv_drain(void) {
+  int pending = 0;
+
+  for (uint32_t waited = 0; waited < E2E_DRAIN_TIMEOUT_MS; waited += 10) {
+    if (ioctl(prv_inst.slave, FIONREAD, &pending) != 0 || pending == 0) {
+      return;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
+}
+
+/**
+ * @brief Compare reader output against the expected lines
+ *
+ * @return true if every expected line was printed in order
+ */
+static bool prv_check(void) {
+  size_t count = sizeof(prv_expected) / sizeof(prv_expected[0]);
+  size_t next = 0;
+  bool lost_seen = false;
+  char line[256];
+
+  while (fgets(line, sizeof(line), prv_inst.reader) != NULL) {
+    fputs(line, stdout);
+
+    if (next < count && strstr(line, prv_expected[next]) != NULL) {
+      next++;
+    }
+
+    if (strstr(line, E2E_LOST_TEXT) != NULL) {
+      lost_seen = true;
+    }
+  }
+
+  pclose(prv_inst.reader);
+
+  if (next < count) {
+    printf("FAIL: missing \"%s\"\n", prv_expected[next]);
+    return false;
+  }
+
+  if (lost_seen) {
+    printf("FAIL: \"%s\" decoded from a damaged frame\n", E2E_LOST_TEXT);
+    return false;
+  }
+
+  printf("PASS\n");
+  return true;
+}
+
+/**
+ * @brief Test task, logs through the binary backend and checks the reader
+ *
+ * @param args Unused
+ */
+static void prv_test_task(void *args) {
+  (void)args;
+
+  for (int i = 0; i < 3; i++) {
+    LOG_INF("count=%d neg=%ld hex=%x char=%c", i, -5L - i, 0xabu + i, 'q');
+    log_flush(E2E_FLUSH_TIMEOUT_MS);
+  }
+
+  prv_inject(prv_garbage, sizeof(prv_garbage));
+  LOG_WRN("after garbage %d", 42);
+  log_flush(E2E_FLUSH_TIMEOUT_MS);
+
+  // Takes the next callsite record down with it
+  prv_inject(prv_partial, sizeof(prv_partial));
+  LOG_DBG("lost %d", 1);
+  log_flush(E2E_FLUSH_TIMEOUT_MS);
+
+  LOG_INF("final %d", 7);
+  log_flush(E2E_FLUSH_TIMEOUT_MS);
+
+  LOG_WRN("panic %d", 8);
+  log_panic();
+
+  // Closing the master hangs up the pty, which ends the reader
+  prv_drain();
+  fclose(prv_inst.wire);
+  close(prv_inst.slave);
+
+  exit(prv_check() ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "usage: %s <log_reader>\n", argv[0]);
+    return 2;
+  }
+
+  if (prv_open_pty() != 0) {
+    perror("pty");
+    return 1;
+  }
+
+  // Forked before the scheduler starts its threads
+  prv_inst.reader = prv_start_reader(argv[1]);
+  if (prv_inst.reader == NULL) {
+    perror("log_reader");
+    return 1;
+  }
+
+  if (log_init() != 0 || log_start_thread() != 0 ||
+      log_backend_binary_init(&prv_inst.binary, &log_uart_sim_driver,
+                              &prv_inst.uart) != 0 ||
+      log_uart_sim_init(&prv_inst.uart, E2E_BAUD, prv_inst.wire,
+                        &prv_inst.binary.async) != 0 ||
+      log_backend_register_backend(&prv_inst.binary.async.backend) != 0) {
+    fprintf(stderr, "log setup failed\n");
+    return 1;
+  }
+
+  xTaskCreateStatic(prv_test_task, "E2E",
+                    E2E_STACK_SIZE_BYTES / sizeof(StackType_t), NULL,
+                    tskIDLE_PRIORITY + 1, prv_inst.stack,
+                    &prv_inst.task_storage);
+
+  vTaskStartScheduler();
+
+  return 1;
+}
@@ -0,0 +1,865 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_reader.c
+ * @author Evan Stoddard
+ * @brief Host decoder for the COBS framed binary log stream
+ *
+ * Reads frames written by log_backend_binary from a serial port, pty or
+ * capture file and prints them as text.  Frames failing the CRC are counted
+ * and skipped, decoding resumes at the next delimiter.  Delta records that
+ * refer to a lost frame are skipped until the sender refreshes them.
+ *
+ * Build:
+ *   cc -I src -o log_reader tools/log_reader.c src/log_cobs.c \
+ *      src/log_delta.c src/log_format.c src/log_kv.c
+ *
+ * Usage:
+ *   log_reader [-l] [-b baud] <device|file|->
+ *
+ * Arguments are stored with the target's type sizes.  ILP32 (32-bit long and
+ * pointers, e.g. Cortex-M) is assumed, `-l` selects LP64 for 64-bit targets
+ * such as the POSIX simulator.  `%s` arguments are target addresses and are
+ * printed as such.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "log_binary.h"
+#include "log_cobs.h"
+#include "log_config.h"
+#include "log_context.h"
+#include "log_delta.h"
+#include "log_event.h"
+#include "log_format.h"
+#include "log_kv.h"
+#include "log_msg.h"
+#include "log_timestamp.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+// Internal callsite IDs, kept in sync with log_callsite.h
+#define READER_CALLSITE_ID_RESERVED_START 0xFFF0
+#define READER_CALLSITE_ID_SYNC 0xFFF0
+#define READER_CALLSITE_ID_REPEAT 0xFFF1
+#define READER_CALLSITE_ID_EVENT 0xFFF2
+
+/** @brief Largest encoded frame, excluding the delimiter */
+#define READER_FRAME_SIZE                                                      \
+  LOG_COBS_MAX_ENCODED_SIZE(LOG_BINARY_MAX_RECORD_SIZE + 1 +                   \
+                            LOG_BINARY_CRC_SIZE)
+
+/** @brief Size of a rendered message body */
+#define READER_BODY_SIZE 512
+
+/*****************************************************************************
+ * Structs, Unions, Enums, & Typedefs
+ *****************************************************************************/
+
+/**
+ * @typedef reader_callsite_t
+ * @brief Callsite learned from a LOG_BINARY_RECORD_CALLSITE record
+ *
+ */
+typedef struct reader_callsite_t {
+  char *module;
+  char *function;
+  char *fmt_str;
+  char **keys;
+  uint8_t kv_count;
+} reader_callsite_t;
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance
+ *
+ */
+static struct {
+  reader_callsite_t *callsites[READER_CALLSITE_ID_RESERVED_START];
+
+  // Target type sizes
+  size_t long_size;
+  size_t ptr_size;
+
+  // Expansion of 32-bit header timestamps
+  uint64_t last_timestamp;
+
+  // Delta decoder, reset whenever a frame is lost
+  log_delta_t delta;
+  union {
+    log_msg_t msg;
+    uint8_t bytes[sizeof(log_msg_t) + LOG_BINARY_MAX_RECORD_SIZE];
+  } delta_msg;
+
+  // Decoded frame, 8-byte aligned so records can be read in place
+  uint8_t frame[READER_FRAME_SIZE] __attribute__((aligned(8)));
+  size_t frame_len;
+  bool frame_overrun;
+
+  // Statistics
+  unsigned long frames;
+  unsigned long crc_errors;
+  unsigned long malformed;
+  unsigned long unknown_callsites;
+  unsigned long unresolved_deltas;
+} prv_inst = {
+    .long_size = 4,
+    .ptr_size = 4,
+};
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Get level string of log level
+ *
+ * @param level Log level
+ * @return Level string, "???" if unknown
+ */
+static const char *prv_level_str(uint8_t level) {
+  static const char *const strs[] = {"", "ERR", "WRN", "INF", "DBG"};
+
+  return level < sizeof(strs) / sizeof(strs[0]) ? strs[level] : "???";
+}
+
+/**
+ * @brief Get size of an argument type on the target
+ *
+ * @param type Argument type
+ * @return Size in bytes
+ */
+static size_t prv_arg_size(log_format_arg_type_t type) {
+  switch (type) {
+  case LOG_FORMAT_ARG_INT:
+    return 4;
+  case LOG_FORMAT_ARG_LONG:
+    return prv_inst.long_size;
+  case LOG_FORMAT_ARG_LONG_LONG:
+  case LOG_FORMAT_ARG_INTMAX:
+  case LOG_FORMAT_ARG_DOUBLE:
+    return 8;
+  case LOG_FORMAT_ARG_SIZE:
+  case LOG_FORMAT_ARG_PTRDIFF:
+  case LOG_FORMAT_ARG_STRING:
+  case LOG_FORMAT_ARG_POINTER:
+  case LOG_FORMAT_ARG_WRITEBACK:
+    return prv_inst.ptr_size;
+  default:
+    return 0;
+  }
+}
+
+/**
+ * @brief Read little endian unsigned integer of target size
+ *
+ * @param data Source bytes
+ * @param size Size in bytes, at most 8
+ * @return Value
+ */
+static uint64_t prv_read_uint(const uint8_t *data, size_t size) {
+  uint64_t value = 0;
+
+  for (size_t i = size; i > 0; i--) {
+    value = (value << 8) | data[i - 1];
+  }
+
+  return value;
+}
+
+/**
+ * @brief Sign extend value read with prv_read_uint
+ *
+ * @param value Value
+ * @param size Size in bytes it was read with
+ * @return Signed value
+ */
+static int64_t prv_sign_extend(uint64_t value, size_t size) {
+  if (size >= 8) {
+    return (int64_t)value;
+  }
+
+  uint64_t sign = 1ull << (size * 8 - 1);
+
+  return (int64_t)((value ^ sign) - sign);
+}
+
+/**
+ * @brief Append formatted text to body
+ *
+ * @param body Body buffer
+ * @param len Current length, advanced by the text written
+ * @param fmt Format string
+ */
+__attribute__((format(printf, 3, 4))) static void
+prv_append(char *body, size_t *len, const char *fmt, ...) {
+  va_list args;
+
+  if (*len + 1 >= READER_BODY_SIZE) {
+    return;
+  }
+
+  va_start(args, fmt);
+  int ret = vsnprintf(body + *len, READER_BODY_SIZE - *len, fmt, args);
+  va_end(args);
+
+  if (ret > 0) {
+    *len += (size_t)ret;
+    if (*len >= READER_BODY_SIZE) {
+      *len = READER_BODY_SIZE - 1;
+    }
+  }
+}
+
+/**
+ * @brief Render a single conversion specifier
+ *
+ * @param body Body buffer
+ * @param len Current length
+ * @param spec Specifier
+ * @param arg Argument bytes
+ * @param size Size of argument on the target
+ */
+static void prv_render_spec(char *body, size_t *len,
+                            const log_format_spec_t *spec, const uint8_t *arg,
+                            size_t size) {
+  char fmt[32];
+  uint64_t raw = prv_read_uint(arg, size);
+  bool is_signed = spec->conversion == 'd' || spec->conversion == 'i';
+
+  if (spec->type == LOG_FORMAT_ARG_WRITEBACK) {
+    return;
+  }
+
+  if (spec->type == LOG_FORMAT_ARG_STRING) {
+    prv_append(body, len, "<str@0x%llx>", (unsigned long long)raw);
+    return;
+  }
+
+  if (spec->type == LOG_FORMAT_ARG_POINTER) {
+    prv_append(body, len, "0x%llx", (unsigned long long)raw);
+    return;
+  }
+
+  // Flags, width and precision are kept, length modifier replaced by ll
+  size_t prefix = spec->length - 1;
+  while (prefix > 1 && strchr("hlzjtL", spec->start[prefix - 1])) {
+    prefix--;
+  }
+
+  if (prefix + 4 > sizeof(fmt)) {
+    return;
+  }
+
+  memcpy(fmt, spec->start, prefix);
+
+  if (spec->type == LOG_FORMAT_ARG_DOUBLE) {
+    double value;
+    memcpy(&value, &raw, sizeof(value));
+    fmt[prefix] = spec->conversion;
+    fmt[prefix + 1] = '\0';
+    prv_append(body, len, fmt, value);
+    return;
+  }
+
+  if (spec->conversion == 'c') {
+    fmt[prefix] = 'c';
+    fmt[prefix + 1] = '\0';
+    prv_append(body, len, fmt, (int)raw);
+    return;
+  }
+
+  fmt[prefix] = 'l';
+  fmt[prefix + 1] = 'l';
+  fmt[prefix + 2] = spec->conversion;
+  fmt[prefix + 3] = '\0';
+
+  if (is_signed) {
+    prv_append(body, len, fmt, (long long)prv_sign_extend(raw, size));
+  } else {
+    prv_append(body, len, fmt, (unsigned long long)raw);
+  }
+}
+
+/**
+ * @brief Render printf style message body
+ *
+ * @param body Body buffer
+ * @param len Current length
+ * @param fmt_str Format string
+ * @param args Argument buffer
+ * @param args_size Size of argument buffer
+ */
+static void prv_render_fmt(char *body, size_t *len, const char *fmt_str,
+                           const uint8_t *args, size_t args_size) {
+  log_format_spec_t spec;
+  const char *p = fmt_str;
+  size_t offset = 0;
+
+  while (*p) {
+    const char *spec_start = log_format_next_spec(p, &spec);
+
+    if (spec_start == NULL) {
+      prv_append(body, len, "%s", p);
+      return;
+    }
+
+    prv_append(body, len, "%.*s", (int)(spec_start - p), p);
+    p = spec_start + spec.length;
+
+    if (spec.type == LOG_FORMAT_ARG_NONE) {
+      prv_append(body, len, "%%");
+      continue;
+    }
+
+    if (spec.type == LOG_FORMAT_ARG_INVALID) {
+      prv_append(body, len, "%.*s", (int)spec.length, spec.start);
+      continue;
+    }
+
+    size_t arg_size = prv_arg_size(spec.type);
+    if (offset + arg_size > args_size) {
+      return;
+    }
+
+    prv_render_spec(body, len, &spec, args + offset, arg_size);
+    offset += arg_size;
+  }
+}
+
+/**
+ * @brief Render key/value message body in logfmt style
+ *
+ * @param body Body buffer
+ * @param len Current length
+ * @param callsite Callsite holding event name and keys
+ * @param args Argument buffer
+ * @param args_size Size of argument buffer
+ */
+static void prv_render_kv(char *body, size_t *len,
+                          const reader_callsite_t *callsite,
+                          const uint8_t *args, size_t args_size) {
+  size_t offset = 0;
+
+  prv_append(body, len, "%s", callsite->fmt_str);
+
+  for (uint8_t i = 0; i < callsite->kv_count && offset < args_size; i++) {
+    log_kv_type_t type = (log_kv_type_t)args[offset];
+    size_t size = type == LOG_KV_TYPE_STR ? prv_inst.ptr_size
+                                          : log_kv_value_size(type);
+
+    if (size == 0 || offset + 1 + size > args_size) {
+      return;
+    }
+
+    uint64_t raw = prv_read_uint(&args[offset + 1], size);
+    offset += 1 + size;
+
+    prv_append(body, len, " %s=", callsite->keys[i]);
+
+    switch (type) {
+    case LOG_KV_TYPE_BOOL:
+      prv_append(body, len, "%s", raw ? "true" : "false");
+      break;
+    case LOG_KV_TYPE_I32:
+    case LOG_KV_TYPE_I64:
+      prv_append(body, len, "%lld", (long long)prv_sign_extend(raw, size));
+      break;
+    case LOG_KV_TYPE_U32:
+    case LOG_KV_TYPE_U64:
+      prv_append(body, len, "%llu", (unsigned long long)raw);
+      break;
+    case LOG_KV_TYPE_F32: {
+      float value;
+      uint32_t bits = (uint32_t)raw;
+      memcpy(&value, &bits, sizeof(value));
+      prv_append(body, len, "%g", (double)value);
+      break;
+    }
+    case LOG_KV_TYPE_F64: {
+      double value;
+      memcpy(&value, &raw, sizeof(value));
+      prv_append(body, len, "%g", value);
+      break;
+    }
+    default:
+      prv_append(body, len, "<str@0x%llx>", (unsigned long long)raw);
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Render body of an internal record
+ *
+ * @param body Body buffer
+ * @param len Current length
+ * @param msg Pointer to message
+ */
+static void prv_render_internal(char *body, size_t *len,
+                                const log_msg_t *msg) {
+  if (msg->callsite_id == READER_CALLSITE_ID_SYNC &&
+      msg->args_buffer_size >= sizeof(log_timestamp_sync_t)) {
+    log_timestamp_sync_t sync;
+
+    memcpy(&sync, msg->args_buffer, sizeof(sync));
+    prv_append(body, len, "time sync ts=%llu freq=%lu wallclock_us=%llu",
+               (unsigned long long)sync.timestamp,
+               (unsigned long)sync.freq_hz,
+               (unsigned long long)sync.wallclock_us);
+
+    // Sync records carry the full timestamp, resynchronize expansion
+    prv_inst.last_timestamp = sync.timestamp;
+    return;
+  }
+
+  if (msg->callsite_id == READER_CALLSITE_ID_REPEAT &&
+      msg->args_buffer_size >= sizeof(uint32_t)) {
+    uint32_t repeats;
+
+    memcpy(&repeats, msg->args_buffer, sizeof(repeats));
+    prv_append(body, len, "last message repeated %lu times",
+               (unsigned long)repeats);
+    return;
+  }
+
+  if (msg->callsite_id == READER_CALLSITE_ID_EVENT &&
+      msg->args_buffer_size >= sizeof(log_event_payload_t)) {
+    log_event_payload_t event;
+
+    memcpy(&event, msg->args_buffer, sizeof(event));
+
+    if (event.id == LOG_EVENT_ID_DROPPED) {
+      prv_append(body, len, "%lu events dropped", (unsigned long)event.value);
+    } else {
+      prv_append(body, len, "event 0x%04x value=%lu", (unsigned)event.id,
+                 (unsigned long)event.value);
+    }
+    return;
+  }
+
+  prv_append(body, len, "internal record 0x%04x",
+             (unsigned)msg->callsite_id);
+}
+
+/**
+ * @brief Expand 32-bit header timestamp to 64 bits
+ *
+ * @param timestamp Lower 32 bits from message header
+ * @return 64-bit timestamp closest to the previous message
+ */
+static uint64_t prv_expand_timestamp(uint32_t timestamp) {
+  int32_t delta = (int32_t)(timestamp - (uint32_t)prv_inst.last_timestamp);
+
+  prv_inst.last_timestamp += (uint64_t)(int64_t)delta;
+
+  return prv_inst.last_timestamp;
+}
+
+/**
+ * @brief Print LOG_BINARY_RECORD_MSG record
+ *
+ * @param record Record bytes
+ * @param len Size of record
+ */
+static void prv_handle_msg(const uint8_t *record, size_t len) {
+  const log_msg_t *msg = (const log_msg_t *)record;
+  char body[READER_BODY_SIZE];
+  size_t body_len = 0;
+
+  body[0] = '\0';
+
+  if (len < sizeof(log_msg_t) ||
+      len < sizeof(log_msg_t) + msg->args_buffer_size) {
+    prv_inst.malformed++;
+    return;
+  }
+
+  uint64_t timestamp = prv_expand_timestamp(msg->timestamp);
+
+  if (msg->callsite_id >= READER_CALLSITE_ID_RESERVED_START) {
+    prv_render_internal(body, &body_len, msg);
+    printf("[%llu] %s\n", (unsigned long long)timestamp, body);
+    return;
+  }
+
+  const reader_callsite_t *callsite = prv_inst.callsites[msg->callsite_id];
+
+  if (callsite == NULL) {
+    prv_inst.unknown_callsites++;
+    printf("[%llu] <%s> callsite %u not announced\n",
+           (unsigned long long)timestamp,
+           prv_level_str(LOG_MSG_GET_LEVEL(msg)), (unsigned)msg->callsite_id);
+    return;
+  }
+
+  size_t args_size = msg->args_buffer_size;
+  uint32_t suppressed = 0;
+
+  if (LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_KV)) {
+    prv_render_kv(body, &body_len, callsite, msg->args_buffer, args_size);
+  } else if (LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_SPAN_BEGIN |
+                                       LOG_MSG_FLAG_SPAN_END)) {
+    // Task names stay on the target, print the compact task ID
+    prv_append(body, &body_len, "%s %s task=%s%u",
+               LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_SPAN_END) ? "end" : "begin",
+               callsite->fmt_str,
+               LOG_CONTEXT_IS_ISR(msg->context) ? "isr" : "#",
+               (unsigned)LOG_CONTEXT_GET_ID(msg->context));
+  } else {
+    if (LOG_MSG_HAS_FLAG(msg, LOG_MSG_FLAG_SUPPRESSED) &&
+        args_size >= sizeof(suppressed)) {
+      args_size -= sizeof(suppressed);
+      memcpy(&suppressed, msg->args_buffer + args_size, sizeof(suppressed));
+    }
+
+    prv_render_fmt(body, &body_len, callsite->fmt_str, msg->args_buffer,
+                   args_size);
+
+    if (suppressed > 0) {
+      prv_append(body, &body_len, " (suppressed %lu)",
+                 (unsigned long)suppressed);
+    }
+  }
+
+  printf("[%llu] <%s> %s::%s: %s\n", (unsigned long long)timestamp,
+         prv_level_str(LOG_MSG_GET_LEVEL(msg)), callsite->module,
+         callsite->function, body);
+}
+
+/**
+ * @brief Print LOG_BINARY_RECORD_DELTA record
+ *
+ * @param record Record bytes
+ * @param len Size of record
+ */
+static void prv_handle_delta(const uint8_t *record, size_t len) {
+  log_msg_t *msg = &prv_inst.delta_msg.msg;
+
+  size_t used = log_delta_decode(&prv_inst.delta, record, len, msg,
+                                 sizeof(prv_inst.delta_msg));
+
+  // Refers to a record that was lost, or the frame is corrupt
+  if (used == 0) {
+    prv_inst.unresolved_deltas++;
+    return;
+  }
+
+  if (used != len) {
+    prv_inst.malformed++;
+    log_delta_reset(&prv_inst.delta);
+    return;
+  }
+
+  prv_handle_msg(prv_inst.delta_msg.bytes,
+                 sizeof(log_msg_t) + msg->args_buffer_size);
+}
+
+/**
+ * @brief Take next NUL terminated string from record
+ *
+ * @param record Record bytes
+ * @param len Size of record
+ * @param offset Read position, advanced past the string
+ * @return Copy of the string, NULL if the record ends first
+ */
+static char *prv_take_str(const uint8_t *record, size_t len, size_t *offset) {
+  if (*offset >= len) {
+    return NULL;
+  }
+
+  const uint8_t *end = memchr(record + *offset, '\0', len - *offset);
+  if (end == NULL) {
+    return NULL;
+  }
+
+  char *str = strdup((const char *)record + *offset);
+  *offset = (size_t)(end - record) + 1;
+
+  return str;
+}
+
+/**
+ * @brief Release callsite
+ *
+ * @param callsite Callsite, may be NULL
+ */
+static void prv_free_callsite(reader_callsite_t *callsite) {
+  if (callsite == NULL) {
+    return;
+  }
+
+  for (uint8_t i = 0; i < callsite->kv_count; i++) {
+    free(callsite->keys ? callsite->keys[i] : NULL);
+  }
+
+  free(callsite->keys);
+  free(callsite->module);
+  free(callsite->function);
+  free(callsite->fmt_str);
+  free(callsite);
+}
+
+/**
+ * @brief Store LOG_BINARY_RECORD_CALLSITE record
+ *
+ * @param record Record bytes
+ * @param len Size of record
+ */
+static void prv_handle_callsite(const uint8_t *record, size_t len) {
+  log_binary_callsite_t header;
+  size_t offset = sizeof(header);
+
+  if (len < sizeof(header)) {
+    prv_inst.malformed++;
+    return;
+  }
+
+  memcpy(&header, record, sizeof(header));
+
+  if (header.id >= READER_CALLSITE_ID_RESERVED_START) {
+    prv_inst.malformed++;
+    return;
+  }
+
+  reader_callsite_t *callsite = calloc(1, sizeof(*callsite));
+  if (callsite == NULL) {
+    return;
+  }
+
+  callsite->module = prv_take_str(record, len, &offset);
+  callsite->function = prv_take_str(record, len, &offset);
+  callsite->fmt_str = prv_take_str(record, len, &offset);
+  callsite->keys = calloc(header.kv_count + 1u, sizeof(char *));
+  callsite->kv_count = header.kv_count;
+
+  bool valid = callsite->module && callsite->function && callsite->fmt_str &&
+               callsite->keys;
+
+  for (uint8_t i = 0; valid && i < header.kv_count; i++) {
+    callsite->keys[i] = prv_take_str(record, len, &offset);
+    valid = callsite->keys[i] != NULL;
+  }
+
+  if (!valid) {
+    prv_inst.malformed++;
+    prv_free_callsite(callsite);
+    return;
+  }
+
+  // Target may have restarted with a different callsite table
+  prv_free_callsite(prv_inst.callsites[header.id]);
+  prv_inst.callsites[header.id] = callsite;
+}
+
+/**
+ * @brief Decode and handle a complete frame
+ *
+ */
+static void prv_handle_frame(void) {
+  int len = log_cobs_decode(prv_inst.frame, prv_inst.frame_len, prv_inst.frame);
+
+  if (len < 0 || (size_t)len < 1 + LOG_BINARY_CRC_SIZE) {
+    prv_inst.malformed++;
+    log_delta_reset(&prv_inst.delta);
+    return;
+  }
+
+  size_t record_len = (size_t)len - 1 - LOG_BINARY_CRC_SIZE;
+  const uint8_t *crc = &prv_inst.frame[len - LOG_BINARY_CRC_SIZE];
+  uint16_t expected = (uint16_t)(crc[0] | (crc[1] << 8));
+
+  if (log_cobs_crc16(LOG_COBS_CRC16_INIT, prv_inst.frame,
+                     (size_t)len - LOG_BINARY_CRC_SIZE) != expected) {
+    prv_inst.crc_errors++;
+    log_delta_reset(&prv_inst.delta);
+    return;
+  }
+
+  prv_inst.frames++;
+
+  switch (prv_inst.frame[0]) {
+  case LOG_BINARY_RECORD_MSG:
+    prv_handle_msg(&prv_inst.frame[1], record_len);
+    break;
+  case LOG_BINARY_RECORD_CALLSITE:
+    prv_handle_callsite(&prv_inst.frame[1], record_len);
+    break;
+  case LOG_BINARY_RECORD_DELTA:
+    prv_handle_delta(&prv_inst.frame[1], record_len);
+    break;
+  default:
+    prv_inst.malformed++;
+    break;
+  }
+}
+
+/**
+ * @brief Feed received bytes
+ *
+ * @param data Received bytes
+ * @param len Number of bytes
+ */
+static void prv_feed(const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] == LOG_COBS_DELIMITER) {
+      // Frames that outgrew the buffer are dropped whole
+      if (prv_inst.frame_overrun) {
+        prv_inst.malformed++;
+        log_delta_reset(&prv_inst.delta);
+      } else if (prv_inst.frame_len > 0) {
+        prv_handle_frame();
+      }
+
+      prv_inst.frame_len = 0;
+      prv_inst.frame_overrun = false;
+      continue;
+    }
+
+    if (prv_inst.frame_len >= sizeof(prv_inst.frame)) {
+      prv_inst.frame_overrun = true;
+      continue;
+    }
+
+    prv_inst.frame[prv_inst.frame_len++] = data[i];
+  }
+}
+
+/**
+ * @brief Switch terminal to raw mode
+ *
+ * @param fd Terminal file descriptor
+ * @param baud Baud rate, 0 to keep the current one
+ * @return 0 on success, -1 on error
+ */
+static int prv_setup_tty(int fd, unsigned long baud) {
+  struct termios tio;
+
+  if (tcgetattr(fd, &tio) != 0) {
+    return -1;
+  }
+
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+
+  if (baud != 0) {
+    speed_t speed;
+
+    switch (baud) {
+    case 9600:
+      speed = B9600;
+      break;
+    case 115200:
+      speed = B115200;
+      break;
+    case 230400:
+      speed = B230400;
+      break;
+    case 460800:
+      speed = B460800;
+      break;
+    case 921600:
+      speed = B921600;
+      break;
+    default:
+      fprintf(stderr, "unsupported baud rate %lu\n", baud);
+      return -1;
+    }
+
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+  }
+
+  return tcsetattr(fd, TCSANOW, &tio);
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv) {
+  unsigned long baud = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "lb:")) != -1) {
+    switch (opt) {
+    case 'l':
+      prv_inst.long_size = 8;
+      prv_inst.ptr_size = 8;
+      break;
+    case 'b':
+      baud = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-l] [-b baud] <device|file|->\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (optind != argc - 1) {
+    fprintf(stderr, "usage: %s [-l] [-b baud] <device|file|->\n", argv[0]);
+    return 2;
+  }
+
+  int fd = STDIN_FILENO;
+
+  if (strcmp(argv[optind], "-") != 0) {
+    fd = open(argv[optind], O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+
+  if (isatty(fd) && prv_setup_tty(fd, baud) != 0) {
+    perror("tty setup");
+    return 1;
+  }
+
+  // Output is consumed live, do not hold lines back
+  setvbuf(stdout, NULL, _IOLBF, 0);
+
+  uint8_t buf[256];
+  ssize_t len;
+
+  while ((len = read(fd, buf, sizeof(buf))) != 0) {
+    if (len < 0) {
+      // A pty reports EIO once the writer closes it
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EIO) {
+        perror("read");
+      }
+      break;
+    }
+
+    prv_feed(buf, (size_t)len);
+  }
+
+  fprintf(stderr,
+          "frames: %lu, crc errors: %lu, malformed: %lu, "
+          "unknown callsites: %lu, unresolved deltas: %lu\n",
+          prv_inst.frames, prv_inst.crc_errors, prv_inst.malformed,
+          prv_inst.unknown_callsites, prv_inst.unresolved_deltas);
+
+  return 0;
+}
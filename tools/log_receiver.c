@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) Evan Stoddard
+ */
+
+/**
+ * @file log_receiver.c
+ * @author Evan Stoddard
+ * @brief Host receiver for batched log datagrams
+ *
+ * Receives datagrams sent by log_backend_socket on the loopback interface or
+ * a Unix datagram socket and appends their records to a file.  Text streams
+ * become a plain log, binary streams a capture file for log_reader.
+ * Sequence gaps are counted, and in text streams marked by a line.
+ *
+ * Build:
+ *   cc -I src -o log_receiver tools/log_receiver.c
+ *
+ * Usage:
+ *   log_receiver (-u port | -s path) [-n count] <file|->
+ *
+ * `-u` listens on 127.0.0.1 only, `-s` binds a Unix datagram socket at
+ * `path`.  `-n` exits after `count` datagrams, otherwise the receiver runs
+ * until interrupted.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "log_datagram.h"
+
+/*****************************************************************************
+ * Definitions
+ *****************************************************************************/
+
+/** @brief Datagrams taken per recvmmsg call */
+#define RECEIVER_BATCH 64
+
+/** @brief Largest datagram accepted */
+#define RECEIVER_DATAGRAM_SIZE 65536
+
+/** @brief Receive buffer requested from the kernel */
+#define RECEIVER_SOCKET_BUFFER (4 * 1024 * 1024)
+
+/*****************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/**
+ * @brief Private instance
+ *
+ */
+static struct {
+  int out;
+
+  // Output of one batch, written with a single writev
+  struct iovec pending[2 * RECEIVER_BATCH];
+  int pending_cnt;
+  char markers[RECEIVER_BATCH][64];
+  int marker_cnt;
+
+  // Sequence tracking of the current session
+  bool have_session;
+  uint32_t session;
+  uint32_t expected;
+
+  // Statistics
+  unsigned long datagrams;
+  unsigned long records;
+  unsigned long long bytes;
+  unsigned long lost;
+  unsigned long late;
+  unsigned long malformed;
+  unsigned long sessions;
+} prv_inst;
+
+/** @brief Set by SIGINT and SIGTERM */
+static volatile sig_atomic_t prv_stop;
+
+/*****************************************************************************
+ * Private Functions
+ *****************************************************************************/
+
+/**
+ * @brief Stop receiving
+ *
+ * @param sig Signal number
+ */
+static void prv_on_signal(int sig) {
+  (void)sig;
+  prv_stop = 1;
+}
+
+/**
+ * @brief Write all bytes to the output
+ *
+ * @param data Bytes to write
+ * @param len Number of bytes
+ */
+static void prv_write(const void *data, size_t len) {
+  const uint8_t *p = data;
+
+  while (len > 0) {
+    ssize_t ret = write(prv_inst.out, p, len);
+
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      perror("write");
+      exit(1);
+    }
+
+    p += ret;
+    len -= (size_t)ret;
+  }
+}
+
+/**
+ * @brief Queue bytes for the next prv_flush_output
+ *
+ * @param data Bytes to write, valid until then
+ * @param len Number of bytes
+ */
+static void prv_queue_output(const void *data, size_t len) {
+  prv_inst.pending[prv_inst.pending_cnt].iov_base = (void *)data;
+  prv_inst.pending[prv_inst.pending_cnt].iov_len = len;
+  prv_inst.pending_cnt++;
+}
+
+/**
+ * @brief Write queued output
+ *
+ */
+static void prv_flush_output(void) {
+  size_t total = 0;
+
+  for (int i = 0; i < prv_inst.pending_cnt; i++) {
+    total += prv_inst.pending[i].iov_len;
+  }
+
+  ssize_t ret = prv_inst.pending_cnt > 0
+                    ? writev(prv_inst.out, prv_inst.pending,
+                             prv_inst.pending_cnt)
+                    : 0;
+  size_t done = ret > 0 ? (size_t)ret : 0;
+
+  // Rest of a short or interrupted write, one piece at a time
+  for (int i = 0; done < total && i < prv_inst.pending_cnt; i++) {
+    size_t len = prv_inst.pending[i].iov_len;
+
+    if (done >= len) {
+      done -= len;
+      continue;
+    }
+
+    prv_write((const uint8_t *)prv_inst.pending[i].iov_base + done,
+              len - done);
+    done = 0;
+  }
+
+  prv_inst.pending_cnt = 0;
+  prv_inst.marker_cnt = 0;
+}
+
+/**
+ * @brief Check sequence number and queue records of a datagram
+ *
+ * @param data Datagram
+ * @param len Size of datagram
+ */
+static void prv_handle_datagram(const uint8_t *data, size_t len) {
+  log_datagram_header_t header;
+
+  if (len < sizeof(header)) {
+    prv_inst.malformed++;
+    return;
+  }
+
+  memcpy(&header, data, sizeof(header));
+
+  if (header.magic != LOG_DATAGRAM_MAGIC) {
+    prv_inst.malformed++;
+    return;
+  }
+
+  if (!prv_inst.have_session || header.session != prv_inst.session) {
+    // Sender restarted, its sequence starts over
+    prv_inst.have_session = true;
+    prv_inst.session = header.session;
+    prv_inst.expected = header.sequence;
+    prv_inst.sessions++;
+  }
+
+  int32_t diff = (int32_t)(header.sequence - prv_inst.expected);
+
+  if (diff > 0) {
+    prv_inst.lost += (unsigned long)diff;
+    fprintf(stderr, "lost %d datagrams before sequence %u\n", (int)diff,
+            (unsigned)header.sequence);
+
+    // Binary streams resynchronize on their own at the next frame
+    if (header.format == LOG_DATAGRAM_FORMAT_TEXT) {
+      char *marker = prv_inst.markers[prv_inst.marker_cnt++];
+      int n = snprintf(marker, sizeof(prv_inst.markers[0]),
+                       "--- %d datagrams lost ---\n", (int)diff);
+      prv_queue_output(marker, (size_t)n);
+    }
+  } else if (diff < 0) {
+    prv_inst.late++;
+  }
+
+  if (diff >= 0) {
+    prv_inst.expected = header.sequence + 1;
+  }
+
+  prv_inst.datagrams++;
+  prv_inst.records += header.count;
+  prv_inst.bytes += len - sizeof(header);
+
+  prv_queue_output(data + sizeof(header), len - sizeof(header));
+}
+
+/**
+ * @brief Open socket bound to the loopback port or Unix path
+ *
+ * @param port UDP port, used if `path` is NULL
+ * @param path Unix socket path
+ * @return Socket, -1 on error
+ */
+static int prv_open_socket(unsigned long port, const char *path) {
+  int size = RECEIVER_SOCKET_BUFFER;
+  int fd;
+
+  if (path != NULL) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+      fprintf(stderr, "socket path too long\n");
+      return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      perror("socket");
+      return -1;
+    }
+
+    // A socket file left by an earlier run would make bind fail
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+      perror("bind");
+      close(fd);
+      return -1;
+    }
+  } else {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons((uint16_t)port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+      perror("socket");
+      return -1;
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+      perror("bind");
+      close(fd);
+      return -1;
+    }
+  }
+
+  // Rides out bursts while the output is written
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+  return fd;
+}
+
+/*****************************************************************************
+ * Functions
+ *****************************************************************************/
+
+int main(int argc, char **argv) {
+  const char *usage = "usage: %s (-u port | -s path) [-n count] <file|->\n";
+  const char *path = NULL;
+  unsigned long port = 0;
+  unsigned long limit = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "u:s:n:")) != -1) {
+    switch (opt) {
+    case 'u':
+      port = strtoul(optarg, NULL, 10);
+      break;
+    case 's':
+      path = optarg;
+      break;
+    case 'n':
+      limit = strtoul(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, usage, argv[0]);
+      return 2;
+    }
+  }
+
+  if (optind != argc - 1 || (port == 0) == (path == NULL) || port > 65535) {
+    fprintf(stderr, usage, argv[0]);
+    return 2;
+  }
+
+  prv_inst.out = STDOUT_FILENO;
+
+  if (strcmp(argv[optind], "-") != 0) {
+    prv_inst.out = open(argv[optind], O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                        0644);
+    if (prv_inst.out < 0) {
+      perror(argv[optind]);
+      return 1;
+    }
+  }
+
+  int fd = prv_open_socket(port, path);
+  if (fd < 0) {
+    return 1;
+  }
+
+  // Without SA_RESTART so a signal interrupts recvmmsg
+  struct sigaction sa = {.sa_handler = prv_on_signal};
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  static uint8_t bufs[RECEIVER_BATCH][RECEIVER_DATAGRAM_SIZE];
+  struct mmsghdr msgs[RECEIVER_BATCH];
+  struct iovec iov[RECEIVER_BATCH];
+
+  while (!prv_stop && (limit == 0 || prv_inst.datagrams < limit)) {
+    unsigned int want = RECEIVER_BATCH;
+
+    if (limit != 0 && limit - prv_inst.datagrams < want) {
+      want = (unsigned int)(limit - prv_inst.datagrams);
+    }
+
+    memset(msgs, 0, sizeof(msgs));
+    for (unsigned int i = 0; i < want; i++) {
+      iov[i].iov_base = bufs[i];
+      iov[i].iov_len = sizeof(bufs[i]);
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Blocks for the first datagram, then takes what is already queued
+    int n = recvmmsg(fd, msgs, want, MSG_WAITFORONE, NULL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror("recvmmsg");
+      break;
+    }
+
+    for (int i = 0; i < n; i++) {
+      prv_handle_datagram(bufs[i], msgs[i].msg_len);
+    }
+
+    prv_flush_output();
+  }
+
+  if (path != NULL) {
+    unlink(path);
+  }
+
+  fprintf(stderr,
+          "datagrams: %lu, records: %lu, bytes: %llu, lost: %lu, "
+          "late: %lu, malformed: %lu, sessions: %lu\n",
+          prv_inst.datagrams, prv_inst.records, prv_inst.bytes, prv_inst.lost,
+          prv_inst.late, prv_inst.malformed, prv_inst.sessions);
+
+  return 0;
+}